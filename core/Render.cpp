@@ -2,9 +2,276 @@
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <cfloat>
+#include <algorithm>
+#include <chrono>
+#ifdef _WIN32
+#include <malloc.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+//遮挡体光栅化、缓冲填充、颜色调制使用SSE2，不支持时使用标量代码
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _RENDER_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace render {
 
+//渲染状态键：除各渲染状态索引对应的标志位之外的附加标志位
+#define _RENDER_STATE_KEY_DEPTH_TEST_EQUAL (1 << 16)
+#define _RENDER_STATE_KEY_FACE_CULLING_BACK (1 << 17)
+
+//三角裁剪：需要插值的顶点属性
+#define _CLIP_ATTRIBUTE_COLOR 0x1
+#define _CLIP_ATTRIBUTE_TEXTURE 0x2
+
+//顶点压缩：摄像机坐标系下顶点区域码，近截面之前、视锥体左右下上侧面之外，被保留三角引用
+#define _COMPACTION_OUTCODE_NEAR 0x01
+#define _COMPACTION_OUTCODE_LEFT 0x02
+#define _COMPACTION_OUTCODE_RIGHT 0x04
+#define _COMPACTION_OUTCODE_BOTTOM 0x08
+#define _COMPACTION_OUTCODE_TOP 0x10
+#define _COMPACTION_REFERENCED 0x20
+
+//三角裁剪：截面数量、近截面下标
+#define _CLIP_PLANE_COUNT 5
+#define _CLIP_PLANE_NEAR 0
+
+//保护带：投影坐标系下|x|、|y|的上限，超出的三角才进行几何裁剪，其余交给光栅化时裁剪
+#define _GUARD_BAND_SCALE 16.0f
+
+//视口坐标系定点数小数位数，用于三角相对视口的快速接受、舍去
+#define _VIEW_SUBPIXEL_BITS 4
+#define _VIEW_OUTCODE_BORDER 0x10
+
+//缓冲分配：对齐字节数，行间距按此对齐，不小于此字节数的缓冲按大页对齐并建议系统使用透明大页
+#define _BUFFER_ALIGN 64
+#define _BUFFER_PITCH_ALIGN_PIXEL 32
+#define _BUFFER_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define _BUFFER_HUGE_PAGE_MIN_SIZE (16 * 1024 * 1024)
+
+//分块布局块尺寸，行间距按像素对齐后总是块尺寸的整数倍
+#define _BUFFER_BLOCK_SIZE 8
+
+//像素(x, y)的缓冲下标
+#define _PIXEL_INDEX(x, y) (m_PixelOffsetX[x] + m_PixelOffsetY[y])
+
+//延迟填充：块尺寸为(1 << _TILE_SIZE_SHIFT)像素，块待填充标志
+#define _TILE_SIZE_SHIFT 5
+#define _TILE_FILL_VIDEO 0x1
+#define _TILE_FILL_DEPTH 0x2
+
+//光照：夹角余弦值不小于此值才叠加漫反射、镜面反射效果，直接按浮点数比较，不受_FLT_POLICY影响
+#define _ILLUMINATION_COSINE_MIN 0.000001f
+
+//管线临时内存初始字节数
+#define _SCRATCH_ARENA_INITIAL_SIZE (256 * 1024)
+
+//动态分辨率：用时低于目标的这个比例才提高缩放，提高时每帧向目标缩放移动的比例
+#define _DYNAMIC_RESOLUTION_RAISE_MARGIN 0.9f
+#define _DYNAMIC_RESOLUTION_RAISE_RATE 0.25f
+
+	//深度格式：浮点数直接存储1/z，逐像素深度测试不经过_FLT_POLICY，总是直接按浮点数比较，
+	//与定点格式的整数比较一样没有乘法和类型转换，深度相等测试比较的是同样计算得到的值，也不需要容差
+	struct DEPTH_FLOAT
+	{
+		typedef float TYPE;
+		static TYPE Convert(float z_reciprocal, double, double)
+		{
+			return z_reciprocal;
+		}
+		static bool Less(TYPE depth1, TYPE depth2)
+		{
+			return depth1 < depth2;
+		}
+		static bool Equal(TYPE depth1, TYPE depth2)
+		{
+			return depth1 == depth2;
+		}
+	};
+
+	//深度格式：定点数存储(1/z - bias) * scale，限制在[0, MAX]，比较为整数比较，
+	//按双精度计算，单精度只有24位有效数字，32位定点数的低位会被舍入掉
+	template <typename T, unsigned int MAX>
+	struct DEPTH_FIXED
+	{
+		typedef T TYPE;
+		static TYPE Convert(float z_reciprocal, double scale, double bias)
+		{
+			double depth = ((double)z_reciprocal - bias) * scale;
+			if (depth <= 0.0)
+				return 0;
+			return depth < (double)MAX ? (TYPE)depth : (TYPE)MAX;
+		}
+		static bool Less(TYPE depth1, TYPE depth2)
+		{
+			return depth1 < depth2;
+		}
+		static bool Equal(TYPE depth1, TYPE depth2)
+		{
+			return depth1 == depth2;
+		}
+	};
+	typedef DEPTH_FIXED<unsigned short, 0xffff> DEPTH_UNORM16;
+	typedef DEPTH_FIXED<unsigned int, 0xffffff> DEPTH_FIXED24;
+	typedef DEPTH_FIXED<unsigned int, 0xffffffff> DEPTH_FIXED32;
+
+	//分配对齐的缓冲，大缓冲按大页对齐，Linux下建议使用透明大页以减少页表缓存缺失
+	static void* BufferAllocate(size_t size)
+	{
+		size_t alignment = size >= _BUFFER_HUGE_PAGE_MIN_SIZE ? _BUFFER_HUGE_PAGE_SIZE : _BUFFER_ALIGN;
+#ifdef _WIN32
+		return _aligned_malloc(size, alignment);
+#else
+		void* buffer = NULL;
+		if (0 != posix_memalign(&buffer, alignment, size))
+			return NULL;
+#ifdef MADV_HUGEPAGE
+		if (_BUFFER_HUGE_PAGE_SIZE == alignment)
+			madvise(buffer, size, MADV_HUGEPAGE);
+#endif
+		return buffer;
+#endif
+	}
+
+	static void BufferFree(void* buffer)
+	{
+#ifdef _WIN32
+		_aligned_free(buffer);
+#else
+		free(buffer);
+#endif
+	}
+
+	//保证缓冲容量不小于size，容量足够时重用原来的缓冲
+	static void BufferReserve(void** buffer, size_t* capacity, size_t size)
+	{
+		if (NULL != *buffer && size <= *capacity)
+			return;
+		if (NULL != *buffer)
+			BufferFree(*buffer);
+		*buffer = BufferAllocate(size);
+		*capacity = NULL != *buffer ? size : 0;
+	}
+
+	//以value填充count个单元，SSE2下对齐到16字节之后每次写16字节，stream为真时使用流式写入不经过缓存，
+	//用于整个缓冲填充，避免把马上又会被覆盖的数据挤占缓存
+	template <typename T>
+	static void FillMemory(T* buffer, T value, int count, bool stream)
+	{
+		int i = 0;
+#ifdef _RENDER_SSE2
+		const int step = 16 / sizeof(T);
+		for (; i < count && 0 != ((size_t)(buffer + i) & 15); ++i)
+			buffer[i] = value;
+		if (i + step <= count)
+		{
+			T pattern[step];
+			for (int j = 0; j < step; ++j)
+				pattern[j] = value;
+			__m128i v = _mm_loadu_si128((const __m128i*)pattern);
+			if (stream)
+			{
+				for (; i + step <= count; i += step)
+					_mm_stream_si128((__m128i*)(buffer + i), v);
+				_mm_sfence();
+			}
+			else
+			{
+				for (; i + step <= count; i += step)
+					_mm_store_si128((__m128i*)(buffer + i), v);
+			}
+		}
+#endif
+		for (; i < count; ++i)
+			buffer[i] = value;
+	}
+
+	//纹理颜色按光照颜色调制：c * (r, g, b) / 255，光照颜色已约束在[0, 255]，
+	//SSE2下4个通道一起计算，alpha通道乘以255不变，结果饱和到[0, 255]
+	static inline int ColorModulate(int color, float r, float g, float b)
+	{
+#ifdef _RENDER_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		__m128i c = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(color), zero), zero);
+		__m128 m = _mm_mul_ps(
+			_mm_cvtepi32_ps(c),
+			_mm_mul_ps(_mm_set_ps(255.0f, r, g, b), _mm_set1_ps(1.0f / 255.0f)));
+		__m128i v = _mm_cvttps_epi32(m);
+		v = _mm_packs_epi32(v, v);
+		return _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+#else
+		const float scale = 1.0f / 255.0f;
+		return _COLOR_SET(
+			std::min((int)(_COLOR_GET_R(color) * (r * scale)), 255),
+			std::min((int)(_COLOR_GET_G(color) * (g * scale)), 255),
+			std::min((int)(_COLOR_GET_B(color) * (b * scale)), 255));
+#endif
+	}
+
+	//深度格式每像素字节数，24位以32位存储
+	static int DepthFormatSize(int depth_format)
+	{
+		return _DEPTH_FORMAT_UNORM16 == depth_format ? sizeof(unsigned short) :
+			_DEPTH_FORMAT_FLOAT == depth_format ? sizeof(float) : sizeof(unsigned int);
+	}
+
+	//单调时钟毫秒数，用于测量帧用时
+	static double GetTimeMillisecond()
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	//放大的水平插值：源行按像素下标对和右侧像素权重(0~256)插值count个像素，每个通道结果存为16位，
+	//SSE2下每次插值2个像素，乘积不超过255 * 256，两个乘积之和不超过16位无符号数范围
+	static void UpscaleRowHorizontal(
+		const int* src_row,
+		const int* offset_x,
+		const int* weight_x,
+		int count,
+		unsigned short* row)
+	{
+		int x = 0;
+#ifdef _RENDER_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi16(256);
+		for (; x + 2 <= count; x += 2)
+		{
+			__m128i a = _mm_unpacklo_epi8(_mm_unpacklo_epi32(
+				_mm_cvtsi32_si128(src_row[offset_x[x * 2]]),
+				_mm_cvtsi32_si128(src_row[offset_x[x * 2 + 2]])), zero);
+			__m128i b = _mm_unpacklo_epi8(_mm_unpacklo_epi32(
+				_mm_cvtsi32_si128(src_row[offset_x[x * 2 + 1]]),
+				_mm_cvtsi32_si128(src_row[offset_x[x * 2 + 3]])), zero);
+			__m128i w = _mm_set_epi16(
+				(short)weight_x[x + 1], (short)weight_x[x + 1], (short)weight_x[x + 1], (short)weight_x[x + 1],
+				(short)weight_x[x], (short)weight_x[x], (short)weight_x[x], (short)weight_x[x]);
+			__m128i v = _mm_add_epi16(
+				_mm_mullo_epi16(a, _mm_sub_epi16(one, w)),
+				_mm_mullo_epi16(b, w));
+			_mm_storeu_si128((__m128i*)(row + x * 4), _mm_srli_epi16(v, 8));
+		}
+#endif
+		for (; x < count; ++x)
+		{
+			unsigned int a = (unsigned int)src_row[offset_x[x * 2]];
+			unsigned int b = (unsigned int)src_row[offset_x[x * 2 + 1]];
+			int w = weight_x[x];
+			for (int c = 0; c < 4; ++c)
+			{
+				int ca = (a >> (c * 8)) & 0xff;
+				int cb = (b >> (c * 8)) & 0xff;
+				row[x * 4 + c] = (unsigned short)((ca * (256 - w) + cb * w) >> 8);
+			}
+		}
+	}
+
+//绘制命令：不透明批次的深度分段数量
+#define _DRAW_COMMAND_DEPTH_BUCKET_COUNT 16
+
 	matrix4* ComputeTransformCamera(
 		matrix4* mat4,
 		const vector3* eye,
@@ -78,6 +345,30 @@ namespace render {
 		return sqrt(max_radius);
 	}
 
+	void ComputeWorldShpere(
+		const matrix4* transform_world,
+		float local_radius,
+		vector3* center,
+		float* radius)
+	{
+		vector3 center_in_local(0.0f, 0.0f, 0.0f);
+		Vec3MulMat4(&center_in_local, transform_world, center);
+
+		//取三个轴向量长度的最大值作为缩放
+		float max_scale = 0.0f;
+		for (int i = 0; i < 3; ++i)
+		{
+			float scale =
+				transform_world->e[i * 4 + 0] * transform_world->e[i * 4 + 0] +
+				transform_world->e[i * 4 + 1] * transform_world->e[i * 4 + 1] +
+				transform_world->e[i * 4 + 2] * transform_world->e[i * 4 + 2];
+			if (_FLT_LESS_FLT(max_scale, scale))
+				max_scale = scale;
+		}
+
+		*radius = local_radius * sqrt(max_scale);
+	}
+
 	vector3 Render::ComputerCenterInCamera()
 	{
 		//将本地坐标系原点（包围球球心）转换到摄像机坐标系
@@ -95,13 +386,21 @@ namespace render {
 		//得到摄像机坐标系下面包围球球心
 		vector3 center_in_camera = ComputerCenterInCamera();
 
-		//视锥体裁剪
-		if (_FLT_LESS_FLT(m_FarPlaneZInCamera, center_in_camera.z - sphere_radius) ||
-			_FLT_LESS_FLT(center_in_camera.z + sphere_radius, m_NearPlaneZInCamera) ||
-			_FLT_LESS_FLT(+center_in_camera.z, center_in_camera.x - sphere_radius) ||
-			_FLT_LESS_FLT(center_in_camera.x + sphere_radius, -center_in_camera.z) ||
-			_FLT_LESS_FLT(+center_in_camera.z, center_in_camera.y - sphere_radius)  ||
-			_FLT_LESS_FLT(center_in_camera.y + sphere_radius, -center_in_camera.z))
+		return CoordinateCameraFrustumTest(&center_in_camera, sphere_radius);
+	}
+
+	bool Render::CoordinateCameraFrustumTest(
+		const vector3* center_in_camera,
+		float sphere_radius)
+	{
+		//视锥体裁剪，侧面x=±z、y=±z的法线长度为sqrt(2)，球心到侧面的距离需要除以sqrt(2)
+		float side_radius = sphere_radius * sqrt(2.0f);
+		if (_FLT_LESS_FLT(m_FarPlaneZInCamera, center_in_camera->z - sphere_radius) ||
+			_FLT_LESS_FLT(center_in_camera->z + sphere_radius, m_NearPlaneZInCamera) ||
+			_FLT_LESS_FLT(+center_in_camera->z, center_in_camera->x - side_radius) ||
+			_FLT_LESS_FLT(center_in_camera->x + side_radius, -center_in_camera->z) ||
+			_FLT_LESS_FLT(+center_in_camera->z, center_in_camera->y - side_radius)  ||
+			_FLT_LESS_FLT(center_in_camera->y + side_radius, -center_in_camera->z))
 			return false;
 		else
 			return true;
@@ -194,6 +493,34 @@ namespace render {
 		m_pSegmentAfterNearPlaneClip = &m_SegmentByNearPlaneClip;
 	}
 
+//线段逐像素步进：线性布局缓冲下标按固定增量步进，分块布局坐标变化时只查变化那一轴的偏移表，
+//另一轴的偏移保持不变，_remain为剩余像素数，最后一个像素之后坐标可能越过视口，不再查表，
+//LAYOUT为缓冲布局，以模板参数在编译期选择
+#define _SEGMENT_STEP_INIT \
+	int pixel_offset_x = m_PixelOffsetX[x]; \
+	int pixel_offset_y = m_PixelOffsetY[y]; \
+	int pixel_idx = pixel_offset_x + pixel_offset_y; \
+	int step_y = add_y * m_BufferPitch;
+#define _SEGMENT_STEP_X(_remain) \
+	if (_BUFFER_LAYOUT_LINEAR == LAYOUT) \
+		pixel_idx += add_x; \
+	else if (0 != (_remain)) \
+	{ \
+		x += add_x; \
+		pixel_offset_x = m_PixelOffsetX[x]; \
+		pixel_idx = pixel_offset_x + pixel_offset_y; \
+	}
+#define _SEGMENT_STEP_Y(_remain) \
+	if (_BUFFER_LAYOUT_LINEAR == LAYOUT) \
+		pixel_idx += step_y; \
+	else if (0 != (_remain)) \
+	{ \
+		y += add_y; \
+		pixel_offset_y = m_PixelOffsetY[y]; \
+		pixel_idx = pixel_offset_x + pixel_offset_y; \
+	}
+
+	template <int LAYOUT>
 	void Render::Draw3DMeshSegmentRasterize_ab0_dt0(
 		const vector3* v0,
 		const vector3* v1,
@@ -205,8 +532,8 @@ namespace render {
 		if (!SegmentClip(&m_RectangleView, &seg))
 			return;
 
-		int* current_video_buffer
-			= m_pVideoBuffer + seg.y1 * m_BufferWidth + seg.x1;
+		int x = seg.x1;
+		int y = seg.y1;
 
 		int delta_x = seg.x2 - seg.x1;
 		int delta_y = seg.y2 - seg.y1;
@@ -222,29 +549,31 @@ namespace render {
 		if (delta_y < 0)
 		{
 			delta_y = -delta_y;
-			add_y = -m_BufferWidth;
+			add_y = -1;
 		}
 		else
-			add_y = m_BufferWidth;
+			add_y = 1;
 
 		int delta_2x = delta_x << 1;
 		int delta_2y = delta_y << 1;
 
+		_SEGMENT_STEP_INIT
+
 		if (delta_x > delta_y)
 		{
 			int p = delta_2y - delta_x;
 
 			for (int i = delta_x; i >= 0; --i)
 			{
-				*current_video_buffer = color;
+				m_pVideoBuffer[pixel_idx] = color;
 
 				if (p >= 0)
 				{
-					current_video_buffer += add_y;
+					_SEGMENT_STEP_Y(i)
 					p -= delta_2x;
 				}
 
-				current_video_buffer += add_x;
+				_SEGMENT_STEP_X(i)
 				p += delta_2y;
 			}
 		}
@@ -254,20 +583,21 @@ namespace render {
 
 			for (int i = delta_y; i >= 0; --i)
 			{
-				*current_video_buffer = color;
+				m_pVideoBuffer[pixel_idx] = color;
 
 				if (p >= 0)
 				{
-					current_video_buffer += add_x;
+					_SEGMENT_STEP_X(i)
 					p -= delta_2y;
 				}
 
-				current_video_buffer += add_y;
+				_SEGMENT_STEP_Y(i)
 				p += delta_2x;
 			}
 		}
 	}
 
+	template <typename DEPTH, int LAYOUT>
 	void Render::Draw3DMeshSegmentRasterize_ab0_dt1(
 		const vector3* v0,
 		const vector3* v1,
@@ -279,10 +609,9 @@ namespace render {
 		if ((seg.x1 == seg.x2 && seg.y1 == seg.y2) || !SegmentClip(&m_RectangleView, &seg))
 			return;
 
-		int* current_video_buffer
-			= m_pVideoBuffer + seg.y1 * m_BufferWidth + seg.x1;
-		float* current_depth_buffer
-			= m_pDepthBuffer + seg.y1 * m_BufferWidth + seg.x1;
+		int x = seg.x1;
+		int y = seg.y1;
+		typename DEPTH::TYPE* depth_buffer = (typename DEPTH::TYPE*)m_pDepthBuffer;
 
 		int delta_x = seg.x2 - seg.x1;
 		int delta_y = seg.y2 - seg.y1;
@@ -298,14 +627,16 @@ namespace render {
 		if (delta_y < 0)
 		{
 			delta_y = -delta_y;
-			add_y = -m_BufferWidth;
+			add_y = -1;
 		}
 		else
-			add_y = m_BufferWidth;
+			add_y = 1;
 
 		int delta_2x = delta_x << 1;
 		int delta_2y = delta_y << 1;
 
+		_SEGMENT_STEP_INIT
+
 		if (delta_x > delta_y)
 		{
 			int p = delta_2y - delta_x;
@@ -320,21 +651,20 @@ namespace render {
 			for (int i = delta_x; i >= 0; --i)
 			{
 				//设置颜色和深度值
-				if (_FLT_LESS_FLT(*current_depth_buffer, z_reciprocal))
+				typename DEPTH::TYPE depth = DEPTH::Convert(z_reciprocal, m_DepthScale, m_DepthBias);
+				if (DEPTH::Less(depth_buffer[pixel_idx], depth))
 				{
-					*current_video_buffer = color;
-					*current_depth_buffer = z_reciprocal;
+					m_pVideoBuffer[pixel_idx] = color;
+					depth_buffer[pixel_idx] = depth;
 				}
 
 				if (p >= 0)
 				{
-					current_video_buffer += add_y;
-					current_depth_buffer += add_y;
+					_SEGMENT_STEP_Y(i)
 					p -= delta_2x;
 				}
 
-				current_video_buffer += add_x;
-				current_depth_buffer += add_x;
+				_SEGMENT_STEP_X(i)
 				p += delta_2y;
 
 				//1/z变化
@@ -355,21 +685,20 @@ namespace render {
 			for (int i = delta_y; i >= 0; --i)
 			{
 				//设置颜色和深度值
-				if (_FLT_LESS_FLT(*current_depth_buffer, z_reciprocal))
+				typename DEPTH::TYPE depth = DEPTH::Convert(z_reciprocal, m_DepthScale, m_DepthBias);
+				if (DEPTH::Less(depth_buffer[pixel_idx], depth))
 				{
-					*current_video_buffer = color;
-					*current_depth_buffer = z_reciprocal;
+					m_pVideoBuffer[pixel_idx] = color;
+					depth_buffer[pixel_idx] = depth;
 				}
 
 				if (p >= 0)
 				{
-					current_video_buffer += add_x;
-					current_depth_buffer += add_x;
+					_SEGMENT_STEP_X(i)
 					p -= delta_2y;
 				}
 
-				current_video_buffer += add_y;
-				current_depth_buffer += add_y;
+				_SEGMENT_STEP_Y(i)
 				p += delta_2x;
 
 				//1/z变化
@@ -378,6 +707,7 @@ namespace render {
 		}
 	}
 
+	template <int LAYOUT>
 	void Render::Draw3DMeshSegmentRasterize_ab1_dt0(
 		const vector3* v0,
 		const vector3* v1,
@@ -389,8 +719,8 @@ namespace render {
 		if ((seg.x1 == seg.x2 && seg.y1 == seg.y2) || !SegmentClip(&m_RectangleView, &seg))
 			return;
 
-		int* current_video_buffer
-			= m_pVideoBuffer + seg.y1 * m_BufferWidth + seg.x1;
+		int x = seg.x1;
+		int y = seg.y1;
 
 		int delta_x = seg.x2 - seg.x1;
 		int delta_y = seg.y2 - seg.y1;
@@ -406,14 +736,16 @@ namespace render {
 		if (delta_y < 0)
 		{
 			delta_y = -delta_y;
-			add_y = -m_BufferWidth;
+			add_y = -1;
 		}
 		else
-			add_y = m_BufferWidth;
+			add_y = 1;
 
 		int delta_2x = delta_x << 1;
 		int delta_2y = delta_y << 1;
 
+		_SEGMENT_STEP_INIT
+
 		if (delta_x > delta_y)
 		{
 			int p = delta_2y - delta_x;
@@ -421,18 +753,18 @@ namespace render {
 			for (int i = delta_x; i >= 0; --i)
 			{
 				//设置混合颜色
-				*current_video_buffer = _COLOR_SET(
-					(int)(_COLOR_GET_R(*current_video_buffer) * m_BackgroundAlphaBlendValue + _COLOR_GET_R(color) * m_ForegroundAlphaBlendValue),
-					(int)(_COLOR_GET_G(*current_video_buffer) * m_BackgroundAlphaBlendValue + _COLOR_GET_G(color) * m_ForegroundAlphaBlendValue),
-					(int)(_COLOR_GET_B(*current_video_buffer) * m_BackgroundAlphaBlendValue + _COLOR_GET_B(color) * m_ForegroundAlphaBlendValue));
+				m_pVideoBuffer[pixel_idx] = _COLOR_SET(
+					(int)(_COLOR_GET_R(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_R(color) * m_ForegroundAlphaBlendValue),
+					(int)(_COLOR_GET_G(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_G(color) * m_ForegroundAlphaBlendValue),
+					(int)(_COLOR_GET_B(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_B(color) * m_ForegroundAlphaBlendValue));
 
 				if (p >= 0)
 				{
-					current_video_buffer += add_y;
+					_SEGMENT_STEP_Y(i)
 					p -= delta_2x;
 				}
 
-				current_video_buffer += add_x;
+				_SEGMENT_STEP_X(i)
 				p += delta_2y;
 			}
 		}
@@ -443,23 +775,24 @@ namespace render {
 			for (int i = delta_y; i >= 0; --i)
 			{
 				//设置混合颜色
-				*current_video_buffer = _COLOR_SET(
-					(int)(_COLOR_GET_R(*current_video_buffer) * m_BackgroundAlphaBlendValue + _COLOR_GET_R(color) * m_ForegroundAlphaBlendValue),
-					(int)(_COLOR_GET_G(*current_video_buffer) * m_BackgroundAlphaBlendValue + _COLOR_GET_G(color) * m_ForegroundAlphaBlendValue),
-					(int)(_COLOR_GET_B(*current_video_buffer) * m_BackgroundAlphaBlendValue + _COLOR_GET_B(color) * m_ForegroundAlphaBlendValue));
+				m_pVideoBuffer[pixel_idx] = _COLOR_SET(
+					(int)(_COLOR_GET_R(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_R(color) * m_ForegroundAlphaBlendValue),
+					(int)(_COLOR_GET_G(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_G(color) * m_ForegroundAlphaBlendValue),
+					(int)(_COLOR_GET_B(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_B(color) * m_ForegroundAlphaBlendValue));
 
 				if (p >= 0)
 				{
-					current_video_buffer += add_x;
+					_SEGMENT_STEP_X(i)
 					p -= delta_2y;
 				}
 
-				current_video_buffer += add_y;
+				_SEGMENT_STEP_Y(i)
 				p += delta_2x;
 			}
 		}
 	}
 
+	template <typename DEPTH, int LAYOUT>
 	void Render::Draw3DMeshSegmentRasterize_ab1_dt1(
 		const vector3* v0,
 		const vector3* v1,
@@ -471,10 +804,9 @@ namespace render {
 		if ((seg.x1 == seg.x2 && seg.y1 == seg.y2) || !SegmentClip(&m_RectangleView, &seg))
 			return;
 
-		int* current_video_buffer
-			= m_pVideoBuffer + seg.y1 * m_BufferWidth + seg.x1;
-		float* current_depth_buffer
-			= m_pDepthBuffer + seg.y1 * m_BufferWidth + seg.x1;
+		int x = seg.x1;
+		int y = seg.y1;
+		typename DEPTH::TYPE* depth_buffer = (typename DEPTH::TYPE*)m_pDepthBuffer;
 
 		int delta_x = seg.x2 - seg.x1;
 		int delta_y = seg.y2 - seg.y1;
@@ -490,14 +822,16 @@ namespace render {
 		if (delta_y < 0)
 		{
 			delta_y = -delta_y;
-			add_y = -m_BufferWidth;
+			add_y = -1;
 		}
 		else
-			add_y = m_BufferWidth;
+			add_y = 1;
 
 		int delta_2x = delta_x << 1;
 		int delta_2y = delta_y << 1;
 
+		_SEGMENT_STEP_INIT
+
 		if (delta_x > delta_y)
 		{
 			int p = delta_2y - delta_x;
@@ -512,25 +846,24 @@ namespace render {
 			for (int i = delta_x; i >= 0; --i)
 			{
 				//设置混合颜色和深度值
-				if (_FLT_LESS_FLT(*current_depth_buffer, z_reciprocal))
+				typename DEPTH::TYPE depth = DEPTH::Convert(z_reciprocal, m_DepthScale, m_DepthBias);
+				if (DEPTH::Less(depth_buffer[pixel_idx], depth))
 				{
-					*current_video_buffer = _COLOR_SET(
-						(int)(_COLOR_GET_R(*current_video_buffer) * m_BackgroundAlphaBlendValue + _COLOR_GET_R(color) * m_ForegroundAlphaBlendValue),
-						(int)(_COLOR_GET_G(*current_video_buffer) * m_BackgroundAlphaBlendValue + _COLOR_GET_G(color) * m_ForegroundAlphaBlendValue),
-						(int)(_COLOR_GET_B(*current_video_buffer) * m_BackgroundAlphaBlendValue + _COLOR_GET_B(color) * m_ForegroundAlphaBlendValue));
+					m_pVideoBuffer[pixel_idx] = _COLOR_SET(
+						(int)(_COLOR_GET_R(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_R(color) * m_ForegroundAlphaBlendValue),
+						(int)(_COLOR_GET_G(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_G(color) * m_ForegroundAlphaBlendValue),
+						(int)(_COLOR_GET_B(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_B(color) * m_ForegroundAlphaBlendValue));
 
-					*current_depth_buffer = z_reciprocal;
+					depth_buffer[pixel_idx] = depth;
 				}
 
 				if (p >= 0)
 				{
-					current_video_buffer += add_y;
-					current_depth_buffer += add_y;
+					_SEGMENT_STEP_Y(i)
 					p -= delta_2x;
 				}
 
-				current_video_buffer += add_x;
-				current_depth_buffer += add_x;
+				_SEGMENT_STEP_X(i)
 				p += delta_2y;
 
 				//1/z变化
@@ -551,25 +884,24 @@ namespace render {
 			for (int i = delta_y; i >= 0; --i)
 			{
 				//设置混合颜色和深度值
-				if (_FLT_LESS_FLT(*current_depth_buffer, z_reciprocal))
+				typename DEPTH::TYPE depth = DEPTH::Convert(z_reciprocal, m_DepthScale, m_DepthBias);
+				if (DEPTH::Less(depth_buffer[pixel_idx], depth))
 				{
-					*current_video_buffer = _COLOR_SET(
-						(int)(_COLOR_GET_R(*current_video_buffer) * m_BackgroundAlphaBlendValue + _COLOR_GET_R(color) * m_ForegroundAlphaBlendValue),
-						(int)(_COLOR_GET_G(*current_video_buffer) * m_BackgroundAlphaBlendValue + _COLOR_GET_G(color) * m_ForegroundAlphaBlendValue),
-						(int)(_COLOR_GET_B(*current_video_buffer) * m_BackgroundAlphaBlendValue + _COLOR_GET_B(color) * m_ForegroundAlphaBlendValue));
+					m_pVideoBuffer[pixel_idx] = _COLOR_SET(
+						(int)(_COLOR_GET_R(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_R(color) * m_ForegroundAlphaBlendValue),
+						(int)(_COLOR_GET_G(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_G(color) * m_ForegroundAlphaBlendValue),
+						(int)(_COLOR_GET_B(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_B(color) * m_ForegroundAlphaBlendValue));
 
-					*current_depth_buffer = z_reciprocal;
+					depth_buffer[pixel_idx] = depth;
 				}
 
 				if (p >= 0)
 				{
-					current_video_buffer += add_x;
-					current_depth_buffer += add_x;
+					_SEGMENT_STEP_X(i)
 					p -= delta_2y;
 				}
 
-				current_video_buffer += add_y;
-				current_depth_buffer += add_y;
+				_SEGMENT_STEP_Y(i)
 				p += delta_2x;
 
 				//1/z变化
@@ -578,6 +910,281 @@ namespace render {
 		}
 	}
 
+//线段顶点区域码，与SegmentClip相同：x小于视口左边为W，x大于等于视口右边+1为E，y同理
+#define _SEGMENT_OUTCODE_N 0x1
+#define _SEGMENT_OUTCODE_S 0x2
+#define _SEGMENT_OUTCODE_W 0x4
+#define _SEGMENT_OUTCODE_E 0x8
+
+//批量线段光栅化：区域码有交集的线段直接舍去，区域码有一个非零的线段交给单条线段光栅化函数_single裁剪后绘制，
+//都为零的线段完全在视口内，无需裁剪直接绘制，水平、垂直、对角线段每步下标增量固定，其余使用Bresenham，
+//_skip_point为真时舍去长度为零的线段，_pixel为像素操作，可以使用pixel_idx、z_reciprocal，
+//深度测试的像素操作自己取得深度缓冲，不做深度测试的实例化不声明用不到的变量
+#define _SEGMENT_BATCH_RASTERIZE(_single, _skip_point, _pixel) \
+	int segment_count = (int)m_pSegmentAfterNearPlaneClip->size(); \
+	for (int i = 0; i < segment_count; i += 2) \
+	{ \
+		int i0 = m_pSegmentAfterNearPlaneClip->at(i); \
+		int i1 = m_pSegmentAfterNearPlaneClip->at(i + 1); \
+		const SEGMENT_VERTEX* v0 = &m_SegmentVertex[i0]; \
+		const SEGMENT_VERTEX* v1 = &m_SegmentVertex[i1]; \
+		if (0 != (v0->outcode & v1->outcode)) \
+			continue; \
+		if (0 != (v0->outcode | v1->outcode)) \
+		{ \
+			_single(&m_VertexInView[i0], &m_VertexInView[i1], color); \
+			continue; \
+		} \
+		int delta_x = v1->x - v0->x; \
+		int delta_y = v1->y - v0->y; \
+		if (_skip_point && 0 == delta_x && 0 == delta_y) \
+			continue; \
+		int x = v0->x; \
+		int y = v0->y; \
+		int add_x, add_y; \
+		if (delta_x < 0) \
+		{ \
+			delta_x = -delta_x; \
+			add_x = -1; \
+		} \
+		else \
+			add_x = 1; \
+		if (delta_y < 0) \
+		{ \
+			delta_y = -delta_y; \
+			add_y = -1; \
+		} \
+		else \
+			add_y = 1; \
+		float z_reciprocal = v0->z; \
+		if (0 == delta_x || 0 == delta_y || delta_x == delta_y) \
+		{ \
+			int count = 0 == delta_y ? delta_x : delta_y; \
+			if (0 == delta_y) \
+				add_y = 0; \
+			else if (0 == delta_x) \
+				add_x = 0; \
+			_SEGMENT_STEP_INIT \
+			int step = add_x + step_y; \
+			float z_reciprocal_rate = 0 == count ? 0.0f : (v1->z - v0->z) / count; \
+			for (int j = count; j >= 0; --j) \
+			{ \
+				_pixel \
+				if (_BUFFER_LAYOUT_LINEAR == LAYOUT) \
+					pixel_idx += step; \
+				else \
+				{ \
+					if (0 != add_x) \
+					{ \
+						_SEGMENT_STEP_X(j) \
+					} \
+					if (0 != add_y) \
+					{ \
+						_SEGMENT_STEP_Y(j) \
+					} \
+				} \
+				z_reciprocal += z_reciprocal_rate; \
+			} \
+			continue; \
+		} \
+		int delta_2x = delta_x << 1; \
+		int delta_2y = delta_y << 1; \
+		_SEGMENT_STEP_INIT \
+		if (delta_x > delta_y) \
+		{ \
+			int p = delta_2y - delta_x; \
+			float z_reciprocal_rate_by_x = (v1->z - v0->z) / delta_x; \
+			for (int j = delta_x; j >= 0; --j) \
+			{ \
+				_pixel \
+				if (p >= 0) \
+				{ \
+					_SEGMENT_STEP_Y(j) \
+					p -= delta_2x; \
+				} \
+				_SEGMENT_STEP_X(j) \
+				p += delta_2y; \
+				z_reciprocal += z_reciprocal_rate_by_x; \
+			} \
+		} \
+		else \
+		{ \
+			int p = delta_2x - delta_y; \
+			float z_reciprocal_rate_by_y = (v1->z - v0->z) / delta_y; \
+			for (int j = delta_y; j >= 0; --j) \
+			{ \
+				_pixel \
+				if (p >= 0) \
+				{ \
+					_SEGMENT_STEP_X(j) \
+					p -= delta_2y; \
+				} \
+				_SEGMENT_STEP_Y(j) \
+				p += delta_2x; \
+				z_reciprocal += z_reciprocal_rate_by_y; \
+			} \
+		} \
+	}
+
+//像素操作：直接写颜色
+#define _SEGMENT_PIXEL_ab0_dt0 \
+	m_pVideoBuffer[pixel_idx] = color;
+
+//像素操作：深度测试通过写颜色和深度
+#define _SEGMENT_PIXEL_ab0_dt1 \
+	typename DEPTH::TYPE* depth_buffer = (typename DEPTH::TYPE*)m_pDepthBuffer; \
+	typename DEPTH::TYPE depth = DEPTH::Convert(z_reciprocal, m_DepthScale, m_DepthBias); \
+	if (DEPTH::Less(depth_buffer[pixel_idx], depth)) \
+	{ \
+		m_pVideoBuffer[pixel_idx] = color; \
+		depth_buffer[pixel_idx] = depth; \
+	}
+
+//像素操作：写混合颜色
+#define _SEGMENT_PIXEL_ab1_dt0 \
+	m_pVideoBuffer[pixel_idx] = _COLOR_SET( \
+		(int)(_COLOR_GET_R(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_R(color) * m_ForegroundAlphaBlendValue), \
+		(int)(_COLOR_GET_G(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_G(color) * m_ForegroundAlphaBlendValue), \
+		(int)(_COLOR_GET_B(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_B(color) * m_ForegroundAlphaBlendValue));
+
+//像素操作：深度测试通过写混合颜色和深度
+#define _SEGMENT_PIXEL_ab1_dt1 \
+	typename DEPTH::TYPE* depth_buffer = (typename DEPTH::TYPE*)m_pDepthBuffer; \
+	typename DEPTH::TYPE depth = DEPTH::Convert(z_reciprocal, m_DepthScale, m_DepthBias); \
+	if (DEPTH::Less(depth_buffer[pixel_idx], depth)) \
+	{ \
+		_SEGMENT_PIXEL_ab1_dt0 \
+		depth_buffer[pixel_idx] = depth; \
+	}
+
+	template <int LAYOUT>
+	void Render::Draw3DMeshSegmentRasterizeBatch_ab0_dt0(int color)
+	{
+		_SEGMENT_BATCH_RASTERIZE(Draw3DMeshSegmentRasterize_ab0_dt0<LAYOUT>, false, _SEGMENT_PIXEL_ab0_dt0)
+	}
+
+	template <typename DEPTH, int LAYOUT>
+	void Render::Draw3DMeshSegmentRasterizeBatch_ab0_dt1(int color)
+	{
+		_SEGMENT_BATCH_RASTERIZE((Draw3DMeshSegmentRasterize_ab0_dt1<DEPTH, LAYOUT>), true, _SEGMENT_PIXEL_ab0_dt1)
+	}
+
+	template <int LAYOUT>
+	void Render::Draw3DMeshSegmentRasterizeBatch_ab1_dt0(int color)
+	{
+		_SEGMENT_BATCH_RASTERIZE(Draw3DMeshSegmentRasterize_ab1_dt0<LAYOUT>, true, _SEGMENT_PIXEL_ab1_dt0)
+	}
+
+	template <typename DEPTH, int LAYOUT>
+	void Render::Draw3DMeshSegmentRasterizeBatch_ab1_dt1(int color)
+	{
+		_SEGMENT_BATCH_RASTERIZE((Draw3DMeshSegmentRasterize_ab1_dt1<DEPTH, LAYOUT>), true, _SEGMENT_PIXEL_ab1_dt1)
+	}
+
+	template <typename DEPTH>
+	void Render::Draw3DMeshSegmentRasterizeAntiAlias(
+		const vector3* v0,
+		const vector3* v1,
+		int color)
+	{
+		//主轴为变化量大的轴，统一转换为沿主轴从小到大绘制
+		float x0 = v0->x, y0 = v0->y, z0 = v0->z;
+		float x1 = v1->x, y1 = v1->y, z1 = v1->z;
+		bool steep = fabs(y1 - y0) > fabs(x1 - x0);
+		if (steep)
+		{
+			std::swap(x0, y0);
+			std::swap(x1, y1);
+		}
+		if (x1 < x0)
+		{
+			std::swap(x0, x1);
+			std::swap(y0, y1);
+			std::swap(z0, z1);
+		}
+		float delta = x1 - x0;
+		if (_FLT_EQUAL_ZERO(delta))
+			return;
+
+		//主轴、副轴的视口范围和缓冲下标分量
+		int major_min = steep ? m_RectangleView.y1 : m_RectangleView.x1;
+		int major_max = steep ? m_RectangleView.y2 : m_RectangleView.x2;
+		int minor_min = steep ? m_RectangleView.x1 : m_RectangleView.y1;
+		int minor_max = steep ? m_RectangleView.x2 : m_RectangleView.y2;
+		const int* major_offset = steep ? &m_PixelOffsetY[0] : &m_PixelOffsetX[0];
+		const int* minor_offset = steep ? &m_PixelOffsetX[0] : &m_PixelOffsetY[0];
+
+		//像素i的中心为i + 0.5，只绘制中心在线段范围内的像素，主轴在此裁剪
+		int i_begin = (int)ceil(x0 - 0.5f);
+		int i_end = (int)floor(x1 - 0.5f);
+		if (i_begin < major_min)
+			i_begin = major_min;
+		if (i_end > major_max - 1)
+			i_end = major_max - 1;
+
+		float minor_rate = (y1 - y0) / delta;
+		float z_reciprocal_rate = (z1 - z0) / delta;
+		//覆盖率c作用在混合结果上，即在背景与混合结果之间按c插值：前景参数乘以c，背景参数为1 - c * (1 - 背景参数)，
+		//不开启阿尔法混合时前景参数为1、背景参数为0
+		float foreground = (m_EnableRenderStateAlphaBlend ? m_ForegroundAlphaBlendValue : 1.0f) * 256.0f;
+		float background_complement = (m_EnableRenderStateAlphaBlend ? 1.0f - m_BackgroundAlphaBlendValue : 1.0f) * 256.0f;
+		for (int i = i_begin; i <= i_end; ++i)
+		{
+			float offset_major = i + 0.5f - x0;
+			float minor = y0 + offset_major * minor_rate - 0.5f;
+			float z_reciprocal = z0 + offset_major * z_reciprocal_rate;
+
+			//线段覆盖副轴上相邻两个像素，离线段越近覆盖率越大
+			int j = (int)minor;
+			if (minor < j)
+				--j;
+			float coverage1 = minor - j;
+			float coverage[2] = { 1.0f - coverage1, coverage1 };
+			for (int k = 0; k < 2; ++k)
+			{
+				//副轴在此裁剪
+				if (j + k < minor_min || j + k >= minor_max)
+					continue;
+
+				int offset = major_offset[i] + minor_offset[j + k];
+				if (m_EnableRenderStateDepthTest)
+				{
+					typename DEPTH::TYPE* depth_buffer = (typename DEPTH::TYPE*)m_pDepthBuffer;
+					typename DEPTH::TYPE depth = DEPTH::Convert(z_reciprocal, m_DepthScale, m_DepthBias);
+					if (!DEPTH::Less(depth_buffer[offset], depth))
+						continue;
+					if (coverage[k] >= 0.5f)
+						depth_buffer[offset] = depth;
+				}
+
+				//混合参数定点化为0~256，两个参数之和不超过256，红蓝两个通道一起计算
+				unsigned int alpha = (unsigned int)std::min(std::max((int)(coverage[k] * foreground), 0), 256);
+				unsigned int beta = (unsigned int)std::min(std::max(256 - (int)(coverage[k] * background_complement), 0), 256);
+				unsigned int background = (unsigned int)m_pVideoBuffer[offset];
+				unsigned int rb =
+					((background & 0x00ff00ff) * beta + ((unsigned int)color & 0x00ff00ff) * alpha) >> 8;
+				unsigned int g =
+					((background & 0x0000ff00) * beta + ((unsigned int)color & 0x0000ff00) * alpha) >> 8;
+				m_pVideoBuffer[offset] = (int)(0xff000000 | (rb & 0x00ff00ff) | (g & 0x0000ff00));
+			}
+		}
+	}
+
+	template <typename DEPTH>
+	void Render::Draw3DMeshSegmentRasterizeBatchAntiAlias(int color)
+	{
+		int segment_count = (int)m_pSegmentAfterNearPlaneClip->size();
+		for (int i = 0; i < segment_count; i += 2)
+		{
+			int i0 = m_pSegmentAfterNearPlaneClip->at(i);
+			int i1 = m_pSegmentAfterNearPlaneClip->at(i + 1);
+			if (0 != (m_SegmentVertex[i0].outcode & m_SegmentVertex[i1].outcode))
+				continue;
+
+			Draw3DMeshSegmentRasterizeAntiAlias<DEPTH>(&m_VertexInView[i0], &m_VertexInView[i1], color);
+		}
+	}
+
 	bool Render::IsLightWorldEnable()
 	{
 		int light_world_count = (int)m_LightWorld.size();
@@ -590,12 +1197,10 @@ namespace render {
 	}
 
 	void Render::IlluminationCompute(
-		const std::vector<vector3>* normal,
+		const vector3* normal,
+		int normal_count,
 		const vector3* eye)
 	{
-		//法线数量，也是顶点数量
-		int normal_count = (int)normal->size();
-
 		//颜色叠加环境光和自发光
 		m_ColorAfterIlluminationCompute.resize(normal_count);
 		for (int i = 0; i < normal_count; ++i)
@@ -612,7 +1217,7 @@ namespace render {
 			m_NormalInWorld.resize(normal_count);
 			for (int i = 0; i < normal_count; ++i)
 			{
-				Vec3MulMat4(&normal->at(i), &m_TransformWorld, &m_NormalInWorld[i]);
+				Vec3MulMat4(&normal[i], &m_TransformWorld, &m_NormalInWorld[i]);
 				m_NormalInWorld[i] -= m_VertexInWorld[i];
 				m_NormalInWorld[i] = m_NormalInWorld[i].Normalize();
 			}
@@ -646,7 +1251,7 @@ namespace render {
 									c = light_directory_negative.Dot(m_NormalInWorld[j]);
 
 									//夹角为锐角
-									if (_FLT_LESS_FLT(0.0f, c))
+									if (_ILLUMINATION_COSINE_MIN <= c)
 									{
 										//叠加定向光漫反射效果
 										m_ColorAfterIlluminationCompute[j] += 
@@ -670,7 +1275,7 @@ namespace render {
 									c = reflect.Dot(sight_negative);
 
 									//若夹角为锐角
-									if (_FLT_LESS_FLT(0.0f, c))
+									if (_ILLUMINATION_COSINE_MIN <= c)
 									{
 										//叠加定向光镜面反射效果
 										m_ColorAfterIlluminationCompute[j] += 
@@ -710,7 +1315,7 @@ namespace render {
 										c = light_directory_negative_normal.Dot(m_NormalInWorld[j]);
 
 										//夹角为锐角
-										if (_FLT_LESS_FLT(0.0f, c))
+										if (_ILLUMINATION_COSINE_MIN <= c)
 										{
 											//得到顶点到点光源的向量长度与点光源范围的比值
 											float ratio = 1.0f - light_directory_negative_length / m_LightWorld[i].light.radius;
@@ -737,7 +1342,7 @@ namespace render {
 										c = reflect.Dot(sight_negative);
 
 										//若夹角为锐角
-										if (_FLT_LESS_FLT(0.0f, c))
+										if (_ILLUMINATION_COSINE_MIN <= c)
 										{
 											//得到顶点到点光源的向量长度与点光源范围的比值
 											float ratio = 1.0f - light_directory_negative_length / m_LightWorld[i].light.radius;
@@ -781,7 +1386,7 @@ namespace render {
 									c = light_directory_negative.Dot(m_NormalInWorld[j]);
 
 									//夹角为锐角
-									if (_FLT_LESS_FLT(0.0f, c))
+									if (_ILLUMINATION_COSINE_MIN <= c)
 									{
 										//叠加定向光漫反射效果
 										m_ColorAfterIlluminationCompute[j] += 
@@ -820,7 +1425,7 @@ namespace render {
 										c = light_directory_negative_normal.Dot(m_NormalInWorld[j]);
 
 										//夹角为锐角
-										if (_FLT_LESS_FLT(0.0f, c))
+										if (_ILLUMINATION_COSINE_MIN <= c)
 										{
 											//得到顶点到点光源的向量长度与点光源范围的比值
 											float ratio = 1.0f - light_directory_negative_length / m_LightWorld[i].light.radius;
@@ -854,1209 +1459,472 @@ namespace render {
 		}
 	}
 
-	void Render::Draw3DMeshTriangleNearPlaneClip_ts0_ic0(
-		float sphere_radius,
-		const std::vector<int>* triangle_origin)
+	//截点属性插值，因为摄像机坐标系下面顶点属性与xyz都是线性关系，故有以下等式
+	//截面 - 大   截 - 大
+	//--------- = -------，其中temp为等式左边，大、小为截面内外两侧的点
+	//截面 - 小   截 - 小
+	//两点属性相等时直接取其中一点，equal_take_less表示取小点还是大点
+	static inline float ClipInterpolate(
+		float more,
+		float less,
+		float temp,
+		float temp_minus_1,
+		bool equal_take_less)
 	{
-		//得到摄像机坐标系下面包围球球心
-		vector3 center_camera = ComputerCenterInCamera();
+		if (_FLT_EQUAL_FLT(more, less))
+			return equal_take_less ? less : more;
 
-		//无需进行近截面裁剪
-		if (_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, center_camera.z - sphere_radius))
+		return (temp * less - more) / temp_minus_1;
+	}
+
+	bool Render::Draw3DMeshTriangleClip(
+		const float* plane,
+		bool near_plane,
+		int attribute_mask,
+		const std::vector<int>* triangle_in,
+		std::vector<int>* triangle_out)
+	{
+		//顶点分类：-1在截面外侧（小）、0在截面上（等）、1在截面内侧（大）
+		int vertex_count = (int)m_VertexInCamera.size();
+		m_VertexClipSide.resize(vertex_count);
+		for (int i = 0; i < vertex_count; ++i)
 		{
-			m_pTriangleAfterNearPlaneClip = triangle_origin;
-			return;
+			const vector3* vertex = &m_VertexInCamera[i];
+			float distance = plane[0] * vertex->x + plane[1] * vertex->y + plane[2] * vertex->z;
+			if (_FLT_LESS_FLT(distance, plane[3]))
+				m_VertexClipSide[i] = -1;
+			else if (_FLT_LESS_FLT(plane[3], distance))
+				m_VertexClipSide[i] = 1;
+			else
+				m_VertexClipSide[i] = 0;
 		}
 
-		//更新原始线段索引到更新线段索引
-		m_TriangleAfterNearPlaneClip.clear();
-		int triangle_count = (int)triangle_origin->size();
+		//统计裁剪之后的三角索引数量和截点数量
+		int triangle_count = (int)triangle_in->size();
+		const int* triangle = triangle_count > 0 ? &triangle_in->at(0) : NULL;
+		int index_count = 0;
+		int cut_vertex_count = 0;
+		for (int i = 0; i < triangle_count; i += 3)
+		{
+			int side[3] =
+			{
+				m_VertexClipSide[triangle[i]],
+				m_VertexClipSide[triangle[i + 1]],
+				m_VertexClipSide[triangle[i + 2]],
+			};
+
+			//三点同时小于等于截面：舍去
+			if (side[0] <= 0 && side[1] <= 0 && side[2] <= 0)
+				continue;
+
+			//三点同时大于等于截面：保留
+			if (side[0] >= 0 && side[1] >= 0 && side[2] >= 0)
+			{
+				index_count += 3;
+				continue;
+			}
+
+			//1点小2点大分成2个三角，2点小1点大剩1个三角，都有2个截点
+			int less_count = (-1 == side[0] ? 1 : 0) + (-1 == side[1] ? 1 : 0) + (-1 == side[2] ? 1 : 0);
+			index_count += 1 == less_count ? 6 : 3;
+			cut_vertex_count += 2;
+		}
+
+		//没有三角被裁剪或舍去
+		if (0 == cut_vertex_count && index_count == triangle_count)
+			return false;
+
+		//一次性扩大顶点表和三角索引表
+		int cut_vertex_index = vertex_count;
+		m_VertexInCamera.resize(vertex_count + cut_vertex_count);
+		if (attribute_mask & _CLIP_ATTRIBUTE_COLOR)
+			m_ColorAfterIlluminationCompute.resize(vertex_count + cut_vertex_count);
+		if (attribute_mask & _CLIP_ATTRIBUTE_TEXTURE)
+			m_TextureCopy.resize(vertex_count + cut_vertex_count);
+		triangle_out->resize(index_count);
+		int* triangle_result = index_count > 0 ? &triangle_out->at(0) : NULL;
+
 		for (int i = 0; i < triangle_count; i += 3)
 		{
 			//得到三角索引
 			int index[3] =
 			{
-				triangle_origin->at(i),
-				triangle_origin->at(i + 1),
-				triangle_origin->at(i + 2),
+				triangle[i],
+				triangle[i + 1],
+				triangle[i + 2],
 			};
-
-			//得到顶点
-			vector3* vertex[3] =
+			int side[3] =
 			{
-				&m_VertexInCamera[index[0]],
-				&m_VertexInCamera[index[1]],
-				&m_VertexInCamera[index[2]],
+				m_VertexClipSide[index[0]],
+				m_VertexClipSide[index[1]],
+				m_VertexClipSide[index[2]],
 			};
 
-			//三点的z值同时小于等于近截面，4种情况：3点小、2点小1点等、1点小2点等、3点等
-			if (_FLT_LESS_EQUAL_FLT(vertex[0]->z, m_NearPlaneZInCamera) &&
-				_FLT_LESS_EQUAL_FLT(vertex[1]->z, m_NearPlaneZInCamera) &&
-				_FLT_LESS_EQUAL_FLT(vertex[2]->z, m_NearPlaneZInCamera))
+			if (side[0] <= 0 && side[1] <= 0 && side[2] <= 0)
+				continue;
+
+			if (side[0] >= 0 && side[1] >= 0 && side[2] >= 0)
+			{
+				*triangle_result++ = index[0];
+				*triangle_result++ = index[1];
+				*triangle_result++ = index[2];
+				continue;
+			}
+
+			//2种情况：1点小2点大、2点小1点大，得到每个截点所在边的大点、小点下标，
+			//1点小时属性相等取小点，2点小时属性相等取大点
+			int less_count = (-1 == side[0] ? 1 : 0) + (-1 == side[1] ? 1 : 0) + (-1 == side[2] ? 1 : 0);
+			int first = -1;
+			for (int j = 0; j < 3 && -1 == first; ++j)
 			{
-				//不放入更新三角索引
+				if ((1 == less_count && -1 == side[j]) || (2 == less_count && 1 == side[j]))
+					first = j;
 			}
-			//三点的z值同时大于等于近截面，3种情况：3点大、2点大1点等、1点大2点等
-			else if (_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, vertex[0]->z) &&
-					 _FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, vertex[1]->z) &&
-					 _FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, vertex[2]->z))
+			int second = first == 2 ? 0 : first + 1;
+			int third = second == 2 ? 0 : second + 1;
+			int edge_more[2];
+			int edge_less[2];
+			bool equal_take_less = 1 == less_count;
+			if (1 == less_count)
 			{
-				//放入更新线段索引
-				m_TriangleAfterNearPlaneClip.push_back(index[0]);
-				m_TriangleAfterNearPlaneClip.push_back(index[1]);
-				m_TriangleAfterNearPlaneClip.push_back(index[2]);
+				edge_more[0] = index[second];
+				edge_more[1] = index[third];
+				edge_less[0] = index[first];
+				edge_less[1] = index[first];
 			}
-			//2种情况：1点小2点大、2点小1点大
 			else
 			{
-				//得到具体情况
-				int less_near_count =
-					(_FLT_LESS_FLT(vertex[0]->z, m_NearPlaneZInCamera) ? 1 : 0) +
-					(_FLT_LESS_FLT(vertex[1]->z, m_NearPlaneZInCamera) ? 1 : 0) +
-					(_FLT_LESS_FLT(vertex[2]->z, m_NearPlaneZInCamera) ? 1 : 0);
+				edge_more[0] = index[first];
+				edge_more[1] = index[first];
+				edge_less[0] = index[second];
+				edge_less[1] = index[third];
+			}
 
-				//1点小2点大
-				if (1 == less_near_count)
+			//计算截点并写入顶点表
+			for (int j = 0; j < 2; ++j)
+			{
+				const vector3* more_vertex = &m_VertexInCamera[edge_more[j]];
+				const vector3* less_vertex = &m_VertexInCamera[edge_less[j]];
+				float more_distance = plane[0] * more_vertex->x + plane[1] * more_vertex->y + plane[2] * more_vertex->z;
+				float less_distance = plane[0] * less_vertex->x + plane[1] * less_vertex->y + plane[2] * less_vertex->z;
+				float temp = (plane[3] - more_distance) / (plane[3] - less_distance);
+				float temp_minus_1 = temp - 1.0f;
+
+				vector3* cut_vertex = &m_VertexInCamera[cut_vertex_index + j];
+				cut_vertex->x = ClipInterpolate(more_vertex->x, less_vertex->x, temp, temp_minus_1, equal_take_less);
+				cut_vertex->y = ClipInterpolate(more_vertex->y, less_vertex->y, temp, temp_minus_1, equal_take_less);
+				cut_vertex->z = near_plane ?
+					plane[3] :
+					ClipInterpolate(more_vertex->z, less_vertex->z, temp, temp_minus_1, equal_take_less);
+
+				if (attribute_mask & _CLIP_ATTRIBUTE_COLOR)
 				{
-					//得到2大点和1小点的下标
-					int more_index[2] = {-1, -1};
-					int less_index = -1;
-					if (_FLT_LESS_FLT(vertex[0]->z, m_NearPlaneZInCamera))
-					{
-						less_index = 0;
-						more_index[0] = 1;
-						more_index[1] = 2;
-					}
-					else if (_FLT_LESS_FLT(vertex[1]->z, m_NearPlaneZInCamera))
-					{
-						less_index = 1;
-						more_index[0] = 2;
-						more_index[1] = 0;
-					}
-					else
-					{
-						less_index = 2;
-						more_index[0] = 0;
-						more_index[1] = 1;
-					}
-
-					//得到2大点和1小点
-					vector3* less_vertex = vertex[less_index];
-					vector3* more_vertex[2] =
-					{
-						vertex[more_index[0]],
-						vertex[more_index[1]],
-					};
-
-					//计算截点xy坐标，因为摄像机坐标系下面任意顶点的xyz都是线性关系，故有以下等式
-					//m_CoordinateCameraNearPlane - 大->z   截->x - 大->x   截->y - 大->y
-					//----------------------------------- = ------------- = -------------
-					//m_CoordinateCameraNearPlane - 小->z   截->x - 小->x   截->y - 小->y
-					vector3 cut_vertex[2] =
-					{
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-					};
-					float temp[2] =
-					{
-						(cut_vertex[0].z - more_vertex[0]->z) / (cut_vertex[0].z - less_vertex->z),
-						(cut_vertex[1].z - more_vertex[1]->z) / (cut_vertex[1].z - less_vertex->z),
-					};
-					float temp_minus_1[2] =
-					{
-						temp[0] - 1.0f,
-						temp[1] - 1.0f,
-					};
-					cut_vertex[0].x =
-						_FLT_EQUAL_FLT(more_vertex[0]->x, less_vertex->x) ? less_vertex->x : (temp[0] * less_vertex->x - more_vertex[0]->x) / temp_minus_1[0];
-					cut_vertex[0].y =
-						_FLT_EQUAL_FLT(more_vertex[0]->y, less_vertex->y) ? less_vertex->y : (temp[0] * less_vertex->y - more_vertex[0]->y) / temp_minus_1[0];
-					cut_vertex[1].x =
-						_FLT_EQUAL_FLT(more_vertex[1]->x, less_vertex->x) ? less_vertex->x : (temp[1] * less_vertex->x - more_vertex[1]->x) / temp_minus_1[1];
-					cut_vertex[1].y =
-						_FLT_EQUAL_FLT(more_vertex[1]->y, less_vertex->y) ? less_vertex->y : (temp[1] * less_vertex->y - more_vertex[1]->y) / temp_minus_1[1];
-
-					//新点入表并得到下标
-					int cut_vertex_index[2] = { -1, -1 };
-					m_VertexInCamera.push_back(cut_vertex[0]);
-					cut_vertex_index[0] = (int)m_VertexInCamera.size() - 1;
-					m_VertexInCamera.push_back(cut_vertex[1]);
-					cut_vertex_index[1] = (int)m_VertexInCamera.size() - 1;
-
-					//得到2个新三角索引
-					int cut_triangle_index[2][3] =
-					{
-						{
-							index[0],
-							index[1],
-							index[2],
-						},
-						{
-							index[0],
-							index[1],
-							index[2],
-						},
-					};
-					//新三角索引0：保留2大点的索引，加入1截点索引
-					cut_triangle_index[0][less_index] = cut_vertex_index[0];
-					//新三角索引1：保留1大点的索引，加入2截点索引
-					cut_triangle_index[1][more_index[0]] = cut_vertex_index[0];
-					cut_triangle_index[1][less_index] = cut_vertex_index[1];
-
-					//放入更新线段索引
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0][0]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0][1]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0][2]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1][0]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1][1]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1][2]);
+					const vector3* more_color = &m_ColorAfterIlluminationCompute[edge_more[j]];
+					const vector3* less_color = &m_ColorAfterIlluminationCompute[edge_less[j]];
+					vector3* cut_color = &m_ColorAfterIlluminationCompute[cut_vertex_index + j];
+					cut_color->x = ClipInterpolate(more_color->x, less_color->x, temp, temp_minus_1, equal_take_less);
+					cut_color->y = ClipInterpolate(more_color->y, less_color->y, temp, temp_minus_1, equal_take_less);
+					cut_color->z = ClipInterpolate(more_color->z, less_color->z, temp, temp_minus_1, equal_take_less);
 				}
-				//2点小1点大
-				else
-				{
-					//得到1大点和2小点的下标
-					int more_index = -1;
-					int less_index[2] = {-1, -1};
-					if (_FLT_LESS_FLT(m_NearPlaneZInCamera, vertex[0]->z))
-					{
-						more_index = 0;
-						less_index[0] = 1;
-						less_index[1] = 2;
-					}
-					else if (_FLT_LESS_FLT(m_NearPlaneZInCamera, vertex[1]->z))
-					{
-						more_index = 1;
-						less_index[0] = 2;
-						less_index[1] = 0;
-					}
-					else
-					{
-						more_index = 2;
-						less_index[0] = 0;
-						less_index[1] = 1;
-					}
 
-					//得到1大点和2小点
-					vector3* more_vertex = vertex[more_index];
-					vector3* less_vertex[2] =
-					{
-						vertex[less_index[0]],
-						vertex[less_index[1]],
-					};
-
-					//计算截点xy坐标，因为摄像机坐标系下面任意顶点的xyz都是线性关系，故有以下等式
-					//m_CoordinateCameraNearPlane - 大->z   截->x - 大->x   截->y - 大->y
-					//----------------------------------- = ------------- = -------------
-					//m_CoordinateCameraNearPlane - 小->z   截->x - 小->x   截->y - 小->y
-					vector3 cut_vertex[2] =
-					{
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-					};
-					float temp[2] =
-					{
-						(cut_vertex[0].z - more_vertex->z) / (cut_vertex[0].z - less_vertex[0]->z),
-						(cut_vertex[1].z - more_vertex->z) / (cut_vertex[1].z - less_vertex[1]->z),
-					};
-					float temp_minus_1[2] =
-					{
-						temp[0] - 1.0f,
-						temp[1] - 1.0f,
-					};
-					cut_vertex[0].x = 
-						_FLT_EQUAL_FLT(more_vertex->x, less_vertex[0]->x) ? more_vertex->x : (temp[0] * less_vertex[0]->x - more_vertex->x) / temp_minus_1[0];
-					cut_vertex[0].y =
-						_FLT_EQUAL_FLT(more_vertex->y, less_vertex[0]->y) ? more_vertex->y : (temp[0] * less_vertex[0]->y - more_vertex->y) / temp_minus_1[0];
-					cut_vertex[1].x =
-						_FLT_EQUAL_FLT(more_vertex->x, less_vertex[1]->x) ? more_vertex->x : (temp[1] * less_vertex[1]->x - more_vertex->x) / temp_minus_1[1];
-					cut_vertex[1].y =
-						_FLT_EQUAL_FLT(more_vertex->y, less_vertex[1]->y) ? more_vertex->y : (temp[1] * less_vertex[1]->y - more_vertex->y) / temp_minus_1[1];
-
-					//新点入表并得到下标
-					int cut_vertex_index[2] = { -1, -1 };
-					m_VertexInCamera.push_back(cut_vertex[0]);
-					cut_vertex_index[0] = (int)m_VertexInCamera.size() - 1;
-					m_VertexInCamera.push_back(cut_vertex[1]);
-					cut_vertex_index[1] = (int)m_VertexInCamera.size() - 1;
-
-					//得到1个新三角索引
-					int cut_triangle_index[3] =
-					{
-						index[0],
-						index[1],
-						index[2],
-					};
-					//新三角索引：保留1大点的索引，加入2截点索引
-					cut_triangle_index[less_index[0]] = cut_vertex_index[0];
-					cut_triangle_index[less_index[1]] = cut_vertex_index[1];
-
-					//放入更新线段索引
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[2]);
+				if (attribute_mask & _CLIP_ATTRIBUTE_TEXTURE)
+				{
+					const vector2* more_texture = &m_TextureCopy[edge_more[j]];
+					const vector2* less_texture = &m_TextureCopy[edge_less[j]];
+					vector2* cut_texture = &m_TextureCopy[cut_vertex_index + j];
+					cut_texture->x = ClipInterpolate(more_texture->x, less_texture->x, temp, temp_minus_1, equal_take_less);
+					cut_texture->y = ClipInterpolate(more_texture->y, less_texture->y, temp, temp_minus_1, equal_take_less);
 				}
 			}
+
+			//写入新三角索引，保持原三角的顶点顺序
+			if (1 == less_count)
+			{
+				//新三角索引0：保留2大点的索引，加入1截点索引
+				int cut_triangle_index[3] = { index[0], index[1], index[2] };
+				cut_triangle_index[first] = cut_vertex_index;
+				*triangle_result++ = cut_triangle_index[0];
+				*triangle_result++ = cut_triangle_index[1];
+				*triangle_result++ = cut_triangle_index[2];
+
+				//新三角索引1：保留1大点的索引，加入2截点索引
+				cut_triangle_index[first] = cut_vertex_index + 1;
+				cut_triangle_index[second] = cut_vertex_index;
+				*triangle_result++ = cut_triangle_index[0];
+				*triangle_result++ = cut_triangle_index[1];
+				*triangle_result++ = cut_triangle_index[2];
+			}
+			else
+			{
+				//新三角索引：保留1大点的索引，加入2截点索引
+				int cut_triangle_index[3] = { index[0], index[1], index[2] };
+				cut_triangle_index[second] = cut_vertex_index;
+				cut_triangle_index[third] = cut_vertex_index + 1;
+				*triangle_result++ = cut_triangle_index[0];
+				*triangle_result++ = cut_triangle_index[1];
+				*triangle_result++ = cut_triangle_index[2];
+			}
+
+			cut_vertex_index += 2;
 		}
 
-		m_pTriangleAfterNearPlaneClip = &m_TriangleAfterNearPlaneClip;
+		return true;
 	}
 
-	void Render::Draw3DMeshTriangleNearPlaneClip_ts0_ic1(
+	void Render::Draw3DMeshTriangleNearPlaneClip(
 		float sphere_radius,
-		const std::vector<int>* triangle_origin)
+		const std::vector<int>* triangle_origin,
+		int attribute_mask)
 	{
 		//得到摄像机坐标系下面包围球球心
 		vector3 center_camera = ComputerCenterInCamera();
 
-		//无需进行近截面裁剪
-		if (_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, center_camera.z - sphere_radius))
+		//截面：ax+by+cz>=d为内侧，依次为近截面和左右下上保护带截面，
+		//保护带截面只有在三角超出投影坐标系下|x|、|y|<=_GUARD_BAND_SCALE时才会实际裁剪
+		const float plane[_CLIP_PLANE_COUNT][4] =
 		{
-			m_pTriangleAfterNearPlaneClip = triangle_origin;
-			return;
-		}
+			{ 0.0f, 0.0f, 1.0f, m_NearPlaneZInCamera },
+			{ 1.0f, 0.0f, _GUARD_BAND_SCALE, 0.0f },
+			{ -1.0f, 0.0f, _GUARD_BAND_SCALE, 0.0f },
+			{ 0.0f, 1.0f, _GUARD_BAND_SCALE, 0.0f },
+			{ 0.0f, -1.0f, _GUARD_BAND_SCALE, 0.0f },
+		};
+		const float plane_length[_CLIP_PLANE_COUNT] =
+		{
+			1.0f,
+			sqrt(1.0f + _GUARD_BAND_SCALE * _GUARD_BAND_SCALE),
+			sqrt(1.0f + _GUARD_BAND_SCALE * _GUARD_BAND_SCALE),
+			sqrt(1.0f + _GUARD_BAND_SCALE * _GUARD_BAND_SCALE),
+			sqrt(1.0f + _GUARD_BAND_SCALE * _GUARD_BAND_SCALE),
+		};
 
-		//更新原始线段索引到更新线段索引
-		m_TriangleAfterNearPlaneClip.clear();
-		int triangle_count = (int)triangle_origin->size();
-		for (int i = 0; i < triangle_count; i += 3)
+		//依次裁剪，结果在两个三角索引表之间交替
+		const std::vector<int>* triangle = triangle_origin;
+		for (int i = 0; i < _CLIP_PLANE_COUNT; ++i)
 		{
-			//得到三角索引
-			int index[3] =
-			{
-				triangle_origin->at(i),
-				triangle_origin->at(i + 1),
-				triangle_origin->at(i + 2),
-			};
+			//包围球完全在截面内侧，无需裁剪
+			float center_distance =
+				plane[i][0] * center_camera.x +
+				plane[i][1] * center_camera.y +
+				plane[i][2] * center_camera.z;
+			if (_FLT_LESS_EQUAL_FLT(plane[i][3], center_distance - sphere_radius * plane_length[i]))
+				continue;
+
+			std::vector<int>* triangle_out =
+				triangle == &m_TriangleAfterNearPlaneClip ? &m_TriangleClipSwap : &m_TriangleAfterNearPlaneClip;
+			if (Draw3DMeshTriangleClip(plane[i], _CLIP_PLANE_NEAR == i, attribute_mask, triangle, triangle_out))
+				triangle = triangle_out;
+		}
 
-			//得到顶点
-			vector3* vertex[3] =
-			{
-				&m_VertexInCamera[index[0]],
-				&m_VertexInCamera[index[1]],
-				&m_VertexInCamera[index[2]],
-			};
+		m_pTriangleAfterNearPlaneClip = triangle;
+
+		//有效顶点位表，总是按裁剪之后的三角索引表标记，没有被引用的顶点即使没有被裁剪也可能在近截面之前，
+		//网格的顶点都被引用时整字有效，仍然连续遍历
+		int vertex_count = (int)m_VertexInCamera.size();
+		int word_count = (vertex_count + 31) >> 5;
+		m_VertexValidMask.resize(word_count);
+		for (int i = 0; i < word_count; ++i)
+			m_VertexValidMask[i] = 0;
+		int index_count = (int)triangle->size();
+		const int* index = index_count > 0 ? &triangle->at(0) : NULL;
+		for (int i = 0; i < index_count; ++i)
+			m_VertexValidMask[index[i] >> 5] |= 1u << (index[i] & 31);
+	}
 
-			//得到颜色
-			vector3* color[3] =
-			{
-				&m_ColorAfterIlluminationCompute[index[0]],
-				&m_ColorAfterIlluminationCompute[index[1]],
-				&m_ColorAfterIlluminationCompute[index[2]],
-			};
+	const MESH_TRIANGLE* Render::Draw3DMeshTriangleSelectLod(const MESH_TRIANGLE* mesh_triangle)
+	{
+		int lod_count = (int)mesh_triangle->lod.size();
+		if (0 == lod_count || m_LodPixelError <= 0.0f || mesh_triangle->radius <= 0.0f)
+			return mesh_triangle;
 
-			//三点的z值同时小于等于近截面，4种情况：3点小、2点小1点等、1点小2点等、3点等
-			if (_FLT_LESS_EQUAL_FLT(vertex[0]->z, m_NearPlaneZInCamera) &&
-				_FLT_LESS_EQUAL_FLT(vertex[1]->z, m_NearPlaneZInCamera) &&
-				_FLT_LESS_EQUAL_FLT(vertex[2]->z, m_NearPlaneZInCamera))
-			{
-				//不放入更新三角索引
-			}
-			//三点的z值同时大于等于近截面，3种情况：3点大、2点大1点等、1点大2点等
-			else if (
-				_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, vertex[0]->z) &&
-				_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, vertex[1]->z) &&
-				_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, vertex[2]->z))
-			{
-				//放入更新线段索引
-				m_TriangleAfterNearPlaneClip.push_back(index[0]);
-				m_TriangleAfterNearPlaneClip.push_back(index[1]);
-				m_TriangleAfterNearPlaneClip.push_back(index[2]);
-			}
-			//2种情况：1点小2点大、2点小1点大
-			else
-			{
-				//得到具体情况
-				int less_near_count =
-					(_FLT_LESS_FLT(vertex[0]->z, m_NearPlaneZInCamera) ? 1 : 0) +
-					(_FLT_LESS_FLT(vertex[1]->z, m_NearPlaneZInCamera) ? 1 : 0) +
-					(_FLT_LESS_FLT(vertex[2]->z, m_NearPlaneZInCamera) ? 1 : 0);
-
-				//1点小2点大
-				if (1 == less_near_count)
-				{
-					//得到2大点和1小点的下标
-					int more_index[2] = {-1, -1};
-					int less_index = -1;
-					if (_FLT_LESS_FLT(vertex[0]->z, m_NearPlaneZInCamera))
-					{
-						less_index = 0;
-						more_index[0] = 1;
-						more_index[1] = 2;
-					}
-					else if (_FLT_LESS_FLT(vertex[1]->z, m_NearPlaneZInCamera))
-					{
-						less_index = 1;
-						more_index[0] = 2;
-						more_index[1] = 0;
-					}
-					else
-					{
-						less_index = 2;
-						more_index[0] = 0;
-						more_index[1] = 1;
-					}
-
-					//得到2大点和1小点，及其颜色
-					vector3* less_vertex = vertex[less_index];
-					vector3* more_vertex[2] =
-					{
-						vertex[more_index[0]],
-						vertex[more_index[1]],
-					};
-					vector3* less_color = color[less_index];
-					vector3* more_color[2] =
-					{
-						color[more_index[0]],
-						color[more_index[1]],
-					};
-
-					//计算截点xy坐标，因为摄像机坐标系下面任意顶点的xyz都是线性关系，故有以下等式
-					//m_CoordinateCameraNearPlane - 大->z   截->x - 大->x   截->y - 大->y
-					//----------------------------------- = ------------- = -------------
-					//m_CoordinateCameraNearPlane - 小->z   截->x - 小->x   截->y - 小->y
-					vector3 cut_vertex[2] =
-					{
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-					};
-					vector3 cut_color[2] =
-					{
-						vector3(0.0f, 0.0f, 0.0f),
-						vector3(0.0f, 0.0f, 0.0f),
-					};
-					float temp[2] =
-					{
-						(cut_vertex[0].z - more_vertex[0]->z) / (cut_vertex[0].z - less_vertex->z),
-						(cut_vertex[1].z - more_vertex[1]->z) / (cut_vertex[1].z - less_vertex->z),
-					};
-					float temp_minus_1[2] =
-					{
-						temp[0] - 1.0f,
-						temp[1] - 1.0f,
-					};
-					cut_vertex[0].x =
-						_FLT_EQUAL_FLT(more_vertex[0]->x, less_vertex->x) ? less_vertex->x : (temp[0] * less_vertex->x - more_vertex[0]->x) / temp_minus_1[0];
-					cut_vertex[0].y =
-						_FLT_EQUAL_FLT(more_vertex[0]->y, less_vertex->y) ? less_vertex->y : (temp[0] * less_vertex->y - more_vertex[0]->y) / temp_minus_1[0];
-					cut_color[0].x =
-						_FLT_EQUAL_FLT(more_color[0]->x, less_color->x) ? less_color->x : (temp[0] * less_color->x - more_color[0]->x) / temp_minus_1[0];
-					cut_color[0].y =
-						_FLT_EQUAL_FLT(more_color[0]->y, less_color->y) ? less_color->y : (temp[0] * less_color->y - more_color[0]->y) / temp_minus_1[0];
-					cut_color[0].z =
-						_FLT_EQUAL_FLT(more_color[0]->z, less_color->z) ? less_color->z : (temp[0] * less_color->z - more_color[0]->z) / temp_minus_1[0];
-					cut_vertex[1].x =
-						_FLT_EQUAL_FLT(more_vertex[1]->x, less_vertex->x) ? less_vertex->x : (temp[1] * less_vertex->x - more_vertex[1]->x) / temp_minus_1[1];
-					cut_vertex[1].y =
-						_FLT_EQUAL_FLT(more_vertex[1]->y, less_vertex->y) ? less_vertex->y : (temp[1] * less_vertex->y - more_vertex[1]->y) / temp_minus_1[1];
-					cut_color[1].x =
-						_FLT_EQUAL_FLT(more_color[1]->x, less_color->x) ? less_color->x : (temp[1] * less_color->x - more_color[1]->x) / temp_minus_1[1];
-					cut_color[1].y =
-						_FLT_EQUAL_FLT(more_color[1]->y, less_color->y) ? less_color->y : (temp[1] * less_color->y - more_color[1]->y) / temp_minus_1[1];
-					cut_color[1].z =
-						_FLT_EQUAL_FLT(more_color[1]->z, less_color->z) ? less_color->z : (temp[1] * less_color->z - more_color[1]->z) / temp_minus_1[1];
-					
-					//新点入表并得到下标
-					int cut_vertex_index[2] = { -1, -1 };
-					m_VertexInCamera.push_back(cut_vertex[0]);
-					m_ColorAfterIlluminationCompute.push_back(cut_color[0]);
-					cut_vertex_index[0] = (int)m_VertexInCamera.size() - 1;
-					m_VertexInCamera.push_back(cut_vertex[1]);
-					m_ColorAfterIlluminationCompute.push_back(cut_color[1]);
-					cut_vertex_index[1] = (int)m_VertexInCamera.size() - 1;
-
-					//得到2个新三角索引
-					int cut_triangle_index[2][3] =
-					{
-						{
-							index[0],
-							index[1],
-							index[2],
-						},
-						{
-							index[0],
-							index[1],
-							index[2],
-						},
-					};
-					//新三角索引0：保留2大点的索引，加入1截点索引
-					cut_triangle_index[0][less_index] = cut_vertex_index[0];
-					//新三角索引1：保留1大点的索引，加入2截点索引
-					cut_triangle_index[1][more_index[0]] = cut_vertex_index[0];
-					cut_triangle_index[1][less_index] = cut_vertex_index[1];
-
-					//放入更新线段索引
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0][0]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0][1]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0][2]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1][0]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1][1]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1][2]);
-				}
-				//2点小1点大
-				else
-				{
-					//得到1大点和2小点的下标
-					int more_index = -1;
-					int less_index[2] = {-1, -1};
-					if (_FLT_LESS_FLT(m_NearPlaneZInCamera, vertex[0]->z))
-					{
-						more_index = 0;
-						less_index[0] = 1;
-						less_index[1] = 2;
-					}
-					else if (_FLT_LESS_FLT(m_NearPlaneZInCamera, vertex[1]->z))
-					{
-						more_index = 1;
-						less_index[0] = 2;
-						less_index[1] = 0;
-					}
-					else
-					{
-						more_index = 2;
-						less_index[0] = 0;
-						less_index[1] = 1;
-					}
-
-					//得到1大点和2小点，及其颜色
-					vector3* more_vertex = vertex[more_index];
-					vector3* less_vertex[2] =
-					{
-						vertex[less_index[0]],
-						vertex[less_index[1]],
-					};
-					vector3* more_color = color[more_index];
-					vector3* less_color[2] =
-					{
-						color[less_index[0]],
-						color[less_index[1]],
-					};
-
-					//计算截点xy坐标，因为摄像机坐标系下面任意顶点的xyz都是线性关系，故有以下等式
-					//m_CoordinateCameraNearPlane - 大->z   截->x - 大->x   截->y - 大->y
-					//----------------------------------- = ------------- = -------------
-					//m_CoordinateCameraNearPlane - 小->z   截->x - 小->x   截->y - 小->y
-					vector3 cut_vertex[2] =
-					{
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-					};
-					vector3 cut_color[2] =
-					{
-						vector3(0.0f, 0.0f, 0.0f),
-						vector3(0.0f, 0.0f, 0.0f),
-					};
-					float temp[2] =
-					{
-						(cut_vertex[0].z - more_vertex->z) / (cut_vertex[0].z - less_vertex[0]->z),
-						(cut_vertex[1].z - more_vertex->z) / (cut_vertex[1].z - less_vertex[1]->z),
-					};
-					float temp_minus_1[2] =
-					{
-						temp[0] - 1.0f,
-						temp[1] - 1.0f,
-					};
-					cut_vertex[0].x = 
-						_FLT_EQUAL_FLT(more_vertex->x, less_vertex[0]->x) ? more_vertex->x : (temp[0] * less_vertex[0]->x - more_vertex->x) / temp_minus_1[0];
-					cut_vertex[0].y =
-						_FLT_EQUAL_FLT(more_vertex->y, less_vertex[0]->y) ? more_vertex->y : (temp[0] * less_vertex[0]->y - more_vertex->y) / temp_minus_1[0];
-					cut_color[0].x =
-						_FLT_EQUAL_FLT(more_color->x, less_color[0]->x) ? more_color->x : (temp[0] * less_color[0]->x - more_color->x) / temp_minus_1[0];
-					cut_color[0].y =
-						_FLT_EQUAL_FLT(more_color->y, less_color[0]->y) ? more_color->y : (temp[0] * less_color[0]->y - more_color->y) / temp_minus_1[0];
-					cut_color[0].z =
-						_FLT_EQUAL_FLT(more_color->z, less_color[0]->z) ? more_color->z : (temp[0] * less_color[0]->z - more_color->z) / temp_minus_1[0];
-					cut_vertex[1].x =
-						_FLT_EQUAL_FLT(more_vertex->x, less_vertex[1]->x) ? more_vertex->x : (temp[1] * less_vertex[1]->x - more_vertex->x) / temp_minus_1[1];
-					cut_vertex[1].y =
-						_FLT_EQUAL_FLT(more_vertex->y, less_vertex[1]->y) ? more_vertex->y : (temp[1] * less_vertex[1]->y - more_vertex->y) / temp_minus_1[1];
-					cut_color[1].x =
-						_FLT_EQUAL_FLT(more_color->x, less_color[1]->x) ? more_color->x : (temp[1] * less_color[1]->x - more_color->x) / temp_minus_1[1];
-					cut_color[1].y =
-						_FLT_EQUAL_FLT(more_color->y, less_color[1]->y) ? more_color->y : (temp[1] * less_color[1]->y - more_color->y) / temp_minus_1[1];
-					cut_color[1].z =
-						_FLT_EQUAL_FLT(more_color->z, less_color[1]->z) ? more_color->z : (temp[1] * less_color[1]->z - more_color->z) / temp_minus_1[1];
-
-					//新点入表并得到下标
-					int cut_vertex_index[2] = { -1, -1 };
-					m_VertexInCamera.push_back(cut_vertex[0]);
-					m_ColorAfterIlluminationCompute.push_back(cut_color[0]);
-					cut_vertex_index[0] = (int)m_VertexInCamera.size() - 1;
-					m_VertexInCamera.push_back(cut_vertex[1]);
-					m_ColorAfterIlluminationCompute.push_back(cut_color[1]);
-					cut_vertex_index[1] = (int)m_VertexInCamera.size() - 1;
-
-					//得到1个新三角索引
-					int cut_triangle_index[3] =
-					{
-						index[0],
-						index[1],
-						index[2],
-					};
-					//新三角索引：保留1大点的索引，加入2截点索引
-					cut_triangle_index[less_index[0]] = cut_vertex_index[0];
-					cut_triangle_index[less_index[1]] = cut_vertex_index[1];
-
-					//放入更新线段索引
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[2]);
-				}
-			}
+		//摄像机坐标系下包围球最近点距离
+		vector3 center_in_world;
+		vector3 center_in_camera;
+		float radius_in_world;
+		ComputeWorldShpere(&m_TransformWorld, mesh_triangle->radius, &center_in_world, &radius_in_world);
+		Vec3MulMat4(&center_in_world, &m_TransformCamera, &center_in_camera);
+		float distance = center_in_camera.z - radius_in_world;
+		if (distance <= m_NearPlaneZInCamera)
+			return mesh_triangle;
+
+		//本地坐标系长度到屏幕像素数
+		float scale = radius_in_world / mesh_triangle->radius;
+		float pixel_scale =
+			scale *
+			std::max(fabs(m_TransformView.e[_M4_11]), fabs(m_TransformView.e[_M4_22])) /
+			distance;
+
+		//误差逐级增大，从最粗一级向前找
+		for (int i = lod_count - 1; i >= 0; --i)
+		{
+			if (mesh_triangle->lod[i].error * pixel_scale <= m_LodPixelError)
+				return mesh_triangle->lod[i].mesh_triangle;
 		}
 
-		m_pTriangleAfterNearPlaneClip = &m_TriangleAfterNearPlaneClip;
+		return mesh_triangle;
 	}
-	void Render::Draw3DMeshTriangleNearPlaneClip_ts1_ic0(
-		float sphere_radius,
-		const std::vector<int>* triangle_origin)
-	{
-		//得到摄像机坐标系下面包围球球心
-		vector3 center_camera = ComputerCenterInCamera();
 
-		//无需进行近截面裁剪
-		if (_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, center_camera.z - sphere_radius))
+	const std::vector<int>* Render::Draw3DMeshTriangleMeshletCulling(const MESH_TRIANGLE* mesh_triangle)
+	{
+		int meshlet_count = (int)mesh_triangle->meshlet.size();
+		if (0 == meshlet_count)
+			return &mesh_triangle->triangle;
+
+		//本地坐标系到摄像机坐标系，包围球半径按最大轴缩放
+		matrix4 transform;
+		Mat4MulMat4(&m_TransformWorld, &m_TransformCamera, &transform);
+		vector3 axis[3] =
 		{
-			m_pTriangleAfterNearPlaneClip = triangle_origin;
-			return;
+			vector3(transform.e[_M4_11], transform.e[_M4_12], transform.e[_M4_13]),
+			vector3(transform.e[_M4_21], transform.e[_M4_22], transform.e[_M4_23]),
+			vector3(transform.e[_M4_31], transform.e[_M4_32], transform.e[_M4_33]),
+		};
+		vector3 translate(transform.e[_M4_41], transform.e[_M4_42], transform.e[_M4_43]);
+		float scale = std::max(std::max(axis[0].Length(), axis[1].Length()), axis[2].Length());
+
+		//法线锥拣选在本地坐标系下进行：摄像机在本地坐标系的位置eye满足eye*axis+translate=0，按克莱姆法则求解，
+		//摄像机坐标系下三角的三点行列式等于本地坐标系下相对eye的三点行列式乘以det，det为负时环绕方向翻转，
+		//背面拣选舍去行列式为正的三角，面法线n与视线v=顶点-eye满足sign*n.v>0即被拣选
+		vector3 axis12 = axis[1].Cross(axis[2]);
+		vector3 axis20 = axis[2].Cross(axis[0]);
+		vector3 axis01 = axis[0].Cross(axis[1]);
+		float det = axis[0].Dot(axis12);
+		bool cone_enable = m_EnableRenderStateFaceCulling && 0.0f != det;
+		vector3 eye;
+		float cone_sign = 0.0f;
+		if (cone_enable)
+		{
+			eye.Set(-translate.Dot(axis12) / det, -translate.Dot(axis20) / det, -translate.Dot(axis01) / det);
+			cone_sign = (det < 0.0f ? -1.0f : 1.0f) * (m_FaceCullingBack ? 1.0f : -1.0f);
 		}
 
-		//更新原始线段索引到更新线段索引
-		m_TriangleAfterNearPlaneClip.clear();
-		int triangle_count = (int)triangle_origin->size();
-		for (int i = 0; i < triangle_count; i += 3)
+		//簇按顺序连续，第一次舍去时才复制之前的三角，没有舍去时不复制
+		const std::vector<int>* triangle = &mesh_triangle->triangle;
+		bool culled = false;
+		for (int i = 0; i < meshlet_count; ++i)
 		{
-			//得到三角索引
-			int index[3] =
-			{
-				triangle_origin->at(i),
-				triangle_origin->at(i + 1),
-				triangle_origin->at(i + 2),
-			};
-
-			//得到顶点
-			vector3* vertex[3] =
-			{
-				&m_VertexInCamera[index[0]],
-				&m_VertexInCamera[index[1]],
-				&m_VertexInCamera[index[2]],
-			};
+			const MESH_TRIANGLE_MESHLET* meshlet = &mesh_triangle->meshlet[i];
 
-			//得到纹理
-			vector2* texture[3] =
-			{
-				&m_TextureCopy[index[0]],
-				&m_TextureCopy[index[1]],
-				&m_TextureCopy[index[2]],
-			};
+			vector3 center_in_camera;
+			Vec3MulMat4(&meshlet->center, &transform, &center_in_camera);
+			bool visible = CoordinateCameraFrustumTest(&center_in_camera, meshlet->radius * scale);
 
-			//三点的z值同时小于等于近截面，4种情况：3点小、2点小1点等、1点小2点等、3点等
-			if (_FLT_LESS_EQUAL_FLT(vertex[0]->z, m_NearPlaneZInCamera) &&
-				_FLT_LESS_EQUAL_FLT(vertex[1]->z, m_NearPlaneZInCamera) &&
-				_FLT_LESS_EQUAL_FLT(vertex[2]->z, m_NearPlaneZInCamera))
-			{
-				//不放入更新三角索引
-			}
-			//三点的z值同时大于等于近截面，3种情况：3点大、2点大1点等、1点大2点等
-			else if (
-				_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, vertex[0]->z) &&
-				_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, vertex[1]->z) &&
-				_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, vertex[2]->z))
+			//簇包围球内任一点p满足sign*axis.(p-eye)>cutoff*|p-eye|时，所有面法线与视线夹角小于90度
+			if (visible && cone_enable && meshlet->cone_cutoff < 1.0f)
 			{
-				//放入更新线段索引
-				m_TriangleAfterNearPlaneClip.push_back(index[0]);
-				m_TriangleAfterNearPlaneClip.push_back(index[1]);
-				m_TriangleAfterNearPlaneClip.push_back(index[2]);
+				vector3 view = meshlet->center - eye;
+				if (cone_sign * view.Dot(meshlet->cone_axis) - meshlet->radius >
+					meshlet->cone_cutoff * (view.Length() + meshlet->radius))
+					visible = false;
 			}
-			//2种情况：1点小2点大、2点小1点大
-			else
-			{
-				//得到具体情况
-				int less_near_count =
-					(_FLT_LESS_FLT(vertex[0]->z, m_NearPlaneZInCamera) ? 1 : 0) +
-					(_FLT_LESS_FLT(vertex[1]->z, m_NearPlaneZInCamera) ? 1 : 0) +
-					(_FLT_LESS_FLT(vertex[2]->z, m_NearPlaneZInCamera) ? 1 : 0);
-
-				//1点小2点大
-				if (1 == less_near_count)
-				{
-					//得到2大点和1小点的下标
-					int more_index[2] = {-1, -1};
-					int less_index = -1;
-					if (_FLT_LESS_FLT(vertex[0]->z, m_NearPlaneZInCamera))
-					{
-						less_index = 0;
-						more_index[0] = 1;
-						more_index[1] = 2;
-					}
-					else if (_FLT_LESS_FLT(vertex[1]->z, m_NearPlaneZInCamera))
-					{
-						less_index = 1;
-						more_index[0] = 2;
-						more_index[1] = 0;
-					}
-					else
-					{
-						less_index = 2;
-						more_index[0] = 0;
-						more_index[1] = 1;
-					}
 
-					//得到2大点和1小点，及其纹理
-					vector3* less_vertex = vertex[less_index];
-					vector3* more_vertex[2] =
-					{
-						vertex[more_index[0]],
-						vertex[more_index[1]],
-					};
-					vector2* less_texture = texture[less_index];
-					vector2* more_texture[2] =
-					{
-						texture[more_index[0]],
-						texture[more_index[1]],
-					};
-
-					//计算截点xy坐标，因为摄像机坐标系下面任意顶点的xyz都是线性关系，故有以下等式
-					//m_CoordinateCameraNearPlane - 大->z   截->x - 大->x   截->y - 大->y
-					//----------------------------------- = ------------- = -------------
-					//m_CoordinateCameraNearPlane - 小->z   截->x - 小->x   截->y - 小->y
-					vector3 cut_vertex[2] =
-					{
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-					};
-					vector2 cut_texture[2] =
-					{
-						vector2(0.0f, 0.0f),
-						vector2(0.0f, 0.0f),
-					};
-					float temp[2] =
-					{
-						(cut_vertex[0].z - more_vertex[0]->z) / (cut_vertex[0].z - less_vertex->z),
-						(cut_vertex[1].z - more_vertex[1]->z) / (cut_vertex[1].z - less_vertex->z),
-					};
-					float temp_minus_1[2] =
-					{
-						temp[0] - 1.0f,
-						temp[1] - 1.0f,
-					};
-					cut_vertex[0].x =
-						_FLT_EQUAL_FLT(more_vertex[0]->x, less_vertex->x) ? less_vertex->x : (temp[0] * less_vertex->x - more_vertex[0]->x) / temp_minus_1[0];
-					cut_vertex[0].y =
-						_FLT_EQUAL_FLT(more_vertex[0]->y, less_vertex->y) ? less_vertex->y : (temp[0] * less_vertex->y - more_vertex[0]->y) / temp_minus_1[0];
-					cut_texture[0].x =
-						_FLT_EQUAL_FLT(more_texture[0]->x, less_texture->x) ? less_texture->x : (temp[0] * less_texture->x - more_texture[0]->x) / temp_minus_1[0];
-					cut_texture[0].y =
-						_FLT_EQUAL_FLT(more_texture[0]->y, less_texture->y) ? less_texture->y : (temp[0] * less_texture->y - more_texture[0]->y) / temp_minus_1[0];
-					cut_vertex[1].x =
-						_FLT_EQUAL_FLT(more_vertex[1]->x, less_vertex->x) ? less_vertex->x : (temp[1] * less_vertex->x - more_vertex[1]->x) / temp_minus_1[1];
-					cut_vertex[1].y =
-						_FLT_EQUAL_FLT(more_vertex[1]->y, less_vertex->y) ? less_vertex->y : (temp[1] * less_vertex->y - more_vertex[1]->y) / temp_minus_1[1];
-					cut_texture[1].x =
-						_FLT_EQUAL_FLT(more_texture[1]->x, less_texture->x) ? less_texture->x : (temp[1] * less_texture->x - more_texture[1]->x) / temp_minus_1[1];
-					cut_texture[1].y =
-						_FLT_EQUAL_FLT(more_texture[1]->y, less_texture->y) ? less_texture->y : (temp[1] * less_texture->y - more_texture[1]->y) / temp_minus_1[1];
-
-					//新点入表并得到下标
-					int cut_vertex_index[2] = { -1, -1 };
-					m_VertexInCamera.push_back(cut_vertex[0]);
-					m_TextureCopy.push_back(cut_texture[0]);
-					cut_vertex_index[0] = (int)m_VertexInCamera.size() - 1;
-					m_VertexInCamera.push_back(cut_vertex[1]);
-					m_TextureCopy.push_back(cut_texture[1]);
-					cut_vertex_index[1] = (int)m_VertexInCamera.size() - 1;
-
-					//得到2个新三角索引
-					int cut_triangle_index[2][3] =
-					{
-						{
-							index[0],
-							index[1],
-							index[2],
-						},
-						{
-							index[0],
-							index[1],
-							index[2],
-						},
-					};
-					//新三角索引0：保留2大点的索引，加入1截点索引
-					cut_triangle_index[0][less_index] = cut_vertex_index[0];
-					//新三角索引1：保留1大点的索引，加入2截点索引
-					cut_triangle_index[1][more_index[0]] = cut_vertex_index[0];
-					cut_triangle_index[1][less_index] = cut_vertex_index[1];
-
-					//放入更新线段索引
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0][0]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0][1]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0][2]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1][0]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1][1]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1][2]);
-				}
-				//2点小1点大
-				else
+			int index_begin = meshlet->triangle_begin * 3;
+			int index_end = index_begin + meshlet->triangle_count * 3;
+			if (!visible)
+			{
+				if (!culled)
 				{
-					//得到1大点和2小点的下标
-					int more_index = -1;
-					int less_index[2] = {-1, -1};
-					if (_FLT_LESS_FLT(m_NearPlaneZInCamera, vertex[0]->z))
-					{
-						more_index = 0;
-						less_index[0] = 1;
-						less_index[1] = 2;
-					}
-					else if (_FLT_LESS_FLT(m_NearPlaneZInCamera, vertex[1]->z))
-					{
-						more_index = 1;
-						less_index[0] = 2;
-						less_index[1] = 0;
-					}
-					else
-					{
-						more_index = 2;
-						less_index[0] = 0;
-						less_index[1] = 1;
-					}
-
-					//得到1大点和2小点，及其纹理
-					vector3* more_vertex = vertex[more_index];
-					vector3* less_vertex[2] =
-					{
-						vertex[less_index[0]],
-						vertex[less_index[1]],
-					};
-					vector2* more_texture = texture[more_index];
-					vector2* less_texture[2] =
-					{
-						texture[less_index[0]],
-						texture[less_index[1]],
-					};
-
-					//计算截点xy坐标，因为摄像机坐标系下面任意顶点的xyz都是线性关系，故有以下等式
-					//m_CoordinateCameraNearPlane - 大->z   截->x - 大->x   截->y - 大->y
-					//----------------------------------- = ------------- = -------------
-					//m_CoordinateCameraNearPlane - 小->z   截->x - 小->x   截->y - 小->y
-					vector3 cut_vertex[2] =
-					{
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-					};
-					vector2 cut_texture[2] =
-					{
-						vector2(0.0f, 0.0f),
-						vector2(0.0f, 0.0f),
-					};
-					float temp[2] =
-					{
-						(cut_vertex[0].z - more_vertex->z) / (cut_vertex[0].z - less_vertex[0]->z),
-						(cut_vertex[1].z - more_vertex->z) / (cut_vertex[1].z - less_vertex[1]->z),
-					};
-					float temp_minus_1[2] =
-					{
-						temp[0] - 1.0f,
-						temp[1] - 1.0f,
-					};
-					cut_vertex[0].x = 
-						_FLT_EQUAL_FLT(more_vertex->x, less_vertex[0]->x) ? more_vertex->x : (temp[0] * less_vertex[0]->x - more_vertex->x) / temp_minus_1[0];
-					cut_vertex[0].y =
-						_FLT_EQUAL_FLT(more_vertex->y, less_vertex[0]->y) ? more_vertex->y : (temp[0] * less_vertex[0]->y - more_vertex->y) / temp_minus_1[0];
-					cut_texture[0].x =
-						_FLT_EQUAL_FLT(more_texture->x, less_texture[0]->x) ? more_texture->x : (temp[0] * less_texture[0]->x - more_texture->x) / temp_minus_1[0];
-					cut_texture[0].y =
-						_FLT_EQUAL_FLT(more_texture->y, less_texture[0]->y) ? more_texture->y : (temp[0] * less_texture[0]->y - more_texture->y) / temp_minus_1[0];
-					cut_vertex[1].x =
-						_FLT_EQUAL_FLT(more_vertex->x, less_vertex[1]->x) ? more_vertex->x : (temp[1] * less_vertex[1]->x - more_vertex->x) / temp_minus_1[1];
-					cut_vertex[1].y =
-						_FLT_EQUAL_FLT(more_vertex->y, less_vertex[1]->y) ? more_vertex->y : (temp[1] * less_vertex[1]->y - more_vertex->y) / temp_minus_1[1];
-					cut_texture[1].x =
-						_FLT_EQUAL_FLT(more_texture->x, less_texture[1]->x) ? more_texture->x : (temp[1] * less_texture[1]->x - more_texture->x) / temp_minus_1[1];
-					cut_texture[1].y =
-						_FLT_EQUAL_FLT(more_texture->y, less_texture[1]->y) ? more_texture->y : (temp[1] * less_texture[1]->y - more_texture->y) / temp_minus_1[1];
-					
-					//新点入表并得到下标
-					int cut_vertex_index[2] = { -1, -1 };
-					m_VertexInCamera.push_back(cut_vertex[0]);
-					m_TextureCopy.push_back(cut_texture[0]);
-					cut_vertex_index[0] = (int)m_VertexInCamera.size() - 1;
-					m_VertexInCamera.push_back(cut_vertex[1]);
-					m_TextureCopy.push_back(cut_texture[1]);
-					cut_vertex_index[1] = (int)m_VertexInCamera.size() - 1;
-
-					//得到1个新三角索引
-					int cut_triangle_index[3] =
-					{
-						index[0],
-						index[1],
-						index[2],
-					};
-					//新三角索引：保留1大点的索引，加入2截点索引
-					cut_triangle_index[less_index[0]] = cut_vertex_index[0];
-					cut_triangle_index[less_index[1]] = cut_vertex_index[1];
-
-					//放入更新线段索引
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[2]);
+					culled = true;
+					m_TriangleAfterMeshletCulling.assign(triangle->begin(), triangle->begin() + index_begin);
 				}
 			}
+			else if (culled)
+				m_TriangleAfterMeshletCulling.insert(
+					m_TriangleAfterMeshletCulling.end(), triangle->begin() + index_begin, triangle->begin() + index_end);
 		}
 
-		m_pTriangleAfterNearPlaneClip = &m_TriangleAfterNearPlaneClip;
+		return culled ? &m_TriangleAfterMeshletCulling : triangle;
 	}
-	void Render::Draw3DMeshTriangleNearPlaneClip_ts1_ic1(
-		float sphere_radius,
-		const std::vector<int>* triangle_origin)
-	{
-		//得到摄像机坐标系下面包围球球心
-		vector3 center_camera = ComputerCenterInCamera();
 
-		//无需进行近截面裁剪
-		if (_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, center_camera.z - sphere_radius))
+	bool Render::Draw3DMeshTriangleCompaction(
+		const MESH_TRIANGLE* mesh_triangle,
+		const std::vector<int>* triangle,
+		bool illumination_compute,
+		bool texture_sample)
+	{
+		//顶点区域码，视锥体侧面为|x|、|y|<=z，比较带误差以保证舍去是保守的
+		int vertex_count = (int)m_VertexInCamera.size();
+		m_VertexCompactionIndex.resize(vertex_count);
+		for (int i = 0; i < vertex_count; ++i)
 		{
-			m_pTriangleAfterNearPlaneClip = triangle_origin;
-			return;
+			const vector3* vertex = &m_VertexInCamera[i];
+			int outcode = 0;
+			if (_FLT_LESS_FLT(vertex->z, m_NearPlaneZInCamera))
+				outcode |= _COMPACTION_OUTCODE_NEAR;
+			if (_FLT_LESS_FLT(vertex->x, -vertex->z))
+				outcode |= _COMPACTION_OUTCODE_LEFT;
+			else if (_FLT_LESS_FLT(vertex->z, vertex->x))
+				outcode |= _COMPACTION_OUTCODE_RIGHT;
+			if (_FLT_LESS_FLT(vertex->y, -vertex->z))
+				outcode |= _COMPACTION_OUTCODE_BOTTOM;
+			else if (_FLT_LESS_FLT(vertex->z, vertex->y))
+				outcode |= _COMPACTION_OUTCODE_TOP;
+			m_VertexCompactionIndex[i] = outcode;
 		}
 
-		//更新原始线段索引到更新线段索引
-		m_TriangleAfterNearPlaneClip.clear();
-		int triangle_count = (int)triangle_origin->size();
-		for (int i = 0; i < triangle_count; i += 3)
+		//拣选三角，保留的三角按原始下标放入压缩三角索引表，并标记引用的顶点
+		int index_count = (int)triangle->size();
+		m_TriangleAfterCompaction.resize(index_count);
+		int triangle_count = 0;
+		for (int i = 0; i < index_count; i += 3)
 		{
-			//得到三角索引
-			int index[3] =
-			{
-				triangle_origin->at(i),
-				triangle_origin->at(i + 1),
-				triangle_origin->at(i + 2),
-			};
-
-			//得到顶点
-			vector3* vertex[3] =
-			{
-				&m_VertexInCamera[index[0]],
-				&m_VertexInCamera[index[1]],
-				&m_VertexInCamera[index[2]],
-			};
-
-			//得到颜色
-			vector3* color[3] =
-			{
-				&m_ColorAfterIlluminationCompute[index[0]],
-				&m_ColorAfterIlluminationCompute[index[1]],
-				&m_ColorAfterIlluminationCompute[index[2]],
-			};
+			int i0 = triangle->at(i);
+			int i1 = triangle->at(i + 1);
+			int i2 = triangle->at(i + 2);
 
-			//得到纹理
-			vector2* texture[3] =
-			{
-				&m_TextureCopy[index[0]],
-				&m_TextureCopy[index[1]],
-				&m_TextureCopy[index[2]],
-			};
+			//三点在同一区域之外
+			if (m_VertexCompactionIndex[i0] & m_VertexCompactionIndex[i1] & m_VertexCompactionIndex[i2] & ~_COMPACTION_REFERENCED)
+				continue;
 
-			//三点的z值同时小于等于近截面，4种情况：3点小、2点小1点等、1点小2点等、3点等
-			if (_FLT_LESS_EQUAL_FLT(vertex[0]->z, m_NearPlaneZInCamera) &&
-				_FLT_LESS_EQUAL_FLT(vertex[1]->z, m_NearPlaneZInCamera) &&
-				_FLT_LESS_EQUAL_FLT(vertex[2]->z, m_NearPlaneZInCamera))
-			{
-				//不放入更新三角索引
-			}
-			//三点的z值同时大于等于近截面，3种情况：3点大、2点大1点等、1点大2点等
-			else if (
-				_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, vertex[0]->z) &&
-				_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, vertex[1]->z) &&
-				_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, vertex[2]->z))
+			//三点行列式即面法线与任一顶点的点积，与裁剪之后投影坐标系下面积的符号相同，
+			//只在符号确定被拣选时舍去，为0的情况留给表面拣选
+			if (m_EnableRenderStateFaceCulling)
 			{
-				//放入更新线段索引
-				m_TriangleAfterNearPlaneClip.push_back(index[0]);
-				m_TriangleAfterNearPlaneClip.push_back(index[1]);
-				m_TriangleAfterNearPlaneClip.push_back(index[2]);
+				float determinant = m_VertexInCamera[i0].Dot(m_VertexInCamera[i1].Cross(m_VertexInCamera[i2]));
+				if (m_FaceCullingBack ? 0.0f < determinant : determinant < 0.0f)
+					continue;
 			}
-			//2种情况：1点小2点大、2点小1点大
-			else
-			{
-				//得到具体情况
-				int less_near_count =
-					(_FLT_LESS_FLT(vertex[0]->z, m_NearPlaneZInCamera) ? 1 : 0) +
-					(_FLT_LESS_FLT(vertex[1]->z, m_NearPlaneZInCamera) ? 1 : 0) +
-					(_FLT_LESS_FLT(vertex[2]->z, m_NearPlaneZInCamera) ? 1 : 0);
-
-				//1点小2点大
-				if (1 == less_near_count)
-				{
-					//得到2大点和1小点的下标
-					int more_index[2] = {-1, -1};
-					int less_index = -1;
-					if (_FLT_LESS_FLT(vertex[0]->z, m_NearPlaneZInCamera))
-					{
-						less_index = 0;
-						more_index[0] = 1;
-						more_index[1] = 2;
-					}
-					else if (_FLT_LESS_FLT(vertex[1]->z, m_NearPlaneZInCamera))
-					{
-						less_index = 1;
-						more_index[0] = 2;
-						more_index[1] = 0;
-					}
-					else
-					{
-						less_index = 2;
-						more_index[0] = 0;
-						more_index[1] = 1;
-					}
 
-					//得到2大点和1小点，及其颜色、纹理
-					vector3* less_vertex = vertex[less_index];
-					vector3* more_vertex[2] =
-					{
-						vertex[more_index[0]],
-						vertex[more_index[1]],
-					};
-					vector3* less_color = color[less_index];
-					vector3* more_color[2] =
-					{
-						color[more_index[0]],
-						color[more_index[1]],
-					};
-					vector2* less_texture = texture[less_index];
-					vector2* more_texture[2] =
-					{
-						texture[more_index[0]],
-						texture[more_index[1]],
-					};
-
-					//计算截点xy坐标，因为摄像机坐标系下面任意顶点的xyz都是线性关系，故有以下等式
-					//m_CoordinateCameraNearPlane - 大->z   截->x - 大->x   截->y - 大->y
-					//----------------------------------- = ------------- = -------------
-					//m_CoordinateCameraNearPlane - 小->z   截->x - 小->x   截->y - 小->y
-					vector3 cut_vertex[2] =
-					{
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-					};
-					vector3 cut_color[2] =
-					{
-						vector3(0.0f, 0.0f, 0.0f),
-						vector3(0.0f, 0.0f, 0.0f),
-					};
-					vector2 cut_texture[2] =
-					{
-						vector2(0.0f, 0.0f),
-						vector2(0.0f, 0.0f),
-					};
-					float temp[2] =
-					{
-						(cut_vertex[0].z - more_vertex[0]->z) / (cut_vertex[0].z - less_vertex->z),
-						(cut_vertex[1].z - more_vertex[1]->z) / (cut_vertex[1].z - less_vertex->z),
-					};
-					float temp_minus_1[2] =
-					{
-						temp[0] - 1.0f,
-						temp[1] - 1.0f,
-					};
-					cut_vertex[0].x =
-						_FLT_EQUAL_FLT(more_vertex[0]->x, less_vertex->x) ? less_vertex->x : (temp[0] * less_vertex->x - more_vertex[0]->x) / temp_minus_1[0];
-					cut_vertex[0].y =
-						_FLT_EQUAL_FLT(more_vertex[0]->y, less_vertex->y) ? less_vertex->y : (temp[0] * less_vertex->y - more_vertex[0]->y) / temp_minus_1[0];
-					cut_color[0].x =
-						_FLT_EQUAL_FLT(more_color[0]->x, less_color->x) ? less_color->x : (temp[0] * less_color->x - more_color[0]->x) / temp_minus_1[0];
-					cut_color[0].y =
-						_FLT_EQUAL_FLT(more_color[0]->y, less_color->y) ? less_color->y : (temp[0] * less_color->y - more_color[0]->y) / temp_minus_1[0];
-					cut_color[0].z =
-						_FLT_EQUAL_FLT(more_color[0]->z, less_color->z) ? less_color->z : (temp[0] * less_color->z - more_color[0]->z) / temp_minus_1[0];
-					cut_texture[0].x =
-						_FLT_EQUAL_FLT(more_texture[0]->x, less_texture->x) ? less_texture->x : (temp[0] * less_texture->x - more_texture[0]->x) / temp_minus_1[0];
-					cut_texture[0].y =
-						_FLT_EQUAL_FLT(more_texture[0]->y, less_texture->y) ? less_texture->y : (temp[0] * less_texture->y - more_texture[0]->y) / temp_minus_1[0];
-					cut_vertex[1].x =
-						_FLT_EQUAL_FLT(more_vertex[1]->x, less_vertex->x) ? less_vertex->x : (temp[1] * less_vertex->x - more_vertex[1]->x) / temp_minus_1[1];
-					cut_vertex[1].y =
-						_FLT_EQUAL_FLT(more_vertex[1]->y, less_vertex->y) ? less_vertex->y : (temp[1] * less_vertex->y - more_vertex[1]->y) / temp_minus_1[1];
-					cut_color[1].x =
-						_FLT_EQUAL_FLT(more_color[1]->x, less_color->x) ? less_color->x : (temp[1] * less_color->x - more_color[1]->x) / temp_minus_1[1];
-					cut_color[1].y =
-						_FLT_EQUAL_FLT(more_color[1]->y, less_color->y) ? less_color->y : (temp[1] * less_color->y - more_color[1]->y) / temp_minus_1[1];
-					cut_color[1].z =
-						_FLT_EQUAL_FLT(more_color[1]->z, less_color->z) ? less_color->z : (temp[1] * less_color->z - more_color[1]->z) / temp_minus_1[1];
-					cut_texture[1].x =
-						_FLT_EQUAL_FLT(more_texture[1]->x, less_texture->x) ? less_texture->x : (temp[1] * less_texture->x - more_texture[1]->x) / temp_minus_1[1];
-					cut_texture[1].y =
-						_FLT_EQUAL_FLT(more_texture[1]->y, less_texture->y) ? less_texture->y : (temp[1] * less_texture->y - more_texture[1]->y) / temp_minus_1[1];
-					
-					//新点入表并得到下标
-					int cut_vertex_index[2] = { -1, -1 };
-					m_VertexInCamera.push_back(cut_vertex[0]);
-					m_ColorAfterIlluminationCompute.push_back(cut_color[0]);
-					m_TextureCopy.push_back(cut_texture[0]);
-					cut_vertex_index[0] = (int)m_VertexInCamera.size() - 1;
-					m_VertexInCamera.push_back(cut_vertex[1]);
-					m_ColorAfterIlluminationCompute.push_back(cut_color[1]);
-					m_TextureCopy.push_back(cut_texture[1]);
-					cut_vertex_index[1] = (int)m_VertexInCamera.size() - 1;
-
-					//得到2个新三角索引
-					int cut_triangle_index[2][3] =
-					{
-						{
-							index[0],
-							index[1],
-							index[2],
-						},
-						{
-							index[0],
-							index[1],
-							index[2],
-						},
-					};
-					//新三角索引0：保留2大点的索引，加入1截点索引
-					cut_triangle_index[0][less_index] = cut_vertex_index[0];
-					//新三角索引1：保留1大点的索引，加入2截点索引
-					cut_triangle_index[1][more_index[0]] = cut_vertex_index[0];
-					cut_triangle_index[1][less_index] = cut_vertex_index[1];
-
-					//放入更新线段索引
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0][0]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0][1]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0][2]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1][0]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1][1]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1][2]);
-				}
-				//2点小1点大
-				else
-				{
-					//得到1大点和2小点的下标
-					int more_index = -1;
-					int less_index[2] = {-1, -1};
-					if (_FLT_LESS_FLT(m_NearPlaneZInCamera, vertex[0]->z))
-					{
-						more_index = 0;
-						less_index[0] = 1;
-						less_index[1] = 2;
-					}
-					else if (_FLT_LESS_FLT(m_NearPlaneZInCamera, vertex[1]->z))
-					{
-						more_index = 1;
-						less_index[0] = 2;
-						less_index[1] = 0;
-					}
-					else
-					{
-						more_index = 2;
-						less_index[0] = 0;
-						less_index[1] = 1;
-					}
+			m_VertexCompactionIndex[i0] |= _COMPACTION_REFERENCED;
+			m_VertexCompactionIndex[i1] |= _COMPACTION_REFERENCED;
+			m_VertexCompactionIndex[i2] |= _COMPACTION_REFERENCED;
+			m_TriangleAfterCompaction[triangle_count++] = i0;
+			m_TriangleAfterCompaction[triangle_count++] = i1;
+			m_TriangleAfterCompaction[triangle_count++] = i2;
+		}
+		m_TriangleAfterCompaction.resize(triangle_count);
+		if (0 == triangle_count)
+			return false;
 
-					//得到1大点和2小点，及其颜色、纹理
-					vector3* more_vertex = vertex[more_index];
-					vector3* less_vertex[2] =
-					{
-						vertex[less_index[0]],
-						vertex[less_index[1]],
-					};
-					vector3* more_color = color[more_index];
-					vector3* less_color[2] =
-					{
-						color[less_index[0]],
-						color[less_index[1]],
-					};
-					vector2* more_texture = texture[more_index];
-					vector2* less_texture[2] =
-					{
-						texture[less_index[0]],
-						texture[less_index[1]],
-					};
-
-					//计算截点xy坐标，因为摄像机坐标系下面任意顶点的xyz都是线性关系，故有以下等式
-					//m_CoordinateCameraNearPlane - 大->z   截->x - 大->x   截->y - 大->y
-					//----------------------------------- = ------------- = -------------
-					//m_CoordinateCameraNearPlane - 小->z   截->x - 小->x   截->y - 小->y
-					vector3 cut_vertex[2] =
-					{
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-						vector3(0.0f, 0.0f, m_NearPlaneZInCamera),
-					};
-					vector3 cut_color[2] =
-					{
-						vector3(0.0f, 0.0f, 0.0f),
-						vector3(0.0f, 0.0f, 0.0f),
-					};
-					vector2 cut_texture[2] =
-					{
-						vector2(0.0f, 0.0f),
-						vector2(0.0f, 0.0f),
-					};
-					float temp[2] =
-					{
-						(cut_vertex[0].z - more_vertex->z) / (cut_vertex[0].z - less_vertex[0]->z),
-						(cut_vertex[1].z - more_vertex->z) / (cut_vertex[1].z - less_vertex[1]->z),
-					};
-					float temp_minus_1[2] =
-					{
-						temp[0] - 1.0f,
-						temp[1] - 1.0f,
-					};
-					cut_vertex[0].x = 
-						_FLT_EQUAL_FLT(more_vertex->x, less_vertex[0]->x) ? more_vertex->x : (temp[0] * less_vertex[0]->x - more_vertex->x) / temp_minus_1[0];
-					cut_vertex[0].y =
-						_FLT_EQUAL_FLT(more_vertex->y, less_vertex[0]->y) ? more_vertex->y : (temp[0] * less_vertex[0]->y - more_vertex->y) / temp_minus_1[0];
-					cut_color[0].x =
-						_FLT_EQUAL_FLT(more_color->x, less_color[0]->x) ? more_color->x : (temp[0] * less_color[0]->x - more_color->x) / temp_minus_1[0];
-					cut_color[0].y =
-						_FLT_EQUAL_FLT(more_color->y, less_color[0]->y) ? more_color->y : (temp[0] * less_color[0]->y - more_color->y) / temp_minus_1[0];
-					cut_color[0].z =
-						_FLT_EQUAL_FLT(more_color->z, less_color[0]->z) ? more_color->z : (temp[0] * less_color[0]->z - more_color->z) / temp_minus_1[0];
-					cut_texture[0].x =
-						_FLT_EQUAL_FLT(more_texture->x, less_texture[0]->x) ? more_texture->x : (temp[0] * less_texture[0]->x - more_texture->x) / temp_minus_1[0];
-					cut_texture[0].y =
-						_FLT_EQUAL_FLT(more_texture->y, less_texture[0]->y) ? more_texture->y : (temp[0] * less_texture[0]->y - more_texture->y) / temp_minus_1[0];
-					cut_vertex[1].x =
-						_FLT_EQUAL_FLT(more_vertex->x, less_vertex[1]->x) ? more_vertex->x : (temp[1] * less_vertex[1]->x - more_vertex->x) / temp_minus_1[1];
-					cut_vertex[1].y =
-						_FLT_EQUAL_FLT(more_vertex->y, less_vertex[1]->y) ? more_vertex->y : (temp[1] * less_vertex[1]->y - more_vertex->y) / temp_minus_1[1];
-					cut_color[1].x =
-						_FLT_EQUAL_FLT(more_color->x, less_color[1]->x) ? more_color->x : (temp[1] * less_color[1]->x - more_color->x) / temp_minus_1[1];
-					cut_color[1].y =
-						_FLT_EQUAL_FLT(more_color->y, less_color[1]->y) ? more_color->y : (temp[1] * less_color[1]->y - more_color->y) / temp_minus_1[1];
-					cut_color[1].z =
-						_FLT_EQUAL_FLT(more_color->z, less_color[1]->z) ? more_color->z : (temp[1] * less_color[1]->z - more_color->z) / temp_minus_1[1];
-					cut_texture[1].x =
-						_FLT_EQUAL_FLT(more_texture->x, less_texture[1]->x) ? more_texture->x : (temp[1] * less_texture[1]->x - more_texture->x) / temp_minus_1[1];
-					cut_texture[1].y =
-						_FLT_EQUAL_FLT(more_texture->y, less_texture[1]->y) ? more_texture->y : (temp[1] * less_texture[1]->y - more_texture->y) / temp_minus_1[1];
-
-					//新点入表并得到下标
-					int cut_vertex_index[2] = { -1, -1 };
-					m_VertexInCamera.push_back(cut_vertex[0]);
-					m_ColorAfterIlluminationCompute.push_back(cut_color[0]);
-					m_TextureCopy.push_back(cut_texture[0]);
-					cut_vertex_index[0] = (int)m_VertexInCamera.size() - 1;
-					m_VertexInCamera.push_back(cut_vertex[1]);
-					m_ColorAfterIlluminationCompute.push_back(cut_color[1]);
-					m_TextureCopy.push_back(cut_texture[1]);
-					cut_vertex_index[1] = (int)m_VertexInCamera.size() - 1;
-
-					//得到1个新三角索引
-					int cut_triangle_index[3] =
-					{
-						index[0],
-						index[1],
-						index[2],
-					};
-					//新三角索引：保留1大点的索引，加入2截点索引
-					cut_triangle_index[less_index[0]] = cut_vertex_index[0];
-					cut_triangle_index[less_index[1]] = cut_vertex_index[1];
-
-					//放入更新线段索引
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[0]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[1]);
-					m_TriangleAfterNearPlaneClip.push_back(cut_triangle_index[2]);
-				}
-			}
+		//按原始顺序原地压缩，压缩下标不大于原始下标
+		if (illumination_compute)
+			m_NormalCompaction.resize(vertex_count);
+		int compaction_count = 0;
+		for (int i = 0; i < vertex_count; ++i)
+		{
+			if (0 == (m_VertexCompactionIndex[i] & _COMPACTION_REFERENCED))
+				continue;
+
+			m_VertexInWorld[compaction_count] = m_VertexInWorld[i];
+			m_VertexInCamera[compaction_count] = m_VertexInCamera[i];
+			if (illumination_compute)
+				m_NormalCompaction[compaction_count] = mesh_triangle->normal[i];
+			if (texture_sample)
+				m_TextureCopy[compaction_count] = m_TextureCopy[i];
+			m_VertexCompactionIndex[i] = compaction_count++;
 		}
+		m_VertexInWorld.resize(compaction_count);
+		m_VertexInCamera.resize(compaction_count);
+		if (illumination_compute)
+			m_NormalCompaction.resize(compaction_count);
+		if (texture_sample)
+			m_TextureCopy.resize(compaction_count);
+
+		//改写三角索引
+		for (int i = 0; i < triangle_count; ++i)
+			m_TriangleAfterCompaction[i] = m_VertexCompactionIndex[m_TriangleAfterCompaction[i]];
 
-		m_pTriangleAfterNearPlaneClip = &m_TriangleAfterNearPlaneClip;
+		return true;
 	}
 
 	void Render::FaceCulling()
@@ -2064,53 +1932,30 @@ namespace render {
 		int triangle_count = (int)m_pTriangleAfterNearPlaneClip->size() / 3;
 
 		//得到投影坐标系顶点
-		std::vector<vector3>* vertex_projection = &m_VertexInProjection;
+		SCRATCH_ARRAY<vector3>* vertex_projection = &m_VertexInProjection;
 
 		//清空可见三角
 		m_TriangleAfterFaceCulling.clear();
 
-		//背面拣选
-		if (m_FaceCullingBack)
-		{
-			for (int i = 0; i < triangle_count; ++i)
-			{
-				//得到三角形索引
-				int j = i * 3;
-				int i0 = m_pTriangleAfterNearPlaneClip->at(j);
-				int i1 = m_pTriangleAfterNearPlaneClip->at(j + 1);
-				int i2 = m_pTriangleAfterNearPlaneClip->at(j + 2);
-
-				//计算面法线
-				vector3 u1 = vertex_projection->at(i0) - vertex_projection->at(i1);
-				vector3 u2 = vertex_projection->at(i1) - vertex_projection->at(i2);
-				vector3 normal = u1.Cross(u2);
-				normal = normal.Normalize();
-
-				//判断是否可见，注意两个向量的点乘结果的正负只和它们夹角的大小有关系，和
-				//向量长度无关，因为(v1 dot v2)结果为|v1||v2|cos(a)，而|v1||v2|的结果为正
-				//，简单点说就是两个向量的点乘结果就可以看出它们的夹角大小了
-				if (normal.Dot(m_SightLineInProjection) < 0.0f)
-					m_TriangleAfterFaceCulling.push_back(i);
-			}
-		}
-		//正面拣选
-		else
+		//投影坐标系下的有向面积，即面法线与视线(0,0,1)的点积，只需要符号所以不做单位化，
+		//背面拣选保留面积为负的三角，正面拣选保留面积为正的三角，面积为0的三角都舍去
+		float sign = m_FaceCullingBack ? 1.0f : -1.0f;
+		for (int i = 0; i < triangle_count; ++i)
 		{
-			for (int i = 0; i < triangle_count; ++i)
-			{
-				int j = i * 3;
-				int i0 = m_pTriangleAfterNearPlaneClip->at(j);
-				int i1 = m_pTriangleAfterNearPlaneClip->at(j + 1);
-				int i2 = m_pTriangleAfterNearPlaneClip->at(j + 2);
-
-				vector3 u1 = vertex_projection->at(i0) - vertex_projection->at(i1);
-				vector3 u2 = vertex_projection->at(i1) - vertex_projection->at(i2);
-				vector3 normal = u1.Cross(u2);
-				normal = normal.Normalize();
-
-				if (normal.Dot(m_SightLineInProjection) > 0.0f)
-					m_TriangleAfterFaceCulling.push_back(i);
-			}
+			//得到三角形索引
+			int j = i * 3;
+			int i0 = m_pTriangleAfterNearPlaneClip->at(j);
+			int i1 = m_pTriangleAfterNearPlaneClip->at(j + 1);
+			int i2 = m_pTriangleAfterNearPlaneClip->at(j + 2);
+
+			const vector3* p0 = &vertex_projection->at(i0);
+			const vector3* p1 = &vertex_projection->at(i1);
+			const vector3* p2 = &vertex_projection->at(i2);
+			float area =
+				(p0->x - p1->x) * (p1->y - p2->y) -
+				(p0->y - p1->y) * (p1->x - p2->x);
+			if (sign * area < 0.0f)
+				m_TriangleAfterFaceCulling.push_back(i);
 		}
 	}
 
@@ -2236,8 +2081,8 @@ namespace render {
 		vertex_data1[3] = c1->x / v1->z;
 		vertex_data1[4] = c1->y / v1->z;
 		vertex_data1[5] = c1->z / v1->z;
-		vertex_data0[6] = t1->x * texture_right / v1->z;
-		vertex_data0[7] = t1->y * texture_bottom / v1->z;
+		vertex_data1[6] = t1->x * texture_right / v1->z;
+		vertex_data1[7] = t1->y * texture_bottom / v1->z;
 
 		vertex_data2[0] = v2->y;
 		vertex_data2[1] = v2->x;
@@ -2441,7 +2286,7 @@ namespace render {
 		rect_w.x1 = (int)triangle_rasterize->right_bottom[1]; \
 	if (rect_w.x2 < (int)triangle_rasterize->right_bottom[1]) \
 		rect_w.x2 = (int)triangle_rasterize->right_bottom[1]; \
-	if (!RectangleIntersect(&rect_w, &m_RectangleView, NULL)) \
+	if (!m_RasterizeInsideView && !RectangleIntersect(&rect_w, &m_RectangleView, NULL)) \
 		return; \
 	int y_top = rect_w.y1; \
 	int y_bottom = rect_w.y2; \
@@ -2465,19 +2310,23 @@ namespace render {
 		change_ey_right[i] = \
 			(triangle_rasterize->right_bottom[i + 1] - triangle_rasterize->right_top[i + 1]) / y_offset; \
 	} \
-	if (y_top < m_RectangleView.y1) \
+	if (!m_RasterizeInsideView) \
 	{ \
-		int y_offset_clip = m_RectangleView.y1 - y_top; \
-		for (int i = 0; i < data_ey_size; ++i) \
+		if (y_top < m_RectangleView.y1) \
 		{ \
-			data_ey_left[i] += y_offset_clip * change_ey_left[i]; \
-			data_ey_right[i] += y_offset_clip * change_ey_right[i]; \
+			int y_offset_clip = m_RectangleView.y1 - y_top; \
+			for (int i = 0; i < data_ey_size; ++i) \
+			{ \
+				data_ey_left[i] += y_offset_clip * change_ey_left[i]; \
+				data_ey_right[i] += y_offset_clip * change_ey_right[i]; \
+			} \
+			y_top = m_RectangleView.y1; \
 		} \
-		y_top = m_RectangleView.y1; \
+		if (y_bottom > m_RectangleView.y2) \
+			y_bottom = m_RectangleView.y2; \
 	} \
-	if (y_bottom > m_RectangleView.y2) \
-		y_bottom = m_RectangleView.y2; \
 	const int data_eyx_size = data_ey_size - 1; \
+	const int* pixel_offset_x = &m_PixelOffsetX[0]; \
 	for (int y = y_top; y < y_bottom; ++y) \
 	{
 
@@ -2493,18 +2342,22 @@ namespace render {
 			float change_eyx[data_eyx_size] = {}; \
 			for (int i = 0; i < data_eyx_size; ++i) \
 				change_eyx[i] = (data_ey_right[i + 1] - data_ey_left[i + 1]) / x_offset; \
-			if (x_left < m_RectangleView.x1) \
+			if (!m_RasterizeInsideView) \
 			{ \
-				int x_offset_clip = m_RectangleView.x1 - x_left; \
-				for (int i = 0; i < data_eyx_size; ++i) \
-					data_eyx[i] += x_offset_clip * change_eyx[i]; \
-				x_left = m_RectangleView.x1; \
+				if (x_left < m_RectangleView.x1) \
+				{ \
+					int x_offset_clip = m_RectangleView.x1 - x_left; \
+					for (int i = 0; i < data_eyx_size; ++i) \
+						data_eyx[i] += x_offset_clip * change_eyx[i]; \
+					x_left = m_RectangleView.x1; \
+				} \
+				if (x_right > m_RectangleView.x2) \
+					x_right = m_RectangleView.x2; \
 			} \
-			if (x_right > m_RectangleView.x2) \
-				x_right = m_RectangleView.x2; \
+			int pixel_offset_y = m_PixelOffsetY[y]; \
 			for (int x = x_left; x < x_right; ++x) \
 			{ \
-				int pixel_idx = x + y * m_BufferWidth;
+				int pixel_idx = pixel_offset_x[x] + pixel_offset_y;
 
 #define _RASTERIZE_TRAVERSE_X_END \
 				for (int i = 0; i < data_eyx_size; ++i) \
@@ -2520,307 +2373,274 @@ namespace render {
 		} \
 	}
 
-	void Render::Draw3DMeshTriangleRasterize_ts0_ic1_ab0_dt0(const TRIANGLE_RASTERIZE* triangle_rasterize)
+//逐点采样的三角包围盒内采样点数量上限
+#define _RASTERIZE_POINT_SAMPLE_MAX 4
+
+//三角光栅化深度模式：不测试、小于测试并写入、相等测试(de)不写入、仅写深度不写颜色
+#define _RASTERIZE_DEPTH_NONE 0
+#define _RASTERIZE_DEPTH_LESS 1
+#define _RASTERIZE_DEPTH_EQUAL 2
+#define _RASTERIZE_DEPTH_ONLY 3
+
+	template <int TS, int IC, int AB, int DT, typename DEPTH>
+	inline void Render::Draw3DMeshTriangleRasterizePixel(int pixel_idx, const float* data_eyx)
 	{
-		//y、x、1/z、c.x/z、c.y/z、c.z/z
-#define _DATA_SIZE 6
-		_RASTERIZE_TRAVERSE_Y_BEGIN
+		//data_eyx中颜色、纹理坐标的起始下标
+		const int color_idx = 1;
+		const int texture_idx = IC ? 4 : 1;
+		typename DEPTH::TYPE* depth_buffer = (typename DEPTH::TYPE*)m_pDepthBuffer;
+
+		//深度测试，所有分支在编译期确定，每种组合的内层循环都没有渲染状态判断
+		typename DEPTH::TYPE depth = typename DEPTH::TYPE();
+		if constexpr (_RASTERIZE_DEPTH_NONE != DT)
+			depth = DEPTH::Convert(data_eyx[0], m_DepthScale, m_DepthBias);
+		bool pass = true;
+		if constexpr (_RASTERIZE_DEPTH_EQUAL == DT)
+			pass = DEPTH::Equal(depth_buffer[pixel_idx], depth);
+		else if constexpr (_RASTERIZE_DEPTH_NONE != DT)
+			pass = DEPTH::Less(depth_buffer[pixel_idx], depth);
+
+		if (pass)
 		{
-			_RASTERIZE_TRAVERSE_X_BEGIN
+			if constexpr (_RASTERIZE_DEPTH_ONLY != DT)
 			{
-				m_pVideoBuffer[pixel_idx] = _COLOR_SET(
-					(unsigned char)(data_eyx[1] / data_eyx[0]),
-					(unsigned char)(data_eyx[2] / data_eyx[0]),
-					(unsigned char)(data_eyx[3] / data_eyx[0]));
+				//得到纹理颜色，深度相等测试时被遮挡像素不做纹理采样，同时光照时按光照颜色调制
+				int color_texture = 0;
+				if constexpr (0 != TS)
+				{
+					color_texture = m_pTexture->c[
+						(int)(data_eyx[texture_idx] / data_eyx[0]) +
+						(int)(data_eyx[texture_idx + 1] / data_eyx[0]) * m_pTexture->w];
+					if constexpr (0 != IC)
+						color_texture = ColorModulate(
+							color_texture,
+							data_eyx[color_idx] / data_eyx[0],
+							data_eyx[color_idx + 1] / data_eyx[0],
+							data_eyx[color_idx + 2] / data_eyx[0]);
+				}
+
+				if constexpr (0 != AB)
+				{
+					//设置混合颜色
+					float r, g, b;
+					if constexpr (0 != TS)
+					{
+						r = (float)_COLOR_GET_R(color_texture);
+						g = (float)_COLOR_GET_G(color_texture);
+						b = (float)_COLOR_GET_B(color_texture);
+					}
+					else
+					{
+						r = data_eyx[color_idx] / data_eyx[0];
+						g = data_eyx[color_idx + 1] / data_eyx[0];
+						b = data_eyx[color_idx + 2] / data_eyx[0];
+					}
+					m_pVideoBuffer[pixel_idx] = _COLOR_SET(
+						(int)(_COLOR_GET_R(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + r * m_ForegroundAlphaBlendValue),
+						(int)(_COLOR_GET_G(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + g * m_ForegroundAlphaBlendValue),
+						(int)(_COLOR_GET_B(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + b * m_ForegroundAlphaBlendValue));
+				}
+				else if constexpr (0 != TS)
+					m_pVideoBuffer[pixel_idx] = color_texture;
+				else
+					m_pVideoBuffer[pixel_idx] = _COLOR_SET(
+						(unsigned char)(data_eyx[color_idx] / data_eyx[0]),
+						(unsigned char)(data_eyx[color_idx + 1] / data_eyx[0]),
+						(unsigned char)(data_eyx[color_idx + 2] / data_eyx[0]));
 			}
-			_RASTERIZE_TRAVERSE_X_END
+
+			//设置深度，深度相等测试时深度已由预渲染写入
+			if constexpr (_RASTERIZE_DEPTH_LESS == DT || _RASTERIZE_DEPTH_ONLY == DT)
+				depth_buffer[pixel_idx] = depth;
 		}
-		_RASTERIZE_TRAVERSE_Y_END
-#undef _DATA_SIZE
 	}
-	void Render::Draw3DMeshTriangleRasterize_ts0_ic1_ab0_dt1(const TRIANGLE_RASTERIZE* triangle_rasterize)
+
+	template <int TS, int IC, int AB, int DT, typename DEPTH>
+	void Render::Draw3DMeshTriangleRasterize(const TRIANGLE_RASTERIZE* triangle_rasterize)
 	{
-		//y、x、1/z、c.x/z、c.y/z、c.z/z
-#define _DATA_SIZE 6
+		//y、x、1/z，光照时接c.x/z、c.y/z、c.z/z，纹理时接t.x/z、t.y/z
+#define _DATA_SIZE (3 + (IC ? 3 : 0) + (TS ? 2 : 0))
 		_RASTERIZE_TRAVERSE_Y_BEGIN
 		{
 			_RASTERIZE_TRAVERSE_X_BEGIN
 			{
-				if (_FLT_LESS_FLT(m_pDepthBuffer[pixel_idx], data_eyx[0]))
-				{
-					m_pVideoBuffer[pixel_idx] =_COLOR_SET(
-						(unsigned char)(data_eyx[1] / data_eyx[0]),
-						(unsigned char)(data_eyx[2] / data_eyx[0]),
-						(unsigned char)(data_eyx[3] / data_eyx[0]));
-
-					//设置深度
-					m_pDepthBuffer[pixel_idx] = data_eyx[0];
-				}
+				Draw3DMeshTriangleRasterizePixel<TS, IC, AB, DT, DEPTH>(pixel_idx, data_eyx);
 			}
 			_RASTERIZE_TRAVERSE_X_END
 		}
 		_RASTERIZE_TRAVERSE_Y_END
 #undef _DATA_SIZE
 	}
-	void Render::Draw3DMeshTriangleRasterize_ts0_ic1_ab1_dt0(const TRIANGLE_RASTERIZE* triangle_rasterize)
+
+	//有向边p->q的边函数，p、q中[0]为y、[1]为x，两个端点按固定顺序计算，
+	//公共边在相邻两个三角中方向相反、值严格相反，采样点落在边上时不会两侧都舍去或都绘制
+	static inline float EdgeFunction(const float* p, const float* q, float x, float y)
+	{
+		if (p[0] < q[0] || (p[0] == q[0] && p[1] < q[1]))
+			return (q[1] - p[1]) * (y - p[0]) - (q[0] - p[0]) * (x - p[1]);
+		return -((p[1] - q[1]) * (y - q[0]) - (p[0] - q[0]) * (x - q[1]));
+	}
+
+	template <int TS, int IC, int AB, int DT, typename DEPTH>
+	void Render::Draw3DMeshTriangleRasterizePoint(
+		int fill_count,
+		const float* vertex_data0,
+		const float* vertex_data1,
+		const float* vertex_data2,
+		const RECTANGLE* rect)
 	{
-		//y、x、1/z、c.x/z、c.y/z、c.z/z
-#define _DATA_SIZE 6
-		_RASTERIZE_TRAVERSE_Y_BEGIN
+		//采用扫描线光栅化的取整规则，顶点y截断为整数，像素(x, y)在(x + 1, y)以精确的边函数采样，
+		//扫描线沿边按浮点增量累加x，采样点离边不到累加误差时两者可能相差一个像素，覆盖不保证完全相同
+		float vertex0[2] = { (float)(int)vertex_data0[0], vertex_data0[1] };
+		float vertex1[2] = { (float)(int)vertex_data1[0], vertex_data1[1] };
+		float vertex2[2] = { (float)(int)vertex_data2[0], vertex_data2[1] };
+
+		//有向面积，统一为正方向，三点共线时舍去
+		float area =
+			(vertex1[1] - vertex0[1]) * (vertex2[0] - vertex0[0]) -
+			(vertex1[0] - vertex0[0]) * (vertex2[1] - vertex0[1]);
+		if (0.0f == area)
+			return;
+		const float* p0 = vertex0;
+		const float* p1 = vertex1;
+		const float* p2 = vertex2;
+		if (area < 0.0f)
 		{
-			_RASTERIZE_TRAVERSE_X_BEGIN
+			const float* temp = p1;
+			p1 = p2;
+			p2 = temp;
+			temp = vertex_data1;
+			vertex_data1 = vertex_data2;
+			vertex_data2 = temp;
+			area = -area;
+		}
+
+		//边的a、b，e(x, y)对x、y的偏导，公共边在相邻两个三角中方向相反，a、b严格相反
+		float a0 = p1[0] - p2[0], b0 = p2[1] - p1[1];
+		float a1 = p2[0] - p0[0], b1 = p0[1] - p2[1];
+		float a2 = p0[0] - p1[0], b2 = p1[1] - p0[1];
+
+		//采样点落在边上时只属于右边和上边，两个相邻三角都逐点采样时公共边上的像素只绘制一次
+		bool include0 = a0 < 0.0f || (0.0f == a0 && b0 > 0.0f);
+		bool include1 = a1 < 0.0f || (0.0f == a1 && b1 > 0.0f);
+		bool include2 = a2 < 0.0f || (0.0f == a2 && b2 > 0.0f);
+
+		float one_div_area = 1.0f / area;
+		const int data_eyx_size = fill_count - 2;
+		for (int y = rect->y1; y < rect->y2; ++y)
+		{
+			float py = (float)y;
+			int pixel_offset_y = m_PixelOffsetY[y];
+			for (int x = rect->x1; x < rect->x2; ++x)
 			{
-				//设置混合颜色
-				m_pVideoBuffer[pixel_idx] = _COLOR_SET(
-					(int)(_COLOR_GET_R(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + data_eyx[1] / data_eyx[0] * m_ForegroundAlphaBlendValue),
-					(int)(_COLOR_GET_G(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + data_eyx[2] / data_eyx[0] * m_ForegroundAlphaBlendValue),
-					(int)(_COLOR_GET_B(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + data_eyx[3] / data_eyx[0] * m_ForegroundAlphaBlendValue));
+				float px = x + 1.0f;
+				float e0 = EdgeFunction(p1, p2, px, py);
+				float e1 = EdgeFunction(p2, p0, px, py);
+				float e2 = EdgeFunction(p0, p1, px, py);
+				if ((e0 < 0.0f || (0.0f == e0 && !include0)) ||
+					(e1 < 0.0f || (0.0f == e1 && !include1)) ||
+					(e2 < 0.0f || (0.0f == e2 && !include2)))
+					continue;
+
+				//1/z、c/z、t/z在屏幕空间是线性的，按重心坐标插值
+				float w0 = e0 * one_div_area;
+				float w1 = e1 * one_div_area;
+				float w2 = e2 * one_div_area;
+				float data_eyx[8 - 2];
+				for (int i = 0; i < data_eyx_size; ++i)
+					data_eyx[i] = w0 * vertex_data0[i + 2] + w1 * vertex_data1[i + 2] + w2 * vertex_data2[i + 2];
+
+				Draw3DMeshTriangleRasterizePixel<TS, IC, AB, DT, DEPTH>(m_PixelOffsetX[x] + pixel_offset_y, data_eyx);
 			}
-			_RASTERIZE_TRAVERSE_X_END
 		}
-		_RASTERIZE_TRAVERSE_Y_END
-#undef _DATA_SIZE
 	}
-	void Render::Draw3DMeshTriangleRasterize_ts0_ic1_ab1_dt1(const TRIANGLE_RASTERIZE* triangle_rasterize)
+
+	template <int TS, int IC, int AB, int DT, typename DEPTH>
+	void Render::Draw3DMeshTriangleRasterizeBatch()
 	{
-		//y、x、1/z、c.x/z、c.y/z、c.z/z
-#define _DATA_SIZE 6
-		_RASTERIZE_TRAVERSE_Y_BEGIN
-		{
-			_RASTERIZE_TRAVERSE_X_BEGIN
-			{
-				if (_FLT_LESS_FLT(m_pDepthBuffer[pixel_idx], data_eyx[0]))
-				{
-					//设置混合颜色
-					m_pVideoBuffer[pixel_idx] = _COLOR_SET(
-						(int)(_COLOR_GET_R(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + data_eyx[1] / data_eyx[0] * m_ForegroundAlphaBlendValue),
-						(int)(_COLOR_GET_G(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + data_eyx[2] / data_eyx[0] * m_ForegroundAlphaBlendValue),
-						(int)(_COLOR_GET_B(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + data_eyx[3] / data_eyx[0] * m_ForegroundAlphaBlendValue));
-
-					//设置深度
-					m_pDepthBuffer[pixel_idx] = data_eyx[0];
-				}
-			}
-			_RASTERIZE_TRAVERSE_X_END
-		}
-		_RASTERIZE_TRAVERSE_Y_END
-#undef _DATA_SIZE
-	}
-	void Render::Draw3DMeshTriangleRasterize_ts1_ic0_ab0_dt0(const TRIANGLE_RASTERIZE* triangle_rasterize)
-	{
-		//y、x、1/z、t.x/z、t.y/z
-#define _DATA_SIZE 5
-		_RASTERIZE_TRAVERSE_Y_BEGIN
+		float vertex_data0[8] = {};
+		float vertex_data1[8] = {};
+		float vertex_data2[8] = {};
+		float vertex_data3[8] = {};
+		TRIANGLE_RASTERIZE triangle_flatbottom = {NULL, NULL, NULL, NULL};
+		TRIANGLE_RASTERIZE triangle_flattop = {NULL, NULL, NULL, NULL};
+		int triangle_visible_count = (int)m_TriangleAfterFaceCulling.size();
+		for (int i = 0; i < triangle_visible_count; ++i)
 		{
-			_RASTERIZE_TRAVERSE_X_BEGIN
+			//得到三角形三点
+			int j = m_TriangleAfterFaceCulling[i] * 3;
+			int i0 = m_pTriangleAfterNearPlaneClip->at(j);
+			int i1 = m_pTriangleAfterNearPlaneClip->at(j + 1);
+			int i2 = m_pTriangleAfterNearPlaneClip->at(j + 2);
+
+			//三点在视口同一侧之外则舍去，三点都在视口之内则光栅化时无需裁剪
+			int outcode0 = m_VertexViewOutcode[i0];
+			int outcode1 = m_VertexViewOutcode[i1];
+			int outcode2 = m_VertexViewOutcode[i2];
+			if (0 != (outcode0 & outcode1 & outcode2 & ~_VIEW_OUTCODE_BORDER))
+				continue;
+			m_RasterizeInsideView = 0 == (outcode0 | outcode1 | outcode2);
+
+			//扫描线光栅化按截断取整，顶点y截断为整数，像素(x, y)相当于在(x + 1, y)采样，包围盒与视口相交部分内
+			//没有采样点的三角不覆盖任何像素，在填充之前舍去，不超过_RASTERIZE_POINT_SAMPLE_MAX个采样点时逐点采样，
+			//省去分割和扫描线的建立，逐点采样与扫描线在边附近的采样点上可能相差一个像素
+			const vector3* v0 = &m_VertexInView[i0];
+			const vector3* v1 = &m_VertexInView[i1];
+			const vector3* v2 = &m_VertexInView[i2];
+			RECTANGLE rect_sample =
 			{
-				//设置显示
-				m_pVideoBuffer[pixel_idx] =
-					m_pTexture->c[(int)(data_eyx[1] / data_eyx[0]) + (int)(data_eyx[2] / data_eyx[0]) * m_pTexture->w];
-			}
-			_RASTERIZE_TRAVERSE_X_END
-		}
-		_RASTERIZE_TRAVERSE_Y_END
-#undef _DATA_SIZE
-	}
-
-	void Render::Draw3DMeshTriangleRasterize_ts1_ic0_ab0_dt1(const TRIANGLE_RASTERIZE* triangle_rasterize)
-	{
-		//y、x、1/z、t.x/z、t.y/z
-#define _DATA_SIZE 5
-
-		//得到包围矩形并进行可见性测试
-		RECTANGLE rect_w = 
-		{
-			(int)triangle_rasterize->left_top[1],
-			(int)triangle_rasterize->left_top[0],
-			(int)triangle_rasterize->left_top[1],
-			(int)triangle_rasterize->left_bottom[0]
-		};
-		if (rect_w.x1 > (int)triangle_rasterize->left_bottom[1])
-			rect_w.x1 = (int)triangle_rasterize->left_bottom[1];
-		if (rect_w.x2 < (int)triangle_rasterize->left_bottom[1])
-			rect_w.x2 = (int)triangle_rasterize->left_bottom[1];
-		if (rect_w.x1 > (int)triangle_rasterize->right_top[1])
-			rect_w.x1 = (int)triangle_rasterize->right_top[1];
-		if (rect_w.x2 < (int)triangle_rasterize->right_top[1])
-			rect_w.x2 = (int)triangle_rasterize->right_top[1];
-		if (rect_w.x1 > (int)triangle_rasterize->right_bottom[1])
-			rect_w.x1 = (int)triangle_rasterize->right_bottom[1];
-		if (rect_w.x2 < (int)triangle_rasterize->right_bottom[1])
-			rect_w.x2 = (int)triangle_rasterize->right_bottom[1];
-		if (!RectangleIntersect(&rect_w, &m_RectangleView, NULL))
-			return;
-
-		//得到整数化y值
-		int y_top = rect_w.y1;
-		int y_bottom = rect_w.y2;
-
-		//得到整数化y值递增量
-		int y_offset = y_bottom - y_top;
-
-		//y值递增量为0不绘制
-		if (0 == y_offset)
-			return;
-
-		//得到除y之外数据数量
-		const int data_ey_size = _DATA_SIZE - 1;
-
-		//得到除y之外数据初始量
-		float data_ey_left[data_ey_size] = {};
-		float data_ey_right[data_ey_size] = {};
-		for (int i = 0; i < data_ey_size; ++i)
-		{
-			data_ey_left[i] = triangle_rasterize->left_top[i + 1];
-			data_ey_right[i] = triangle_rasterize->right_top[i + 1];
-		}
-
-		//得到除y之外数据随y递增变化量
-		float change_ey_left[data_ey_size] = {};
-		float change_ey_right[data_ey_size] = {};
-		for (int i = 0; i < data_ey_size; ++i)
-		{
-			change_ey_left[i] =
-				(triangle_rasterize->left_bottom[i + 1] - triangle_rasterize->left_top[i + 1]) / y_offset;
-			change_ey_right[i] =
-				(triangle_rasterize->right_bottom[i + 1] - triangle_rasterize->right_top[i + 1]) / y_offset;
-		}
-
-		//y方向裁剪
-		if (y_top < m_RectangleView.y1)
-		{
-			int y_offset_clip = m_RectangleView.y1 - y_top;
-			for (int i = 0; i < data_ey_size; ++i)
+				(int)std::max(std::min(v0->x, std::min(v1->x, v2->x)), (float)m_RectangleView.x1),
+				(int)std::max(std::min(v0->y, std::min(v1->y, v2->y)), (float)m_RectangleView.y1),
+				(int)std::min(std::max(v0->x, std::max(v1->x, v2->x)), (float)m_RectangleView.x2),
+				(int)std::min(std::max(v0->y, std::max(v1->y, v2->y)), (float)m_RectangleView.y2),
+			};
+			int sample_width = rect_sample.x2 - rect_sample.x1;
+			int sample_height = rect_sample.y2 - rect_sample.y1;
+			if (sample_width <= 0 || sample_height <= 0)
 			{
-				data_ey_left[i] += y_offset_clip * change_ey_left[i];
-				data_ey_right[i] += y_offset_clip * change_ey_right[i];
+				++m_RasterizeStatistics.triangle_reject;
+				continue;
 			}
-			y_top = m_RectangleView.y1;
-		}
-		if (y_bottom > m_RectangleView.y2)
-			y_bottom = m_RectangleView.y2;
-
-		//得到除yx之外数据数量
-		const int data_eyx_size = data_ey_size - 1;
-
-		//光栅化
-		for (int y = y_top; y < y_bottom; ++y)
-		{
-			//得到整数化x值
-			int x_left = (int)data_ey_left[0];
-			int x_right = (int)data_ey_right[0];
-
-			//得到整数化x值递增量
-			int x_offset = x_right - x_left;
-
-			//x值递增量大于0绘制
-			if (0 < x_offset)
-			{
-				//得到除yx之外数据初始量
-				float data_eyx[data_eyx_size] = {};
-				for (int i = 0; i < data_eyx_size; ++i)
-					data_eyx[i] = data_ey_left[i + 1];
-
-				//得到除yx之外数据随x递增变化量
-				float change_eyx[data_eyx_size] = {};
-				for (int i = 0; i < data_eyx_size; ++i)
-					change_eyx[i] = (data_ey_right[i + 1] - data_ey_left[i + 1]) / x_offset;
-
-				//x方向裁剪
-				if (x_left < m_RectangleView.x1)
-				{
-					int x_offset_clip = m_RectangleView.x1 - x_left;
-					for (int i = 0; i < data_eyx_size; ++i)
-						data_eyx[i] += x_offset_clip * change_eyx[i];
-					x_left = m_RectangleView.x1;
-				}
-				if (x_right > m_RectangleView.x2)
-					x_right = m_RectangleView.x2;
-
-				//光栅化
-				for (int x = x_left; x < x_right; ++x)
-				{
-					//得到像素下标
-					int pixel_idx = x + y * m_BufferWidth;
-
-					//深度测试
-					if (_FLT_LESS_FLT(m_pDepthBuffer[pixel_idx], data_eyx[0]))
-					{
-						//设置颜色
-						m_pVideoBuffer[pixel_idx] = 
-							m_pTexture->c[(int)(data_eyx[1] / data_eyx[0]) + (int)(data_eyx[2] / data_eyx[0]) * m_pTexture->w];
-
-						//设置深度
-						m_pDepthBuffer[pixel_idx] = data_eyx[0];
-					}
 
-					//除yx之外数据量变化
-					for (int i = 0; i < data_eyx_size; ++i)
-						data_eyx[i] += change_eyx[i];
-				}
-			}
+			//根据渲染状态填充数据
+			int fill_count;
+			if constexpr (0 != TS && 0 != IC)
+				fill_count = Draw3DMeshTriangleFill_ts1_ic1(i0, i1, i2, vertex_data0, vertex_data1, vertex_data2);
+			else if constexpr (0 != TS)
+				fill_count = Draw3DMeshTriangleFill_ts1_ic0(i0, i1, i2, vertex_data0, vertex_data1, vertex_data2);
+			else if constexpr (0 != IC)
+				fill_count = Draw3DMeshTriangleFill_ts0_ic1(i0, i1, i2, vertex_data0, vertex_data1, vertex_data2);
+			else
+				fill_count = Draw3DMeshTriangleFill_ts0_ic0(i0, i1, i2, vertex_data0, vertex_data1, vertex_data2);
 
-			//除y之外数据量变化
-			for (int i = 0; i < data_ey_size; ++i)
+			//小三角逐点采样
+			if (sample_width * sample_height <= _RASTERIZE_POINT_SAMPLE_MAX)
 			{
-				data_ey_left[i] += change_ey_left[i];
-				data_ey_right[i] += change_ey_right[i];
+				++m_RasterizeStatistics.triangle_point_sample;
+				Draw3DMeshTriangleRasterizePoint<TS, IC, AB, DT, DEPTH>(
+					fill_count, vertex_data0, vertex_data1, vertex_data2, &rect_sample);
+				continue;
 			}
-		}
-#undef _DATA_SIZE
-	}
-	void Render::Draw3DMeshTriangleRasterize_ts1_ic0_ab1_dt0(const TRIANGLE_RASTERIZE* triangle_rasterize)
-	{
-		//y、x、1/z、t.x/z、t.y/z
-#define _DATA_SIZE 5
-		_RASTERIZE_TRAVERSE_Y_BEGIN
-		{
-			_RASTERIZE_TRAVERSE_X_BEGIN
-			{
-				//得到纹理颜色
-				int color_texture = 
-					m_pTexture->c[(int)(data_eyx[1] / data_eyx[0]) + (int)(data_eyx[2] / data_eyx[0]) * m_pTexture->w];
+			++m_RasterizeStatistics.triangle_span;
 
-				//设置混合颜色
-				m_pVideoBuffer[pixel_idx] = _COLOR_SET(
-					(int)(_COLOR_GET_R(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_R(color_texture) * m_ForegroundAlphaBlendValue),
-					(int)(_COLOR_GET_G(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_G(color_texture) * m_ForegroundAlphaBlendValue),
-					(int)(_COLOR_GET_B(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_B(color_texture) * m_ForegroundAlphaBlendValue));
-			}
-			_RASTERIZE_TRAVERSE_X_END
-		}
-		_RASTERIZE_TRAVERSE_Y_END
-#undef _DATA_SIZE
-	}
-	void Render::Draw3DMeshTriangleRasterize_ts1_ic0_ab1_dt1(const TRIANGLE_RASTERIZE* triangle_rasterize)
-	{
-		//y、x、1/z、t.x/z、t.y/z
-#define _DATA_SIZE 5
-		_RASTERIZE_TRAVERSE_Y_BEGIN
-		{
-			_RASTERIZE_TRAVERSE_X_BEGIN
-			{
-				//深度测试
-				if (_FLT_LESS_FLT(m_pDepthBuffer[pixel_idx], data_eyx[0]))
-				{
-					//得到纹理颜色
-					int color_texture =
-						m_pTexture->c[(int)(data_eyx[1] / data_eyx[0]) + (int)(data_eyx[2] / data_eyx[0]) * m_pTexture->w];
+			//三角形平底平顶分割
+			int classify_result = TriangleClassify(
+				fill_count,
+				vertex_data0,
+				vertex_data1,
+				vertex_data2,
+				vertex_data3,
+				&triangle_flatbottom,
+				&triangle_flattop);
 
-					//设置混合颜色
-					m_pVideoBuffer[pixel_idx] = _COLOR_SET(
-						(int)(_COLOR_GET_R(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_R(color_texture) * m_ForegroundAlphaBlendValue),
-						(int)(_COLOR_GET_G(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_G(color_texture) * m_ForegroundAlphaBlendValue),
-						(int)(_COLOR_GET_B(m_pVideoBuffer[pixel_idx]) * m_BackgroundAlphaBlendValue + _COLOR_GET_B(color_texture) * m_ForegroundAlphaBlendValue));
+			//平底三角形光栅化
+			if (classify_result & 0x01)
+				Draw3DMeshTriangleRasterize<TS, IC, AB, DT, DEPTH>(&triangle_flatbottom);
 
-					//设置深度
-					m_pDepthBuffer[pixel_idx] = data_eyx[0];
-				}
-			}
-			_RASTERIZE_TRAVERSE_X_END
+			//平顶三角形光栅化
+			if (classify_result & 0x02)
+				Draw3DMeshTriangleRasterize<TS, IC, AB, DT, DEPTH>(&triangle_flattop);
 		}
-		_RASTERIZE_TRAVERSE_Y_END
-#undef _DATA_SIZE
 	}
 
 	Render::Render(const Render& that)
@@ -2832,50 +2652,175 @@ namespace render {
 	}
 
 	Render::Render()
-		: m_SightLineInProjection(0.0f, 0.0f, 1.0f)
+		: m_BufferLayout(_BUFFER_LAYOUT_LINEAR)
+		, m_pVideoBufferLinear(NULL)
+		, m_VideoBufferLinearCapacity(0)
 		, m_pVideoBuffer(NULL)
+		, m_VideoBufferCapacity(0)
 		, m_pDepthBuffer(NULL)
+		, m_DepthBufferCapacity(0)
+		, m_DepthFormat(_DEPTH_FORMAT_FLOAT)
+		, m_DepthScale(1.0)
+		, m_DepthBias(0.0)
+		, m_LazyFillBuffer(false)
+		, m_TileFillPending(false)
+		, m_TileFillColor(0)
+		, m_DynamicResolution(false)
+		, m_DynamicResolutionTargetTime(0.0f)
+		, m_DynamicResolutionScaleMin(1.0f)
+		, m_DynamicResolutionScale(1.0f)
+		, m_RenderWidth(0)
+		, m_RenderHeight(0)
+		, m_FrameScaled(false)
+		, m_pVideoBufferScaled(NULL)
+		, m_VideoBufferScaledCapacity(0)
+		, m_FrameBegin(false)
+		, m_FrameBeginTime(0.0)
+		, m_FrameTime(-1.0f)
 		, m_pTexture(NULL)
 		, m_pSegmentAfterNearPlaneClip(NULL)
+		, m_EnableRenderStateLineAntiAlias(false)
 		, m_pTriangleAfterNearPlaneClip(NULL)
+		, m_EnableRenderStateVertexCompaction(false)
+		, m_LodPixelError(1.0f)
+		, m_RasterizeStatistics()
+		, m_RasterizeInsideView(false)
+		, m_SceneQueueEnable(false)
+		, m_EnableRenderStateOcclusionCulling(false)
+	{
+		m_fDraw3DMeshSegmentRasterize[_BUFFER_LAYOUT_LINEAR][0] = &Render::Draw3DMeshSegmentRasterize_ab0_dt0<_BUFFER_LAYOUT_LINEAR>;
+		m_fDraw3DMeshSegmentRasterize[_BUFFER_LAYOUT_LINEAR][2] = &Render::Draw3DMeshSegmentRasterize_ab1_dt0<_BUFFER_LAYOUT_LINEAR>;
+		m_fDraw3DMeshSegmentRasterize[_BUFFER_LAYOUT_TILED][0] = &Render::Draw3DMeshSegmentRasterize_ab0_dt0<_BUFFER_LAYOUT_TILED>;
+		m_fDraw3DMeshSegmentRasterize[_BUFFER_LAYOUT_TILED][2] = &Render::Draw3DMeshSegmentRasterize_ab1_dt0<_BUFFER_LAYOUT_TILED>;
+
+		m_fDraw3DMeshSegmentRasterizeBatch[_BUFFER_LAYOUT_LINEAR][0] = &Render::Draw3DMeshSegmentRasterizeBatch_ab0_dt0<_BUFFER_LAYOUT_LINEAR>;
+		m_fDraw3DMeshSegmentRasterizeBatch[_BUFFER_LAYOUT_LINEAR][2] = &Render::Draw3DMeshSegmentRasterizeBatch_ab1_dt0<_BUFFER_LAYOUT_LINEAR>;
+		m_fDraw3DMeshSegmentRasterizeBatch[_BUFFER_LAYOUT_TILED][0] = &Render::Draw3DMeshSegmentRasterizeBatch_ab0_dt0<_BUFFER_LAYOUT_TILED>;
+		m_fDraw3DMeshSegmentRasterizeBatch[_BUFFER_LAYOUT_TILED][2] = &Render::Draw3DMeshSegmentRasterizeBatch_ab1_dt0<_BUFFER_LAYOUT_TILED>;
+
+		//不做深度测试的光栅化函数与深度格式无关
+		for (int i = 0; i < 0x20; ++i)
+			m_fDraw3DMeshTriangleRasterizeBatch[i] = NULL;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x04] = &Render::Draw3DMeshTriangleRasterizeBatch<0, 1, 0, _RASTERIZE_DEPTH_NONE, DEPTH_FLOAT>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x06] = &Render::Draw3DMeshTriangleRasterizeBatch<0, 1, 1, _RASTERIZE_DEPTH_NONE, DEPTH_FLOAT>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x08] = &Render::Draw3DMeshTriangleRasterizeBatch<1, 0, 0, _RASTERIZE_DEPTH_NONE, DEPTH_FLOAT>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x0a] = &Render::Draw3DMeshTriangleRasterizeBatch<1, 0, 1, _RASTERIZE_DEPTH_NONE, DEPTH_FLOAT>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x0c] = &Render::Draw3DMeshTriangleRasterizeBatch<1, 1, 0, _RASTERIZE_DEPTH_NONE, DEPTH_FLOAT>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x0e] = &Render::Draw3DMeshTriangleRasterizeBatch<1, 1, 1, _RASTERIZE_DEPTH_NONE, DEPTH_FLOAT>;
+
+		//深度测试相关函数按深度格式设置
+		SetDepthFormatFunction<DEPTH_FLOAT>();
+
+		//管线临时内存，初始块不够时按峰值扩大
+		m_pScratchArena = ScratchArenaCreate(_SCRATCH_ARENA_INITIAL_SIZE);
+		ResetScratch();
+	}
+
+	template <typename DEPTH>
+	void Render::SetDepthFormatFunction()
+	{
+		m_fDraw3DMeshSegmentRasterize[_BUFFER_LAYOUT_LINEAR][1] = &Render::Draw3DMeshSegmentRasterize_ab0_dt1<DEPTH, _BUFFER_LAYOUT_LINEAR>;
+		m_fDraw3DMeshSegmentRasterize[_BUFFER_LAYOUT_LINEAR][3] = &Render::Draw3DMeshSegmentRasterize_ab1_dt1<DEPTH, _BUFFER_LAYOUT_LINEAR>;
+		m_fDraw3DMeshSegmentRasterize[_BUFFER_LAYOUT_TILED][1] = &Render::Draw3DMeshSegmentRasterize_ab0_dt1<DEPTH, _BUFFER_LAYOUT_TILED>;
+		m_fDraw3DMeshSegmentRasterize[_BUFFER_LAYOUT_TILED][3] = &Render::Draw3DMeshSegmentRasterize_ab1_dt1<DEPTH, _BUFFER_LAYOUT_TILED>;
+
+		m_fDraw3DMeshSegmentRasterizeBatch[_BUFFER_LAYOUT_LINEAR][1] = &Render::Draw3DMeshSegmentRasterizeBatch_ab0_dt1<DEPTH, _BUFFER_LAYOUT_LINEAR>;
+		m_fDraw3DMeshSegmentRasterizeBatch[_BUFFER_LAYOUT_LINEAR][3] = &Render::Draw3DMeshSegmentRasterizeBatch_ab1_dt1<DEPTH, _BUFFER_LAYOUT_LINEAR>;
+		m_fDraw3DMeshSegmentRasterizeBatch[_BUFFER_LAYOUT_TILED][1] = &Render::Draw3DMeshSegmentRasterizeBatch_ab0_dt1<DEPTH, _BUFFER_LAYOUT_TILED>;
+		m_fDraw3DMeshSegmentRasterizeBatch[_BUFFER_LAYOUT_TILED][3] = &Render::Draw3DMeshSegmentRasterizeBatch_ab1_dt1<DEPTH, _BUFFER_LAYOUT_TILED>;
+
+		m_fDraw3DMeshSegmentRasterizeBatchAntiAlias = &Render::Draw3DMeshSegmentRasterizeBatchAntiAlias<DEPTH>;
+
+		m_fDraw3DMeshTriangleRasterizeBatch[0x05] = &Render::Draw3DMeshTriangleRasterizeBatch<0, 1, 0, _RASTERIZE_DEPTH_LESS, DEPTH>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x07] = &Render::Draw3DMeshTriangleRasterizeBatch<0, 1, 1, _RASTERIZE_DEPTH_LESS, DEPTH>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x09] = &Render::Draw3DMeshTriangleRasterizeBatch<1, 0, 0, _RASTERIZE_DEPTH_LESS, DEPTH>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x0b] = &Render::Draw3DMeshTriangleRasterizeBatch<1, 0, 1, _RASTERIZE_DEPTH_LESS, DEPTH>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x0d] = &Render::Draw3DMeshTriangleRasterizeBatch<1, 1, 0, _RASTERIZE_DEPTH_LESS, DEPTH>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x0f] = &Render::Draw3DMeshTriangleRasterizeBatch<1, 1, 1, _RASTERIZE_DEPTH_LESS, DEPTH>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x15] = &Render::Draw3DMeshTriangleRasterizeBatch<0, 1, 0, _RASTERIZE_DEPTH_EQUAL, DEPTH>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x17] = &Render::Draw3DMeshTriangleRasterizeBatch<0, 1, 1, _RASTERIZE_DEPTH_EQUAL, DEPTH>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x19] = &Render::Draw3DMeshTriangleRasterizeBatch<1, 0, 0, _RASTERIZE_DEPTH_EQUAL, DEPTH>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x1b] = &Render::Draw3DMeshTriangleRasterizeBatch<1, 0, 1, _RASTERIZE_DEPTH_EQUAL, DEPTH>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x1d] = &Render::Draw3DMeshTriangleRasterizeBatch<1, 1, 0, _RASTERIZE_DEPTH_EQUAL, DEPTH>;
+		m_fDraw3DMeshTriangleRasterizeBatch[0x1f] = &Render::Draw3DMeshTriangleRasterizeBatch<1, 1, 1, _RASTERIZE_DEPTH_EQUAL, DEPTH>;
+
+		m_fDraw3DMeshTriangleRasterizeBatchDepthOnly = &Render::Draw3DMeshTriangleRasterizeBatch<0, 0, 0, _RASTERIZE_DEPTH_ONLY, DEPTH>;
+	}
+
+	void Render::UpdateDepthFormat()
 	{
-		m_fDraw3DMeshSegmentRasterize[0] = &Render::Draw3DMeshSegmentRasterize_ab0_dt0;
-		m_fDraw3DMeshSegmentRasterize[1] = &Render::Draw3DMeshSegmentRasterize_ab0_dt1;
-		m_fDraw3DMeshSegmentRasterize[2] = &Render::Draw3DMeshSegmentRasterize_ab1_dt0;
-		m_fDraw3DMeshSegmentRasterize[3] = &Render::Draw3DMeshSegmentRasterize_ab1_dt1;
-
-		m_fDraw3DMeshTriangleNearPlaneClip[0] = &Render::Draw3DMeshTriangleNearPlaneClip_ts0_ic0;
-		m_fDraw3DMeshTriangleNearPlaneClip[1] = &Render::Draw3DMeshTriangleNearPlaneClip_ts0_ic1;
-		m_fDraw3DMeshTriangleNearPlaneClip[2] = &Render::Draw3DMeshTriangleNearPlaneClip_ts1_ic0;
-		m_fDraw3DMeshTriangleNearPlaneClip[3] = &Render::Draw3DMeshTriangleNearPlaneClip_ts1_ic1;
-
-		m_fDraw3DMeshTriangleFill[0] = &Render::Draw3DMeshTriangleFill_ts0_ic0;
-		m_fDraw3DMeshTriangleFill[1] = &Render::Draw3DMeshTriangleFill_ts0_ic1;
-		m_fDraw3DMeshTriangleFill[2] = &Render::Draw3DMeshTriangleFill_ts1_ic0;
-		m_fDraw3DMeshTriangleFill[3] = &Render::Draw3DMeshTriangleFill_ts1_ic1;
-
-		m_fDraw3DMeshTriangleRasterize[0x0] = NULL;
-		m_fDraw3DMeshTriangleRasterize[0x1] = NULL;
-		m_fDraw3DMeshTriangleRasterize[0x2] = NULL;
-		m_fDraw3DMeshTriangleRasterize[0x3] = NULL;
-		m_fDraw3DMeshTriangleRasterize[0x4] = &Render::Draw3DMeshTriangleRasterize_ts0_ic1_ab0_dt0;
-		m_fDraw3DMeshTriangleRasterize[0x5] = &Render::Draw3DMeshTriangleRasterize_ts0_ic1_ab0_dt1;
-		m_fDraw3DMeshTriangleRasterize[0x6] = &Render::Draw3DMeshTriangleRasterize_ts0_ic1_ab1_dt0;
-		m_fDraw3DMeshTriangleRasterize[0x7] = &Render::Draw3DMeshTriangleRasterize_ts0_ic1_ab1_dt1;
-		m_fDraw3DMeshTriangleRasterize[0x8] = &Render::Draw3DMeshTriangleRasterize_ts1_ic0_ab0_dt0;
-		m_fDraw3DMeshTriangleRasterize[0x9] = &Render::Draw3DMeshTriangleRasterize_ts1_ic0_ab0_dt1;
-		m_fDraw3DMeshTriangleRasterize[0xa] = &Render::Draw3DMeshTriangleRasterize_ts1_ic0_ab1_dt0;
-		m_fDraw3DMeshTriangleRasterize[0xb] = &Render::Draw3DMeshTriangleRasterize_ts1_ic0_ab1_dt1;
-		m_fDraw3DMeshTriangleRasterize[0xc] = NULL;
-		m_fDraw3DMeshTriangleRasterize[0xd] = NULL;
-		m_fDraw3DMeshTriangleRasterize[0xe] = NULL;
-		m_fDraw3DMeshTriangleRasterize[0xf] = NULL;
+		//定点格式把[1/远截面, 1/近截面]线性映射到[0, 最大值]
+		double z_reciprocal_near = 1.0 / m_NearPlaneZInCamera;
+		double z_reciprocal_far = 1.0 / m_FarPlaneZInCamera;
+		m_DepthBias = z_reciprocal_far;
+		switch (m_DepthFormat)
+		{
+		case _DEPTH_FORMAT_UNORM16:
+			m_DepthScale = (double)0xffff / (z_reciprocal_near - z_reciprocal_far);
+			SetDepthFormatFunction<DEPTH_UNORM16>();
+			break;
+		case _DEPTH_FORMAT_FIXED24:
+			m_DepthScale = (double)0xffffff / (z_reciprocal_near - z_reciprocal_far);
+			SetDepthFormatFunction<DEPTH_FIXED24>();
+			break;
+		case _DEPTH_FORMAT_FIXED32:
+			m_DepthScale = (double)0xffffffff / (z_reciprocal_near - z_reciprocal_far);
+			SetDepthFormatFunction<DEPTH_FIXED32>();
+			break;
+		default:
+			m_DepthScale = 1.0;
+			m_DepthBias = 0.0;
+			SetDepthFormatFunction<DEPTH_FLOAT>();
+			break;
+		}
 	}
 
 	//析构
 	Render::~Render()
 	{
 		End();
+		ScratchArenaRelease(m_pScratchArena);
+	}
+
+	void Render::ResetScratch()
+	{
+		ScratchArenaReset(m_pScratchArena);
+
+		m_VertexInWorld.Reset(m_pScratchArena);
+		m_VertexInCamera.Reset(m_pScratchArena);
+		m_VertexInProjection.Reset(m_pScratchArena);
+		m_VertexInView.Reset(m_pScratchArena);
+		m_SegmentVertex.Reset(m_pScratchArena);
+		m_NormalInWorld.Reset(m_pScratchArena);
+		m_ColorAfterIlluminationCompute.Reset(m_pScratchArena);
+		m_TextureCopy.Reset(m_pScratchArena);
+		m_TriangleAfterFaceCulling.Reset(m_pScratchArena);
+		m_VertexViewOutcode.Reset(m_pScratchArena);
+		m_VertexValidMask.Reset(m_pScratchArena);
+		m_VertexCompactionIndex.Reset(m_pScratchArena);
+		m_NormalCompaction.Reset(m_pScratchArena);
+	}
+
+	size_t Render::GetScratchPeakBytes()
+	{
+		return ScratchArenaPeakBytes(m_pScratchArena);
+	}
+
+	void Render::SetLodPixelError(float lod_pixel_error)
+	{
+		m_LodPixelError = lod_pixel_error;
+	}
+
+	void Render::ClearRasterizeStatistics()
+	{
+		m_RasterizeStatistics.triangle_reject = 0;
+		m_RasterizeStatistics.triangle_point_sample = 0;
+		m_RasterizeStatistics.triangle_span = 0;
+	}
+
+	const RASTERIZE_STATISTICS* Render::GetRasterizeStatistics()
+	{
+		return &m_RasterizeStatistics;
 	}
 
 	void Render::Init(
@@ -2887,17 +2832,47 @@ namespace render {
 		int default_texture_color,
 		const vector3* eye,
 		const vector3* at,
-		const vector3* up)
+		const vector3* up,
+		int buffer_pitch)
 	{
-		End();
+		//结束未完成的按内部分辨率绘制的帧，之后总是以原始分辨率开始
+		if (m_FrameScaled)
+		{
+			std::swap(m_pVideoBuffer, m_pVideoBufferScaled);
+			std::swap(m_VideoBufferCapacity, m_VideoBufferScaledCapacity);
+			m_FrameScaled = false;
+		}
+		m_DynamicResolution = false;
+		m_DynamicResolutionScale = 1.0f;
+		m_FrameBegin = false;
+		m_FrameTime = -1.0f;
+		m_OverlayAsciiString.clear();
+		m_OverlayText.clear();
 
 		m_BufferWidth = buffer_width;
 		m_BufferHeight = buffer_height;
 		m_BufferSize = m_BufferWidth * m_BufferHeight;
+		m_RenderWidth = m_BufferWidth;
+		m_RenderHeight = m_BufferHeight;
+
+		//行间距不小于宽度并按像素对齐，使每行起点都按_BUFFER_ALIGN对齐
+		m_BufferPitch = std::max(buffer_pitch, buffer_width);
+		m_BufferPitch = (m_BufferPitch + _BUFFER_PITCH_ALIGN_PIXEL - 1) / _BUFFER_PITCH_ALIGN_PIXEL * _BUFFER_PITCH_ALIGN_PIXEL;
+
+		//行数按块尺寸对齐，分块布局最后一行块不越界
+		m_BufferStorageSize = m_BufferPitch * ((m_BufferHeight + _BUFFER_BLOCK_SIZE - 1) / _BUFFER_BLOCK_SIZE * _BUFFER_BLOCK_SIZE);
+		UpdateBufferLayout();
 
-		m_pVideoBuffer = (int*)malloc(sizeof(int) * m_BufferSize);
+		//再次初始时容量足够则重用原来的缓冲
+		void* video_buffer = m_pVideoBuffer;
+		BufferReserve(&video_buffer, &m_VideoBufferCapacity, sizeof(int) * m_BufferStorageSize);
+		m_pVideoBuffer = (int*)video_buffer;
+		BufferReserve(&m_pDepthBuffer, &m_DepthBufferCapacity, DepthFormatSize(m_DepthFormat) * m_BufferStorageSize);
 
-		m_pDepthBuffer = (float*)malloc(sizeof(float) * m_BufferSize);
+		m_TileColumn = (m_BufferWidth + (1 << _TILE_SIZE_SHIFT) - 1) >> _TILE_SIZE_SHIFT;
+		m_TileRow = (m_BufferHeight + (1 << _TILE_SIZE_SHIFT) - 1) >> _TILE_SIZE_SHIFT;
+		m_TileFill.assign(m_TileColumn * m_TileRow, 0);
+		m_TileFillPending = false;
 
 		m_TransformWorld.Indentity();
 		matrix4 transform_camera;
@@ -2912,6 +2887,7 @@ namespace render {
 
 		m_NearPlaneZInCamera = near_plane_z_in_camera;
 		m_FarPlaneZInCamera = far_plane_z_in_camera;
+		UpdateDepthFormat();
 
 		m_VertexInWorld.clear();
 		m_VertexInCamera.clear();
@@ -2919,6 +2895,9 @@ namespace render {
 		m_VertexInView.clear();
 
 		m_EnableRenderStateDepthTest = false;
+		m_DepthTestEqual = false;
+
+		m_EnableRenderStateDepthOnly = false;
 
 		m_EnableRenderStateAlphaBlend = false;
 		m_ForegroundAlphaBlendValue = foreground_alpha_blend_value;
@@ -2955,11 +2934,29 @@ namespace render {
 		m_pTriangleAfterNearPlaneClip = NULL;
 		
 		m_TriangleAfterFaceCulling.clear();
+
+		m_EnableRenderStateVertexCompaction = false;
+		m_TriangleAfterCompaction.clear();
+
+		m_LodPixelError = 1.0f;
+
+		ClearRasterizeStatistics();
+
+		ClearDrawCommand();
+		m_SceneQueueEnable = false;
+
+		m_EnableRenderStateLineAntiAlias = false;
+
+		m_EnableRenderStateOcclusionCulling = false;
+		m_OcclusionBuffer.resize(_OCCLUSION_BUFFER_WIDTH * _OCCLUSION_BUFFER_HEIGHT);
+		ClearOcclusionBuffer();
+		m_OccluderVertex.clear();
 	}
 
 	int Render::GetBufferSize(
 		int* buffer_width,
-		int* buffer_height)
+		int* buffer_height,
+		int* buffer_pitch)
 	{
 		if (NULL != buffer_width)
 			*buffer_width = m_BufferWidth;
@@ -2967,26 +2964,183 @@ namespace render {
 		if (NULL != buffer_height)
 			*buffer_height = m_BufferHeight;
 
+		if (NULL != buffer_pitch)
+			*buffer_pitch = m_BufferPitch;
+
 		return m_BufferSize;
 	}
 
 	const int* Render::GetVideoBuffer()
 	{
-		return m_pVideoBuffer;
+		//读取之前填充剩余的待填充块
+		if (m_TileFillPending)
+			FillTileAll();
+
+		//按内部分辨率绘制的帧放大到显示缓冲，恢复原始分辨率之后绘制延迟的文字
+		if (m_FrameScaled)
+		{
+			std::swap(m_pVideoBuffer, m_pVideoBufferScaled);
+			std::swap(m_VideoBufferCapacity, m_VideoBufferScaledCapacity);
+			m_FrameScaled = false;
+			UpscaleVideoBuffer();
+
+			m_RenderWidth = m_BufferWidth;
+			m_RenderHeight = m_BufferHeight;
+			UpdateTransformView();
+
+			int overlay_count = (int)m_OverlayAsciiString.size();
+			for (int i = 0; i < overlay_count; ++i)
+			{
+				const OVERLAY_ASCII_STRING* overlay = &m_OverlayAsciiString[i];
+				Draw2DAsciiString(
+					overlay->ascii_font,
+					overlay->x_max_count, overlay->y_max_count,
+					overlay->x, overlay->y,
+					&m_OverlayText[overlay->text_offset]);
+			}
+			m_OverlayAsciiString.clear();
+			m_OverlayText.clear();
+		}
+
+		//帧用时包括放大
+		if (m_FrameBegin)
+		{
+			m_FrameTime = (float)(GetTimeMillisecond() - m_FrameBeginTime);
+			m_FrameBegin = false;
+		}
+
+		if (_BUFFER_LAYOUT_LINEAR == m_BufferLayout)
+			return m_pVideoBuffer;
+
+		//分块布局转换为线性排列，每个块的一行为8个像素，两次16字节对齐读写
+		void* video_buffer_linear = m_pVideoBufferLinear;
+		BufferReserve(&video_buffer_linear, &m_VideoBufferLinearCapacity, sizeof(int) * m_BufferStorageSize);
+		m_pVideoBufferLinear = (int*)video_buffer_linear;
+		int block_column = m_BufferPitch / _BUFFER_BLOCK_SIZE;
+		for (int y = 0; y < m_BufferHeight; ++y)
+		{
+			const int* src = m_pVideoBuffer + m_PixelOffsetY[y];
+			int* dest = m_pVideoBufferLinear + y * m_BufferPitch;
+			for (int i = 0; i < block_column; ++i)
+			{
+#ifdef _RENDER_SSE2
+				_mm_store_si128((__m128i*)dest, _mm_load_si128((const __m128i*)src));
+				_mm_store_si128((__m128i*)(dest + 4), _mm_load_si128((const __m128i*)(src + 4)));
+#else
+				memcpy(dest, src, sizeof(int) * _BUFFER_BLOCK_SIZE);
+#endif
+				src += _BUFFER_BLOCK_SIZE * _BUFFER_BLOCK_SIZE;
+				dest += _BUFFER_BLOCK_SIZE;
+			}
+		}
+		return m_pVideoBufferLinear;
+	}
+
+	void Render::UpscaleVideoBuffer()
+	{
+		//目标像素中心映射到源像素坐标，权重为8位定点数，超出源区域的部分重复边缘像素
+		int src_width = m_RenderWidth;
+		int src_height = m_RenderHeight;
+		float ratio_x = (float)src_width / m_BufferWidth;
+		float ratio_y = (float)src_height / m_BufferHeight;
+
+		m_UpscaleX.resize(m_BufferWidth * 2);
+		m_UpscaleWeightX.resize(m_BufferWidth);
+		for (int x = 0; x < m_BufferWidth; ++x)
+		{
+			float sx = std::max((x + 0.5f) * ratio_x - 0.5f, 0.0f);
+			int x0 = std::min((int)sx, src_width - 1);
+			int x1 = std::min(x0 + 1, src_width - 1);
+			m_UpscaleX[x * 2] = m_PixelOffsetX[x0];
+			m_UpscaleX[x * 2 + 1] = m_PixelOffsetX[x1];
+			m_UpscaleWeightX[x] = x0 == x1 ? 0 : (int)((sx - x0) * 256.0f);
+		}
+
+		//两行水平插值结果按源行号奇偶缓存，相邻的两个源行总在不同的缓存行中，相邻目标行多数时候共用源行
+		m_UpscaleRow[0].resize(m_BufferWidth * 4);
+		m_UpscaleRow[1].resize(m_BufferWidth * 4);
+		int row_y[2] = { -1, -1 };
+
+		const int* src = m_pVideoBufferScaled;
+		for (int y = 0; y < m_BufferHeight; ++y)
+		{
+			float sy = std::max((y + 0.5f) * ratio_y - 0.5f, 0.0f);
+			int y0 = std::min((int)sy, src_height - 1);
+			int y1 = std::min(y0 + 1, src_height - 1);
+			int wy = y0 == y1 ? 0 : (int)((sy - y0) * 256.0f);
+
+			int sy_load[2] = { y0, y1 };
+			for (int i = 0; i < 2; ++i)
+			{
+				int slot = sy_load[i] & 1;
+				if (row_y[slot] == sy_load[i])
+					continue;
+				UpscaleRowHorizontal(
+					src + m_PixelOffsetY[sy_load[i]],
+					&m_UpscaleX[0],
+					&m_UpscaleWeightX[0],
+					m_BufferWidth,
+					&m_UpscaleRow[slot][0]);
+				row_y[slot] = sy_load[i];
+			}
+
+			//垂直插值，每4个像素在两种布局下都连续，SSE2下一次写入
+			const unsigned short* row0 = &m_UpscaleRow[y0 & 1][0];
+			const unsigned short* row1 = &m_UpscaleRow[y1 & 1][0];
+			int* dest = m_pVideoBuffer + m_PixelOffsetY[y];
+			int x = 0;
+#ifdef _RENDER_SSE2
+			const __m128i w1 = _mm_set1_epi16((short)wy);
+			const __m128i w0 = _mm_set1_epi16((short)(256 - wy));
+			for (; x + 4 <= m_BufferWidth; x += 4)
+			{
+				__m128i a = _mm_srli_epi16(_mm_add_epi16(
+					_mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(row0 + x * 4)), w0),
+					_mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(row1 + x * 4)), w1)), 8);
+				__m128i b = _mm_srli_epi16(_mm_add_epi16(
+					_mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(row0 + x * 4 + 8)), w0),
+					_mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(row1 + x * 4 + 8)), w1)), 8);
+				_mm_storeu_si128((__m128i*)(dest + m_PixelOffsetX[x]), _mm_packus_epi16(a, b));
+			}
+#endif
+			for (; x < m_BufferWidth; ++x)
+			{
+				unsigned int color = 0;
+				for (int c = 0; c < 4; ++c)
+					color |= (unsigned int)((row0[x * 4 + c] * (256 - wy) + row1[x * 4 + c] * wy) >> 8) << (c * 8);
+				dest[m_PixelOffsetX[x]] = (int)color;
+			}
+		}
 	}
 
 	void Render::End()
 	{
 		if (NULL != m_pDepthBuffer)
 		{
-			free(m_pDepthBuffer);
+			BufferFree(m_pDepthBuffer);
 			m_pDepthBuffer = NULL;
+			m_DepthBufferCapacity = 0;
 		}
 			
 		if (NULL != m_pVideoBuffer)
 		{
-			free(m_pVideoBuffer);
+			BufferFree(m_pVideoBuffer);
 			m_pVideoBuffer = NULL;
+			m_VideoBufferCapacity = 0;
+		}
+
+		if (NULL != m_pVideoBufferLinear)
+		{
+			BufferFree(m_pVideoBufferLinear);
+			m_pVideoBufferLinear = NULL;
+			m_VideoBufferLinearCapacity = 0;
+		}
+
+		if (NULL != m_pVideoBufferScaled)
+		{
+			BufferFree(m_pVideoBufferScaled);
+			m_pVideoBufferScaled = NULL;
+			m_VideoBufferScaledCapacity = 0;
 		}
 	}
 
@@ -2994,7 +3148,7 @@ namespace render {
 	{
 		//得到缓冲矩形
 		RECTANGLE buffer_rectangle =
-			{ 0, 0, m_BufferWidth, m_BufferHeight };
+			{ 0, 0, m_RenderWidth, m_RenderHeight };
 
 		//创建结果
 		SEGMENT r_seg = *seg;
@@ -3003,15 +3157,25 @@ namespace render {
 		if (!SegmentClip(&buffer_rectangle, &r_seg))
 			return;
 
-		//得到起始显示缓冲地址
-		int* current_video_buffer
-			= m_pVideoBuffer + r_seg.y1 * m_BufferWidth + r_seg.x1;
+		//延迟填充线段包围矩形内的块
+		RECTANGLE fill_rect =
+		{
+			std::min(r_seg.x1, r_seg.x2),
+			std::min(r_seg.y1, r_seg.y2),
+			std::max(r_seg.x1, r_seg.x2) + 1,
+			std::max(r_seg.y1, r_seg.y2) + 1,
+		};
+		FillTile(&fill_rect);
+
+		//得到起始像素坐标
+		int x = r_seg.x1;
+		int y = r_seg.y1;
 
 		//得到x、y方向的差值
 		int delta_x = r_seg.x2 - r_seg.x1;
 		int delta_y = r_seg.y2 - r_seg.y1;
 
-		//得到x、y方向递增1个像素对应的字节递增量
+		//得到x、y方向的递增量
 		int add_x, add_y;
 		if (delta_x < 0)
 		{
@@ -3023,10 +3187,10 @@ namespace render {
 		if (delta_y < 0)
 		{
 			delta_y = -delta_y;
-			add_y = -m_BufferWidth;
+			add_y = -1;
 		}
 		else
-			add_y = m_BufferWidth;
+			add_y = 1;
 
 		//得到x、y方向的差值的2倍
 		int delta_2x = delta_x << 1;
@@ -3041,16 +3205,18 @@ namespace render {
 			//循环绘制
 			for (int i = delta_x; i >= 0; --i)
 			{
-				*current_video_buffer = color;
+				int pixel_idx = _PIXEL_INDEX(x, y);
+
+				m_pVideoBuffer[pixel_idx] = color;
 
 				//根据p值进行处理
 				if (p >= 0)
 				{
-					current_video_buffer += add_y;
+					y += add_y;
 					p -= delta_2x;
 				}
 
-				current_video_buffer += add_x;
+				x += add_x;
 				p += delta_2y;
 			}
 		}
@@ -3062,16 +3228,18 @@ namespace render {
 			//循环绘制
 			for (int i = delta_y; i >= 0; --i)
 			{
-				*current_video_buffer = color;
+				int pixel_idx = _PIXEL_INDEX(x, y);
+
+				m_pVideoBuffer[pixel_idx] = color;
 
 				//根据p值进行处理
 				if (p >= 0)
 				{
-					current_video_buffer += add_x;
+					x += add_x;
 					p -= delta_2y;
 				}
 
-				current_video_buffer += add_y;
+				y += add_y;
 				p += delta_2x;
 			}
 		}
@@ -3081,7 +3249,7 @@ namespace render {
 	{
 		//得到缓冲矩形
 		RECTANGLE buffer_rectangle =
-		{ 0, 0, m_BufferWidth, m_BufferHeight };
+		{ 0, 0, m_RenderWidth, m_RenderHeight };
 
 		//创建结果
 		RECTANGLE r_rect = {};
@@ -3090,11 +3258,13 @@ namespace render {
 		if (!RectangleIntersect(rect, &buffer_rectangle, &r_rect))
 			return;
 
+		FillTile(&r_rect);
+
 		for (int y = r_rect.y1; y < r_rect.y2; ++y)
 		{
 			for (int x = r_rect.x1; x < r_rect.x2; ++x)
 			{
-				m_pVideoBuffer[x + y * m_BufferWidth] = color;
+				m_pVideoBuffer[_PIXEL_INDEX(x, y)] = color;
 			}
 		}
 	}
@@ -3132,7 +3302,7 @@ namespace render {
 
 		//得到缓冲矩形
 		RECTANGLE b_rect =
-		{ 0, 0, m_BufferWidth, m_BufferHeight };
+		{ 0, 0, m_RenderWidth, m_RenderHeight };
 
 		//创建结果
 		RECTANGLE r2_rect;
@@ -3141,6 +3311,8 @@ namespace render {
 		if (!RectangleIntersect(&d_rect, &b_rect, &r2_rect))
 			return;
 
+		FillTile(&r2_rect);
+
 		//更新源矩形
 		r1_rect.x1 += r2_rect.x1 - d_rect.x1;
 		r1_rect.y1 += r2_rect.y1 - d_rect.y1;
@@ -3154,7 +3326,7 @@ namespace render {
 			{
 				for (int sx = r1_rect.x1, dx = r2_rect.x1; sx < r1_rect.x2; ++sx, ++dx)
 				{
-					m_pVideoBuffer[dx + dy * m_BufferWidth] = texture->c[sx + sy * texture->w];
+					m_pVideoBuffer[_PIXEL_INDEX(dx, dy)] = texture->c[sx + sy * texture->w];
 				}
 			}
 		}
@@ -3168,7 +3340,7 @@ namespace render {
 				{
 					int color = texture->c[sx + sy * texture->w];
 					if (tc != color)
-						m_pVideoBuffer[dx + dy * m_BufferWidth] = color;
+						m_pVideoBuffer[_PIXEL_INDEX(dx, dy)] = color;
 				}
 			}
 		}
@@ -3180,6 +3352,16 @@ namespace render {
 		int x, int y,
 		const char* str)
 	{
+		//按内部分辨率绘制时记录下来，放大之后按原始分辨率绘制
+		if (m_FrameScaled)
+		{
+			OVERLAY_ASCII_STRING overlay_ascii_string =
+				{ ascii_font, x_max_count, y_max_count, x, y, (int)m_OverlayText.size() };
+			m_OverlayAsciiString.push_back(overlay_ascii_string);
+			m_OverlayText.insert(m_OverlayText.end(), str, str + strlen(str) + 1);
+			return;
+		}
+
 		//得到字体长度
 		int len = (int)strlen(str);
 
@@ -3217,10 +3399,39 @@ namespace render {
 
 		m_NearPlaneZInCamera = near_plane;
 		m_FarPlaneZInCamera = far_plane;
+		UpdateDepthFormat();
 
 		return true;
 	}
 
+	void Render::GetCoordinateCameraFrustumPlaneInWorld(float plane[6][4])
+	{
+		//摄像机坐标系下截面，视野为90度，即|x|<=z、|y|<=z
+		const float s = 0.70710678f;
+		const float plane_in_camera[6][4] =
+		{
+			{ 0.0f, 0.0f, 1.0f, -m_NearPlaneZInCamera },
+			{ 0.0f, 0.0f, -1.0f, m_FarPlaneZInCamera },
+			{ s, 0.0f, s, 0.0f },
+			{ -s, 0.0f, s, 0.0f },
+			{ 0.0f, s, s, 0.0f },
+			{ 0.0f, -s, s, 0.0f },
+		};
+
+		//摄像机变换为刚体变换，截面变换到世界坐标系为摄像机变换矩阵乘以截面列向量
+		for (int i = 0; i < 6; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				plane[i][j] =
+					m_TransformCamera.e[j * 4 + 0] * plane_in_camera[i][0] +
+					m_TransformCamera.e[j * 4 + 1] * plane_in_camera[i][1] +
+					m_TransformCamera.e[j * 4 + 2] * plane_in_camera[i][2] +
+					m_TransformCamera.e[j * 4 + 3] * plane_in_camera[i][3];
+			}
+		}
+	}
+
 	bool Render::SetTransform(
 		int transform_type,
 		const matrix4* mat4)
@@ -3244,13 +3455,9 @@ namespace render {
 			}
 		case _COORDINATE_VIEW:
 		{
-			//视口变换矩阵记录视口矩形
-			m_RectangleView.x1 = (int)(mat4->e[_M4_41] - mat4->e[_M4_11]);
-			m_RectangleView.y1 = (int)(mat4->e[_M4_42] + mat4->e[_M4_22]);
-			m_RectangleView.x2 = m_RectangleView.x1 + (int)(mat4->e[_M4_11] * 2.0f);
-			m_RectangleView.y2 = m_RectangleView.y1 + (int)(-mat4->e[_M4_22] * 2.0f);
-
-			m_TransformView = *mat4;
+			//按内部分辨率缩放之后使用
+			m_TransformViewNative = *mat4;
+			UpdateTransformView();
 			break;
 		}
 		default:
@@ -3260,6 +3467,36 @@ namespace render {
 		return true;
 	}
 
+	void Render::UpdateTransformView()
+	{
+		//视口变换矩阵记录视口矩形
+		const matrix4* mat4 = &m_TransformViewNative;
+		RECTANGLE rect;
+		rect.x1 = (int)(mat4->e[_M4_41] - mat4->e[_M4_11]);
+		rect.y1 = (int)(mat4->e[_M4_42] + mat4->e[_M4_22]);
+		rect.x2 = rect.x1 + (int)(mat4->e[_M4_11] * 2.0f);
+		rect.y2 = rect.y1 + (int)(-mat4->e[_M4_22] * 2.0f);
+
+		m_TransformView = *mat4;
+		m_RectangleView = rect;
+		if (m_RenderWidth == m_BufferWidth && m_RenderHeight == m_BufferHeight)
+			return;
+
+		//视口坐标右乘缩放矩阵，即每行的前两列分别乘以x、y缩放，视口矩形按缩放后四舍五入，
+		//相邻视口的边界缩放后仍然重合
+		float scale_x = (float)m_RenderWidth / m_BufferWidth;
+		float scale_y = (float)m_RenderHeight / m_BufferHeight;
+		for (int i = 0; i < 4; ++i)
+		{
+			m_TransformView.e[i * 4 + 0] *= scale_x;
+			m_TransformView.e[i * 4 + 1] *= scale_y;
+		}
+		m_RectangleView.x1 = (int)floor(rect.x1 * scale_x + 0.5f);
+		m_RectangleView.y1 = (int)floor(rect.y1 * scale_y + 0.5f);
+		m_RectangleView.x2 = (int)floor(rect.x2 * scale_x + 0.5f);
+		m_RectangleView.y2 = (int)floor(rect.y2 * scale_y + 0.5f);
+	}
+
 	bool Render::EnableRenderState(
 		int render_state_type,
 		bool enable)
@@ -3291,6 +3528,26 @@ namespace render {
 				m_EnableRenderStateTextureSample = enable;
 				break;
 			}
+		case _RENDER_STATE_DEPTH_ONLY:
+			{
+				m_EnableRenderStateDepthOnly = enable;
+				break;
+			}
+		case _RENDER_STATE_OCCLUSION_CULLING:
+			{
+				m_EnableRenderStateOcclusionCulling = enable;
+				break;
+			}
+		case _RENDER_STATE_LINE_ANTI_ALIAS:
+			{
+				m_EnableRenderStateLineAntiAlias = enable;
+				break;
+			}
+		case _RENDER_STATE_VERTEX_COMPACTION:
+			{
+				m_EnableRenderStateVertexCompaction = enable;
+				break;
+			}
 		default:
 			return false;
 		}
@@ -3303,25 +3560,304 @@ namespace render {
 		int color,
 		bool depth)
 	{
+		int flag =
+			(video ? _TILE_FILL_VIDEO : 0) |
+			(depth ? _TILE_FILL_DEPTH : 0);
+		if (0 == flag)
+			return;
 		if (video)
+			m_TileFillColor = color;
+
+		//延迟填充只标记块
+		if (m_LazyFillBuffer)
 		{
-			for (int i = m_BufferSize - 1; i >= 0; --i)
-				m_pVideoBuffer[i] = color;
+			int tile_count = (int)m_TileFill.size();
+			for (int i = 0; i < tile_count; ++i)
+				m_TileFill[i] |= flag;
+			m_TileFillPending = true;
+			return;
 		}
+
+		//按内部分辨率绘制时只填充内部分辨率区域所在的行，两种布局下都是缓冲前部
+		int fill_count = m_BufferStorageSize;
+		if (m_FrameScaled)
+			fill_count = std::min(fill_count, (m_RenderHeight + _BUFFER_BLOCK_SIZE - 1) / _BUFFER_BLOCK_SIZE * _BUFFER_BLOCK_SIZE * m_BufferPitch);
+
+		if (video)
+			FillMemory(m_pVideoBuffer, color, fill_count, true);
 		if (depth)
+			FillDepthBuffer(0, fill_count, true);
+
+		//已经填充的缓冲不再需要延迟填充
+		if (m_TileFillPending)
 		{
-			float one_div_far = 1.0f / m_FarPlaneZInCamera;
-			for (int i = m_BufferSize - 1; i >= 0; --i)
-				m_pDepthBuffer[i] = one_div_far;
+			int tile_count = (int)m_TileFill.size();
+			for (int i = 0; i < tile_count; ++i)
+				m_TileFill[i] &= ~flag;
 		}
 	}
 
-	void Render::SetRenderStateFaceCullingBack(bool face_culling_back)
+	void Render::FillDepthBuffer(int offset, int count, bool stream)
 	{
-		m_FaceCullingBack = face_culling_back;
+		//定点格式远截面深度为0
+		switch (m_DepthFormat)
+		{
+		case _DEPTH_FORMAT_FLOAT:
+			FillMemory((float*)m_pDepthBuffer + offset, 1.0f / m_FarPlaneZInCamera, count, stream);
+			break;
+		case _DEPTH_FORMAT_UNORM16:
+			FillMemory((unsigned short*)m_pDepthBuffer + offset, (unsigned short)0, count, stream);
+			break;
+		default:
+			FillMemory((unsigned int*)m_pDepthBuffer + offset, 0u, count, stream);
+			break;
+		}
 	}
 
-	void Render::SetRenderStateForegroundAlphaBlendValue(float foreground_alpha_blend_value)
+	void Render::FillTile(const RECTANGLE* rect)
+	{
+		if (!m_TileFillPending)
+			return;
+
+		RECTANGLE buffer_rectangle =
+			{ 0, 0, m_RenderWidth, m_RenderHeight };
+		RECTANGLE r_rect = {};
+		if (!RectangleIntersect(rect, &buffer_rectangle, &r_rect))
+			return;
+
+		//逐块填充待填充的缓冲，每行都在块内连续
+		int tile_x1 = r_rect.x1 >> _TILE_SIZE_SHIFT;
+		int tile_y1 = r_rect.y1 >> _TILE_SIZE_SHIFT;
+		int tile_x2 = (r_rect.x2 - 1) >> _TILE_SIZE_SHIFT;
+		int tile_y2 = (r_rect.y2 - 1) >> _TILE_SIZE_SHIFT;
+		for (int tile_y = tile_y1; tile_y <= tile_y2; ++tile_y)
+		{
+			for (int tile_x = tile_x1; tile_x <= tile_x2; ++tile_x)
+			{
+				unsigned char* flag = &m_TileFill[tile_x + tile_y * m_TileColumn];
+				if (0 == *flag)
+					continue;
+
+				int x1 = tile_x << _TILE_SIZE_SHIFT;
+				int y1 = tile_y << _TILE_SIZE_SHIFT;
+				int x2 = std::min(x1 + (1 << _TILE_SIZE_SHIFT), m_BufferWidth);
+				int y2 = std::min(y1 + (1 << _TILE_SIZE_SHIFT), m_BufferHeight);
+
+				//分块布局中同一行块的块连续存储，按行块填充，宽度对齐到块尺寸，多填充的只是行间距内的像素
+				int row_add = 1;
+				int count = x2 - x1;
+				if (_BUFFER_LAYOUT_TILED == m_BufferLayout)
+				{
+					row_add = _BUFFER_BLOCK_SIZE;
+					count = (x2 - x1 + _BUFFER_BLOCK_SIZE - 1) / _BUFFER_BLOCK_SIZE * _BUFFER_BLOCK_SIZE * _BUFFER_BLOCK_SIZE;
+				}
+				for (int y = y1; y < y2; y += row_add)
+				{
+					int offset = _PIXEL_INDEX(x1, y);
+					if (0 != (*flag & _TILE_FILL_VIDEO))
+						FillMemory(m_pVideoBuffer + offset, m_TileFillColor, count, false);
+					if (0 != (*flag & _TILE_FILL_DEPTH))
+						FillDepthBuffer(offset, count, false);
+				}
+				*flag = 0;
+			}
+		}
+	}
+
+	void Render::FillTileAll()
+	{
+		RECTANGLE buffer_rectangle =
+			{ 0, 0, m_RenderWidth, m_RenderHeight };
+		FillTile(&buffer_rectangle);
+		m_TileFillPending = false;
+	}
+
+	void Render::FillTileByVertexInView(float x1, float y1, float x2, float y2)
+	{
+		//先限制在缓冲附近再取整，向外扩展1个像素包含取整误差和反走样线段的相邻像素
+		float w = (float)m_BufferWidth;
+		float h = (float)m_BufferHeight;
+		RECTANGLE rect =
+		{
+			(int)std::max(-1.0f, std::min(x1, w)) - 1,
+			(int)std::max(-1.0f, std::min(y1, h)) - 1,
+			(int)std::max(-1.0f, std::min(x2, w)) + 2,
+			(int)std::max(-1.0f, std::min(y2, h)) + 2,
+		};
+		FillTile(&rect);
+	}
+
+	void Render::SetLazyFillBuffer(bool lazy_fill_buffer)
+	{
+		//关闭时先把待填充的块填充完毕
+		if (!lazy_fill_buffer && m_TileFillPending)
+			FillTileAll();
+		m_LazyFillBuffer = lazy_fill_buffer;
+	}
+
+	void Render::SetDynamicResolution(
+		bool enable,
+		float target_frame_time,
+		float scale_min)
+	{
+		//关闭时下一帧恢复原始分辨率
+		m_DynamicResolution = enable && 0.0f < target_frame_time;
+		m_DynamicResolutionTargetTime = target_frame_time;
+		m_DynamicResolutionScaleMin = std::min(std::max(scale_min, 0.0f), 1.0f);
+		if (!m_DynamicResolution)
+			m_DynamicResolutionScale = 1.0f;
+	}
+
+	void Render::BeginFrame()
+	{
+		//上一帧没有读取结果时放弃，延迟的文字也一起放弃
+		if (m_FrameScaled)
+		{
+			std::swap(m_pVideoBuffer, m_pVideoBufferScaled);
+			std::swap(m_VideoBufferCapacity, m_VideoBufferScaledCapacity);
+			m_FrameScaled = false;
+		}
+		m_OverlayAsciiString.clear();
+		m_OverlayText.clear();
+
+		//用时与像素数量近似成正比，即与缩放的平方成正比，超时立即降低到目标缩放，
+		//有余量时每帧只向目标缩放移动一部分，避免在目标用时附近来回跳动
+		float scale = 1.0f;
+		if (m_DynamicResolution)
+		{
+			scale = m_DynamicResolutionScale;
+			if (0.0f < m_FrameTime)
+			{
+				if (m_FrameTime > m_DynamicResolutionTargetTime)
+					scale *= sqrtf(m_DynamicResolutionTargetTime / m_FrameTime);
+				else if (m_FrameTime < m_DynamicResolutionTargetTime * _DYNAMIC_RESOLUTION_RAISE_MARGIN)
+				{
+					float scale_target = std::min(scale * sqrtf(m_DynamicResolutionTargetTime * _DYNAMIC_RESOLUTION_RAISE_MARGIN / m_FrameTime), 1.0f);
+					scale += (scale_target - scale) * _DYNAMIC_RESOLUTION_RAISE_RATE;
+				}
+			}
+			scale = std::min(std::max(scale, m_DynamicResolutionScaleMin), 1.0f);
+		}
+		m_DynamicResolutionScale = scale;
+
+		//内部分辨率至少1个像素
+		m_RenderWidth = std::min(std::max((int)(m_BufferWidth * scale + 0.5f), 1), m_BufferWidth);
+		m_RenderHeight = std::min(std::max((int)(m_BufferHeight * scale + 0.5f), 1), m_BufferHeight);
+		if (m_RenderWidth != m_BufferWidth || m_RenderHeight != m_BufferHeight)
+		{
+			//内部分辨率显示缓冲与显示缓冲同样大小，分配失败时使用原始分辨率
+			void* video_buffer_scaled = m_pVideoBufferScaled;
+			BufferReserve(&video_buffer_scaled, &m_VideoBufferScaledCapacity, sizeof(int) * m_BufferStorageSize);
+			m_pVideoBufferScaled = (int*)video_buffer_scaled;
+			if (NULL != m_pVideoBufferScaled)
+			{
+				std::swap(m_pVideoBuffer, m_pVideoBufferScaled);
+				std::swap(m_VideoBufferCapacity, m_VideoBufferScaledCapacity);
+				m_FrameScaled = true;
+			}
+			else
+			{
+				m_RenderWidth = m_BufferWidth;
+				m_RenderHeight = m_BufferHeight;
+			}
+		}
+		UpdateTransformView();
+
+		m_FrameBegin = true;
+		m_FrameBeginTime = GetTimeMillisecond();
+	}
+
+	float Render::GetDynamicResolutionScale(
+		int* render_width,
+		int* render_height)
+	{
+		if (NULL != render_width)
+			*render_width = m_RenderWidth;
+
+		if (NULL != render_height)
+			*render_height = m_RenderHeight;
+
+		return m_DynamicResolutionScale;
+	}
+
+	void Render::UpdateBufferLayout()
+	{
+		m_PixelOffsetX.resize(m_BufferPitch);
+		m_PixelOffsetY.resize(m_BufferStorageSize / m_BufferPitch);
+		int x_count = (int)m_PixelOffsetX.size();
+		int y_count = (int)m_PixelOffsetY.size();
+
+		//线性布局：x + y * pitch
+		if (_BUFFER_LAYOUT_LINEAR == m_BufferLayout)
+		{
+			for (int x = 0; x < x_count; ++x)
+				m_PixelOffsetX[x] = x;
+			for (int y = 0; y < y_count; ++y)
+				m_PixelOffsetY[y] = y * m_BufferPitch;
+			return;
+		}
+
+		//分块布局：块下标 * 块像素数量 + 块内下标，同一行块相差一行块的像素数量
+		for (int x = 0; x < x_count; ++x)
+			m_PixelOffsetX[x] = x / _BUFFER_BLOCK_SIZE * _BUFFER_BLOCK_SIZE * _BUFFER_BLOCK_SIZE + x % _BUFFER_BLOCK_SIZE;
+		for (int y = 0; y < y_count; ++y)
+			m_PixelOffsetY[y] = y / _BUFFER_BLOCK_SIZE * _BUFFER_BLOCK_SIZE * m_BufferPitch + y % _BUFFER_BLOCK_SIZE * _BUFFER_BLOCK_SIZE;
+	}
+
+	bool Render::SetBufferLayout(int buffer_layout)
+	{
+		if (buffer_layout < _BUFFER_LAYOUT_LINEAR || buffer_layout > _BUFFER_LAYOUT_TILED)
+			return false;
+
+		//未初始时行间距未设置，由Init计算下标分量表
+		m_BufferLayout = buffer_layout;
+		if (NULL != m_pVideoBuffer)
+			UpdateBufferLayout();
+
+		return true;
+	}
+
+	int Render::GetBufferLayout()
+	{
+		return m_BufferLayout;
+	}
+
+	bool Render::SetDepthFormat(int depth_format)
+	{
+		if (depth_format < _DEPTH_FORMAT_FLOAT || depth_format > _DEPTH_FORMAT_FIXED32)
+			return false;
+
+		//容量不够时重新分配深度缓冲
+		if (NULL != m_pDepthBuffer)
+			BufferReserve(&m_pDepthBuffer, &m_DepthBufferCapacity, DepthFormatSize(depth_format) * m_BufferStorageSize);
+
+		//未初始时近远截面未设置，由Init计算转换参数
+		m_DepthFormat = depth_format;
+		if (NULL != m_pDepthBuffer)
+		{
+			UpdateDepthFormat();
+			FillBuffer(false, 0, true);
+		}
+
+		return true;
+	}
+
+	int Render::GetDepthFormat()
+	{
+		return m_DepthFormat;
+	}
+
+	void Render::SetRenderStateDepthTestEqual(bool depth_test_equal)
+	{
+		m_DepthTestEqual = depth_test_equal;
+	}
+
+	void Render::SetRenderStateFaceCullingBack(bool face_culling_back)
+	{
+		m_FaceCullingBack = face_culling_back;
+	}
+
+	void Render::SetRenderStateForegroundAlphaBlendValue(float foreground_alpha_blend_value)
 	{
 		m_ForegroundAlphaBlendValue = foreground_alpha_blend_value;
 		m_BackgroundAlphaBlendValue = 1.0f - m_ForegroundAlphaBlendValue;
@@ -3403,9 +3939,20 @@ namespace render {
 		const MESH_SEGMENT* mesh_segment,
 		int color)
 	{
-		//视锥体裁剪
-		if (!CoordinateCameraFrustumTest(mesh_segment->radius))
+		//场景提交队列开启时只添加绘制命令
+		if (m_SceneQueueEnable)
+		{
+			AddDrawCommand(mesh_segment, color);
 			return;
+		}
+
+		//视锥体裁剪、遮挡测试
+		if (!CoordinateCameraFrustumTest(mesh_segment->radius) ||
+			(m_EnableRenderStateOcclusionCulling && !OcclusionCullingTest(mesh_segment->radius)))
+			return;
+
+		//上次绘制的临时数据不再使用
+		ResetScratch();
 
 		//得到本地坐标系下面的顶点数量
 		int vertex_count = (int)mesh_segment->vertex.size();
@@ -3426,128 +3973,201 @@ namespace render {
 		//更新顶点数量，因为m_VertexInCamera有可能增加
 		vertex_count = (int)m_VertexInCamera.size();
 
-		//重置投影坐标系顶点变换表数量并进行投影变换，有部分顶点z值小于近截面就不进行变换，这些
-		//点在投影坐标系顶点表之中为零值向量，注意投影坐标系下面的z值为摄像机坐标系下面的z值倒数
+		//重置投影、视口坐标系顶点变换表数量，每个顶点进行一次投影变换、视口变换并计算区域码，
+		//z值小于近截面的顶点不进行变换，这些点已经不在更新线段索引表中，区域码置为全部区域以示舍去，
+		//注意投影坐标系下面的z值为摄像机坐标系下面的z值倒数
 		m_VertexInProjection.resize(vertex_count);
+		m_VertexInView.resize(vertex_count);
+		m_SegmentVertex.resize(vertex_count);
+		float fill_x1 = FLT_MAX, fill_y1 = FLT_MAX, fill_x2 = -FLT_MAX, fill_y2 = -FLT_MAX;
 		for (int i = 0; i < vertex_count; ++i)
 		{
+			SEGMENT_VERTEX* segment_vertex = &m_SegmentVertex[i];
+
 			//需要包含等的情况，因为1点等1点大的情况是保留到更新线段索引表中了
-			if (_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, m_VertexInCamera[i].z))
+			if (!_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, m_VertexInCamera[i].z))
 			{
-				m_VertexInProjection[i].x = m_VertexInCamera[i].x / m_VertexInCamera[i].z;
-				m_VertexInProjection[i].y = m_VertexInCamera[i].y / m_VertexInCamera[i].z;
-				m_VertexInProjection[i].z = 1.0f / m_VertexInCamera[i].z;
+				segment_vertex->outcode =
+					_SEGMENT_OUTCODE_N | _SEGMENT_OUTCODE_S | _SEGMENT_OUTCODE_W | _SEGMENT_OUTCODE_E;
+				continue;
 			}
-		}
 
-		//重置视口坐标系顶点变换表数量并进行视口变换
-		m_VertexInView.resize(vertex_count);
-		for (int i = 0; i < vertex_count; ++i)
+			m_VertexInProjection[i].x = m_VertexInCamera[i].x / m_VertexInCamera[i].z;
+			m_VertexInProjection[i].y = m_VertexInCamera[i].y / m_VertexInCamera[i].z;
+			m_VertexInProjection[i].z = 1.0f / m_VertexInCamera[i].z;
 			Vec3MulMat4(&m_VertexInProjection[i], &m_TransformView, &m_VertexInView[i]);
+			fill_x1 = std::min(fill_x1, m_VertexInView[i].x);
+			fill_y1 = std::min(fill_y1, m_VertexInView[i].y);
+			fill_x2 = std::max(fill_x2, m_VertexInView[i].x);
+			fill_y2 = std::max(fill_y2, m_VertexInView[i].y);
+
+			segment_vertex->x = (int)m_VertexInView[i].x;
+			segment_vertex->y = (int)m_VertexInView[i].y;
+			segment_vertex->z = m_VertexInView[i].z;
+			segment_vertex->outcode = 0;
+			if (segment_vertex->x < m_RectangleView.x1)
+				segment_vertex->outcode |= _SEGMENT_OUTCODE_W;
+			else if (segment_vertex->x >= m_RectangleView.x2)
+				segment_vertex->outcode |= _SEGMENT_OUTCODE_E;
+			if (segment_vertex->y < m_RectangleView.y1)
+				segment_vertex->outcode |= _SEGMENT_OUTCODE_N;
+			else if (segment_vertex->y >= m_RectangleView.y2)
+				segment_vertex->outcode |= _SEGMENT_OUTCODE_S;
+		}
 
-		//根据渲染状态得到渲染函数索引(ab dt)并得到渲染函数
-		int rasterization_func_index = 
-			((m_EnableRenderStateDepthTest ? 1 : 0) << 0) |
-			((m_EnableRenderStateAlphaBlend ? 1 : 0) << 1);
-		void (Render::* rasterization)(const vector3*, const vector3*, int color) = 
-			m_fDraw3DMeshSegmentRasterize[rasterization_func_index];
+		//延迟填充包围矩形内的块
+		if (m_TileFillPending && fill_x1 <= fill_x2)
+			FillTileByVertexInView(fill_x1, fill_y1, fill_x2, fill_y2);
 
-		//光栅化
-		int segment_count = (int)m_pSegmentAfterNearPlaneClip->size();
-		for (int i = 0; i < segment_count; i += 2)
+		//反走样单独处理
+		if (m_EnableRenderStateLineAntiAlias)
 		{
-			(this->*rasterization)(
-				&m_VertexInView[m_pSegmentAfterNearPlaneClip->at(i)],
-				&m_VertexInView[m_pSegmentAfterNearPlaneClip->at(i + 1)],
-				color);
+			(this->*m_fDraw3DMeshSegmentRasterizeBatchAntiAlias)(color);
+			return;
 		}
+
+		//根据缓冲布局和渲染状态得到渲染函数索引(ab dt)并批量光栅化
+		int rasterization_func_index = 
+			((m_EnableRenderStateDepthTest ? 1 : 0) << 0) |
+			((m_EnableRenderStateAlphaBlend ? 1 : 0) << 1);
+		(this->*m_fDraw3DMeshSegmentRasterizeBatch[m_BufferLayout][rasterization_func_index])(color);
 	}
 
 	//绘制三角模型
+//按有效顶点位表遍历顶点i并执行_vertex，整字有效时连续遍历以便编译器向量化，整字无效时跳过
+#define _VERTEX_VALID_TRAVERSE(_vertex) \
+	for (int word = 0; (word << 5) < vertex_count; ++word) \
+	{ \
+		unsigned int valid = m_VertexValidMask[word]; \
+		int i = word << 5; \
+		if (0xffffffff == valid) \
+		{ \
+			for (int i_end = i + 32; i < i_end; ++i) \
+				_vertex \
+		} \
+		else \
+		{ \
+			for (; 0 != valid; valid >>= 1, ++i) \
+			{ \
+				if (valid & 1) \
+					_vertex \
+			} \
+		} \
+	}
+
 	void Render::Draw3DMeshTriangle(
 		const MESH_TRIANGLE* mesh_triangle,
 		const vector3* eye)
 	{
-		//01：数据合法性检测
+		//场景提交队列开启时只添加绘制命令
+		if (m_SceneQueueEnable)
+		{
+			AddDrawCommand(mesh_triangle, eye);
+			return;
+		}
+
+		//按屏幕误差选择细节层次
+		mesh_triangle = Draw3DMeshTriangleSelectLod(mesh_triangle);
+
+		//仅写深度时不做光照运算和纹理采样
+		bool illumination_compute = m_EnableRenderStateIlluminationCompute && !m_EnableRenderStateDepthOnly;
+		bool texture_sample = m_EnableRenderStateTextureSample && !m_EnableRenderStateDepthOnly;
+
+		//01：数据合法性检测，光照、纹理至少激活一个，同时激活时纹理颜色按光照颜色调制
 		if ((mesh_triangle->vertex.size() != mesh_triangle->normal.size()) ||
-			(m_EnableRenderStateIlluminationCompute && m_EnableRenderStateTextureSample) ||
-			(!m_EnableRenderStateIlluminationCompute && !m_EnableRenderStateTextureSample))
+			(!m_EnableRenderStateDepthOnly && !m_EnableRenderStateIlluminationCompute && !m_EnableRenderStateTextureSample))
 			return;
 
+		//上次绘制的临时数据不再使用
+		ResetScratch();
+
 		//02：纹理采样检测
-		if (m_EnableRenderStateTextureSample)
+		if (texture_sample)
 		{
 			//复制纹理
 			if (mesh_triangle->vertex.size() == mesh_triangle->texture.size())
-				m_TextureCopy = mesh_triangle->texture;
+				m_TextureCopy.assign(mesh_triangle->texture.data(), mesh_triangle->texture.data() + mesh_triangle->texture.size());
 			else
 				return;
 		}
 
-		//03：视锥体测试，如果失败就不进行任何绘制
-		if (!CoordinateCameraFrustumTest(mesh_triangle->radius))
+		//03：视锥体测试、遮挡测试，如果失败就不进行任何绘制
+		if (!CoordinateCameraFrustumTest(mesh_triangle->radius) ||
+			(m_EnableRenderStateOcclusionCulling && !OcclusionCullingTest(mesh_triangle->radius)))
+			return;
+
+		//簇拣选，没有三角保留时不进行任何绘制
+		const std::vector<int>* triangle_origin = Draw3DMeshTriangleMeshletCulling(mesh_triangle);
+		if (triangle_origin->empty())
 			return;
 
 		//得到顶点数量
 		int vertex_count = (int)mesh_triangle->vertex.size();
 
-		//根据渲染状态(ts ic dt)得到填充函数
-		int fill_func_index =
-			((m_EnableRenderStateIlluminationCompute ? 1 : 0) << 0) |
-			((m_EnableRenderStateTextureSample ? 1 : 0) << 1);
-		int (Render:: * fill)(int, int, int, float*, float*, float*) =
-			m_fDraw3DMeshTriangleFill[fill_func_index];
-
-		//根据渲染状态(ts ic ab dt)得到渲染函数
+		//根据渲染状态(de ts ic ab dt)得到光栅化函数，每次绘制只选择一次，仅写深度时使用只插值1/z的光栅化函数
 		int rasterization_func_index =
 			((m_EnableRenderStateDepthTest ? 1 : 0) << 0) |
 			((m_EnableRenderStateAlphaBlend ? 1 : 0) << 1) |
-			((m_EnableRenderStateIlluminationCompute ? 1 : 0) << 2) |
-			((m_EnableRenderStateTextureSample ? 1 : 0) << 3);
-		void (Render:: * rasterization)(const TRIANGLE_RASTERIZE * triangle_rasterize) =
-			m_fDraw3DMeshTriangleRasterize[rasterization_func_index];
+			((illumination_compute ? 1 : 0) << 2) |
+			((texture_sample ? 1 : 0) << 3) |
+			((m_EnableRenderStateDepthTest && m_DepthTestEqual ? 1 : 0) << 4);
+		void (Render:: * rasterization)() =
+			m_EnableRenderStateDepthOnly ?
+			m_fDraw3DMeshTriangleRasterizeBatchDepthOnly :
+			m_fDraw3DMeshTriangleRasterizeBatch[rasterization_func_index];
 		
 		//04：重置世界坐标系顶点变换表数量，进行世界变换
 		m_VertexInWorld.resize(vertex_count);
 		for (int i = 0; i < vertex_count; ++i)
 			Vec3MulMat4(&mesh_triangle->vertex[i], &m_TransformWorld, &m_VertexInWorld[i]);
 
+		//顶点压缩：提前进行摄像机变换，按位置拣选三角之后压缩顶点，光照运算和之后的变换只处理被引用的顶点
+		const vector3* normal = vertex_count > 0 ? &mesh_triangle->normal[0] : NULL;
+		if (m_EnableRenderStateVertexCompaction)
+		{
+			m_VertexInCamera.resize(vertex_count);
+			for (int i = 0; i < vertex_count; ++i)
+				Vec3MulMat4(&m_VertexInWorld[i], &m_TransformCamera, &m_VertexInCamera[i]);
+
+			if (!Draw3DMeshTriangleCompaction(mesh_triangle, triangle_origin, illumination_compute, texture_sample))
+				return;
+
+			vertex_count = (int)m_VertexInCamera.size();
+			triangle_origin = &m_TriangleAfterCompaction;
+			normal = m_NormalCompaction.data();
+		}
+
 		//05：光照运算
-		if (m_EnableRenderStateIlluminationCompute)
-			IlluminationCompute(&mesh_triangle->normal, eye);
+		if (illumination_compute)
+			IlluminationCompute(normal, vertex_count, eye);
 
-		//06：重置摄像机坐标系顶点变换表数量，进行摄像机变换
-		m_VertexInCamera.resize(vertex_count);
-		for (int i = 0; i < vertex_count; ++i)
-			Vec3MulMat4(&m_VertexInWorld[i], &m_TransformCamera, &m_VertexInCamera[i]);
+		//06：重置摄像机坐标系顶点变换表数量，进行摄像机变换，顶点压缩时已经完成
+		if (!m_EnableRenderStateVertexCompaction)
+		{
+			m_VertexInCamera.resize(vertex_count);
+			for (int i = 0; i < vertex_count; ++i)
+				Vec3MulMat4(&m_VertexInWorld[i], &m_TransformCamera, &m_VertexInCamera[i]);
+		}
 
-		//07：根据渲染状态(ts ic)得到近截面裁剪函数
-		int near_plane_clip_func_index =
-			((m_EnableRenderStateIlluminationCompute ? 1 : 0) << 0) |
-			((m_EnableRenderStateTextureSample ? 1 : 0) << 1);
-		void (Render::* near_plane_clip)(float, const std::vector<int>*) =
-			m_fDraw3DMeshTriangleNearPlaneClip[near_plane_clip_func_index];
+		//07：根据渲染状态(ts ic)得到裁剪时需要插值的顶点属性
+		int clip_attribute_mask =
+			(illumination_compute ? _CLIP_ATTRIBUTE_COLOR : 0) |
+			(texture_sample ? _CLIP_ATTRIBUTE_TEXTURE : 0);
 
-		//08：近截面裁剪
-		(this->*near_plane_clip)(mesh_triangle->radius, &mesh_triangle->triangle);
+		//08：近截面、保护带裁剪
+		Draw3DMeshTriangleNearPlaneClip(mesh_triangle->radius, triangle_origin, clip_attribute_mask);
 
 		//09：更新顶点数量，因为m_VertexInCamera有可能增加
 		vertex_count = (int)m_VertexInCamera.size();
 
-		//10：重置投影坐标系顶点变换表数量，进行投影变换
+		//10：重置投影坐标系顶点变换表数量，只对有效顶点进行投影变换，无效顶点不写入
 		m_VertexInProjection.resize(vertex_count);
-		for (int i = 0; i < vertex_count; ++i)
+		_VERTEX_VALID_TRAVERSE(
 		{
-			//需要包含等的情况，因为1点等2点大和2点等1点大的情况是保留到更新线段索引表中了
-			if (_FLT_LESS_EQUAL_FLT(m_NearPlaneZInCamera, m_VertexInCamera[i].z))
-			{
-				m_VertexInProjection[i].x = m_VertexInCamera[i].x / m_VertexInCamera[i].z;
-				m_VertexInProjection[i].y = m_VertexInCamera[i].y / m_VertexInCamera[i].z;
-				m_VertexInProjection[i].z = m_VertexInCamera[i].z;
-			}
-			else
-				m_VertexInProjection[i].Set(0.0f, 0.0f, 0.0f);
-		}
+			m_VertexInProjection[i].x = m_VertexInCamera[i].x / m_VertexInCamera[i].z;
+			m_VertexInProjection[i].y = m_VertexInCamera[i].y / m_VertexInCamera[i].z;
+			m_VertexInProjection[i].z = m_VertexInCamera[i].z;
+		})
 
 		//11：表面拣选
 		if (m_EnableRenderStateFaceCulling)
@@ -3561,55 +4181,464 @@ namespace render {
 				m_TriangleAfterFaceCulling[i] = i;
 		}
 
-		//12:重置视口坐标系顶点变换表数量，进行视口变换
+		//12:重置视口坐标系顶点变换表数量，进行视口变换，并以定点数计算相对视口的区域码，
+		//保护带裁剪保证了视口坐标不会超出定点数范围
 		m_VertexInView.resize(vertex_count);
+		m_VertexViewOutcode.resize(vertex_count);
+		int view_x1 = m_RectangleView.x1 << _VIEW_SUBPIXEL_BITS;
+		int view_y1 = m_RectangleView.y1 << _VIEW_SUBPIXEL_BITS;
+		int view_x2 = m_RectangleView.x2 << _VIEW_SUBPIXEL_BITS;
+		int view_y2 = m_RectangleView.y2 << _VIEW_SUBPIXEL_BITS;
+		float fill_x1 = FLT_MAX, fill_y1 = FLT_MAX, fill_x2 = -FLT_MAX, fill_y2 = -FLT_MAX;
+		_VERTEX_VALID_TRAVERSE(
+		{
+			Vec3MulMat4(&m_VertexInProjection[i], &m_TransformView, &m_VertexInView[i]);
+			fill_x1 = std::min(fill_x1, m_VertexInView[i].x);
+			fill_y1 = std::min(fill_y1, m_VertexInView[i].y);
+			fill_x2 = std::max(fill_x2, m_VertexInView[i].x);
+			fill_y2 = std::max(fill_y2, m_VertexInView[i].y);
+
+			//区域码用于舍去，视口边界码表示不在视口内部留出1个定点单位的范围之内，
+			//用于接受，使光栅化时插值误差也不会越出视口
+			int x = (int)(m_VertexInView[i].x * (1 << _VIEW_SUBPIXEL_BITS));
+			int y = (int)(m_VertexInView[i].y * (1 << _VIEW_SUBPIXEL_BITS));
+			int outcode = 0;
+			if (x < view_x1)
+				outcode |= _SEGMENT_OUTCODE_W;
+			else if (x >= view_x2)
+				outcode |= _SEGMENT_OUTCODE_E;
+			if (y < view_y1)
+				outcode |= _SEGMENT_OUTCODE_N;
+			else if (y >= view_y2)
+				outcode |= _SEGMENT_OUTCODE_S;
+			if (x <= view_x1 || x >= view_x2 - 1 || y <= view_y1 || y >= view_y2 - 1)
+				outcode |= _VIEW_OUTCODE_BORDER;
+			m_VertexViewOutcode[i] = outcode;
+		})
+
+		//延迟填充包围矩形内的块
+		if (m_TileFillPending && fill_x1 <= fill_x2)
+			FillTileByVertexInView(fill_x1, fill_y1, fill_x2, fill_y2);
+
+		//13：光栅化
+		(this->*rasterization)();
+	}
+
+	int Render::GetRenderStateKey()
+	{
+		return
+			((m_EnableRenderStateDepthTest ? 1 : 0) << _RENDER_STATE_DEPTH_TEST) |
+			((m_EnableRenderStateAlphaBlend ? 1 : 0) << _RENDER_STATE_ALPHA_BLEND) |
+			((m_EnableRenderStateFaceCulling ? 1 : 0) << _RENDER_STATE_FACE_CULLING) |
+			((m_EnableRenderStateIlluminationCompute ? 1 : 0) << _RENDER_STATE_ILLUMINATION_COMPUTE) |
+			((m_EnableRenderStateTextureSample ? 1 : 0) << _RENDER_STATE_TEXTURE_SAMPLE) |
+			((m_EnableRenderStateDepthOnly ? 1 : 0) << _RENDER_STATE_DEPTH_ONLY) |
+			((m_EnableRenderStateOcclusionCulling ? 1 : 0) << _RENDER_STATE_OCCLUSION_CULLING) |
+			((m_EnableRenderStateLineAntiAlias ? 1 : 0) << _RENDER_STATE_LINE_ANTI_ALIAS) |
+			((m_EnableRenderStateVertexCompaction ? 1 : 0) << _RENDER_STATE_VERTEX_COMPACTION) |
+			(m_DepthTestEqual ? _RENDER_STATE_KEY_DEPTH_TEST_EQUAL : 0) |
+			(m_FaceCullingBack ? _RENDER_STATE_KEY_FACE_CULLING_BACK : 0);
+	}
+
+	void Render::SetRenderStateKey(int render_state_key)
+	{
+		m_EnableRenderStateDepthTest = 0 != (render_state_key & (1 << _RENDER_STATE_DEPTH_TEST));
+		m_EnableRenderStateAlphaBlend = 0 != (render_state_key & (1 << _RENDER_STATE_ALPHA_BLEND));
+		m_EnableRenderStateFaceCulling = 0 != (render_state_key & (1 << _RENDER_STATE_FACE_CULLING));
+		m_EnableRenderStateIlluminationCompute = 0 != (render_state_key & (1 << _RENDER_STATE_ILLUMINATION_COMPUTE));
+		m_EnableRenderStateTextureSample = 0 != (render_state_key & (1 << _RENDER_STATE_TEXTURE_SAMPLE));
+		m_EnableRenderStateDepthOnly = 0 != (render_state_key & (1 << _RENDER_STATE_DEPTH_ONLY));
+		m_EnableRenderStateOcclusionCulling = 0 != (render_state_key & (1 << _RENDER_STATE_OCCLUSION_CULLING));
+		m_EnableRenderStateLineAntiAlias = 0 != (render_state_key & (1 << _RENDER_STATE_LINE_ANTI_ALIAS));
+		m_EnableRenderStateVertexCompaction = 0 != (render_state_key & (1 << _RENDER_STATE_VERTEX_COMPACTION));
+		m_DepthTestEqual = 0 != (render_state_key & _RENDER_STATE_KEY_DEPTH_TEST_EQUAL);
+		m_FaceCullingBack = 0 != (render_state_key & _RENDER_STATE_KEY_FACE_CULLING_BACK);
+	}
+
+	Render::DRAW_COMMAND* Render::RecordDrawCommand(float sphere_radius)
+	{
+		//视锥体测试、遮挡测试，失败就不记录
+		if (!CoordinateCameraFrustumTest(sphere_radius) ||
+			(m_EnableRenderStateOcclusionCulling && !OcclusionCullingTest(sphere_radius)))
+			return NULL;
+
+		DRAW_COMMAND draw_command;
+		draw_command.mesh_triangle = NULL;
+		draw_command.mesh_segment = NULL;
+		draw_command.color = 0;
+		draw_command.eye_enable = false;
+
+		//记录世界变换和渲染状态
+		draw_command.transform_world = m_TransformWorld;
+		draw_command.render_state_key = GetRenderStateKey();
+		draw_command.foreground_alpha_blend_value = m_ForegroundAlphaBlendValue;
+		draw_command.material = m_Material;
+		draw_command.texture = m_pTexture;
+
+		//批次
+		if (m_EnableRenderStateDepthOnly)
+			draw_command.pass = 0;
+		else if (m_EnableRenderStateAlphaBlend)
+			draw_command.pass = 2;
+		else
+			draw_command.pass = 1;
+
+		//摄像机坐标系下包围球球心z值及其所在深度分段
+		draw_command.depth = ComputerCenterInCamera().z;
+		draw_command.depth_bucket = (int)(
+			(draw_command.depth - m_NearPlaneZInCamera) /
+			(m_FarPlaneZInCamera - m_NearPlaneZInCamera) *
+			_DRAW_COMMAND_DEPTH_BUCKET_COUNT);
+		if (draw_command.depth_bucket < 0)
+			draw_command.depth_bucket = 0;
+		if (draw_command.depth_bucket > _DRAW_COMMAND_DEPTH_BUCKET_COUNT - 1)
+			draw_command.depth_bucket = _DRAW_COMMAND_DEPTH_BUCKET_COUNT - 1;
+
+		draw_command.order = (int)m_DrawCommand.size();
+
+		m_DrawCommand.push_back(draw_command);
+		return &m_DrawCommand.back();
+	}
+
+	bool Render::DrawCommandLess(const DRAW_COMMAND* dc1, const DRAW_COMMAND* dc2)
+	{
+		//批次
+		if (dc1->pass != dc2->pass)
+			return dc1->pass < dc2->pass;
+
+		//阿尔法混合：由远到近
+		if (2 == dc1->pass)
+		{
+			if (dc1->depth != dc2->depth)
+				return dc1->depth > dc2->depth;
+			return dc1->order < dc2->order;
+		}
+
+		//仅写深度、不透明：深度分段由近到远，分段内按渲染状态、纹理分组，最后由近到远
+		if (dc1->depth_bucket != dc2->depth_bucket)
+			return dc1->depth_bucket < dc2->depth_bucket;
+		if (dc1->render_state_key != dc2->render_state_key)
+			return dc1->render_state_key < dc2->render_state_key;
+		if (dc1->texture != dc2->texture)
+			return dc1->texture < dc2->texture;
+		if (dc1->depth != dc2->depth)
+			return dc1->depth < dc2->depth;
+		return dc1->order < dc2->order;
+	}
+
+	void Render::ClearDrawCommand()
+	{
+		m_DrawCommand.clear();
+		m_DrawCommandSorted.clear();
+	}
+
+	void Render::AddDrawCommand(
+		const MESH_TRIANGLE* mesh_triangle,
+		const vector3* eye)
+	{
+		DRAW_COMMAND* draw_command = RecordDrawCommand(mesh_triangle->radius);
+		if (NULL == draw_command)
+			return;
+
+		draw_command->mesh_triangle = mesh_triangle;
+		if (NULL != eye)
+		{
+			draw_command->eye_enable = true;
+			draw_command->eye = *eye;
+		}
+	}
+
+	void Render::AddDrawCommand(
+		const MESH_SEGMENT* mesh_segment,
+		int color)
+	{
+		DRAW_COMMAND* draw_command = RecordDrawCommand(mesh_segment->radius);
+		if (NULL == draw_command)
+			return;
+
+		draw_command->mesh_segment = mesh_segment;
+		draw_command->color = color;
+	}
+
+	void Render::ExecuteDrawCommand()
+	{
+		int draw_command_count = (int)m_DrawCommand.size();
+		if (0 == draw_command_count)
+			return;
+
+		//排序
+		m_DrawCommandSorted.resize(draw_command_count);
+		for (int i = 0; i < draw_command_count; ++i)
+			m_DrawCommandSorted[i] = &m_DrawCommand[i];
+		std::sort(m_DrawCommandSorted.begin(), m_DrawCommandSorted.end(), DrawCommandLess);
+
+		//保存执行前的渲染状态
+		matrix4 transform_world = m_TransformWorld;
+		int render_state_key = GetRenderStateKey();
+		float foreground_alpha_blend_value = m_ForegroundAlphaBlendValue;
+		MATERIAL material = m_Material;
+		const TEXTURE* texture = m_pTexture;
+
+		//执行，只在渲染状态、阿尔法混合参数、材质、纹理变化时才进行设置
+		const DRAW_COMMAND* last = NULL;
+		for (int i = 0; i < draw_command_count; ++i)
+		{
+			const DRAW_COMMAND* dc = m_DrawCommandSorted[i];
+
+			if (NULL == last || last->render_state_key != dc->render_state_key)
+				SetRenderStateKey(dc->render_state_key);
+			if (NULL == last || last->foreground_alpha_blend_value != dc->foreground_alpha_blend_value)
+				SetRenderStateForegroundAlphaBlendValue(dc->foreground_alpha_blend_value);
+			if (NULL == last || 0 != memcmp(&last->material, &dc->material, sizeof(MATERIAL)))
+				m_Material = dc->material;
+			if (NULL == last || last->texture != dc->texture)
+				m_pTexture = dc->texture;
+
+			m_TransformWorld = dc->transform_world;
+
+			if (NULL != dc->mesh_triangle)
+				Draw3DMeshTriangle(dc->mesh_triangle, dc->eye_enable ? &dc->eye : NULL);
+			else
+				Draw3DMeshSegment(dc->mesh_segment, dc->color);
+
+			last = dc;
+		}
+
+		//恢复执行前的渲染状态
+		m_TransformWorld = transform_world;
+		SetRenderStateKey(render_state_key);
+		SetRenderStateForegroundAlphaBlendValue(foreground_alpha_blend_value);
+		m_Material = material;
+		m_pTexture = texture;
+	}
+
+	void Render::BeginScene()
+	{
+		ClearDrawCommand();
+		m_SceneQueueEnable = true;
+	}
+
+	void Render::EndScene()
+	{
+		//先关闭队列，执行时才会真正绘制
+		m_SceneQueueEnable = false;
+		ExecuteDrawCommand();
+		ClearDrawCommand();
+	}
+
+	void Render::ClearOcclusionBuffer()
+	{
+		std::fill(m_OcclusionBuffer.begin(), m_OcclusionBuffer.end(), 0.0f);
+	}
+
+	void Render::DrawOccluderMeshTriangle(const MESH_TRIANGLE* mesh_triangle)
+	{
+		//视锥体测试
+		if (!CoordinateCameraFrustumTest(mesh_triangle->radius))
+			return;
+
+		//视口坐标系到遮挡深度缓冲坐标系的缩放
+		float scale_x = (float)_OCCLUSION_BUFFER_WIDTH / m_RenderWidth;
+		float scale_y = (float)_OCCLUSION_BUFFER_HEIGHT / m_RenderHeight;
+
+		//变换到遮挡深度缓冲坐标系，近截面之前的顶点z置0标记
+		int vertex_count = (int)mesh_triangle->vertex.size();
+		m_OccluderVertex.resize(vertex_count);
 		for (int i = 0; i < vertex_count; ++i)
 		{
-			//非零值顶点才进行变换，零值的是已经在近截面裁剪中被舍去的顶点
-			if (!m_VertexInProjection[i].IsZero())
-				Vec3MulMat4(&m_VertexInProjection[i], &m_TransformView, &m_VertexInView[i]);
+			vector3 vertex_in_world;
+			vector3 vertex_in_camera;
+			Vec3MulMat4(&mesh_triangle->vertex[i], &m_TransformWorld, &vertex_in_world);
+			Vec3MulMat4(&vertex_in_world, &m_TransformCamera, &vertex_in_camera);
+
+			if (_FLT_LESS_FLT(vertex_in_camera.z, m_NearPlaneZInCamera))
+			{
+				m_OccluderVertex[i].Set(0.0f, 0.0f, 0.0f);
+				continue;
+			}
+
+			vector3 vertex_in_projection(
+				vertex_in_camera.x / vertex_in_camera.z,
+				vertex_in_camera.y / vertex_in_camera.z,
+				vertex_in_camera.z);
+			vector3 vertex_in_view;
+			Vec3MulMat4(&vertex_in_projection, &m_TransformView, &vertex_in_view);
+
+			m_OccluderVertex[i].Set(
+				vertex_in_view.x * scale_x,
+				vertex_in_view.y * scale_y,
+				1.0f / vertex_in_camera.z);
 		}
 
-		//13：光栅化
-		float vertex_data0[8] = {};
-		float vertex_data1[8] = {};
-		float vertex_data2[8] = {};
-		float vertex_data3[8] = {};
-		TRIANGLE_RASTERIZE triangle_flatbottom = {NULL, NULL, NULL, NULL};
-		TRIANGLE_RASTERIZE triangle_flattop = {NULL, NULL, NULL, NULL};
-		int triangle_visible_count = (int)m_TriangleAfterFaceCulling.size();
-		for (int i = 0; i < triangle_visible_count; ++i)
+		//光栅化，遮挡体只能少画不能多画，所以跨越近截面的三角直接舍去
+		int triangle_count = (int)mesh_triangle->triangle.size();
+		for (int i = 0; i < triangle_count; i += 3)
 		{
-			//得到三角形三点
-			int j = m_TriangleAfterFaceCulling[i] * 3;
+			const vector3* v0 = &m_OccluderVertex[mesh_triangle->triangle[i]];
+			const vector3* v1 = &m_OccluderVertex[mesh_triangle->triangle[i + 1]];
+			const vector3* v2 = &m_OccluderVertex[mesh_triangle->triangle[i + 2]];
+			if (0.0f == v0->z || 0.0f == v1->z || 0.0f == v2->z)
+				continue;
 
-			//根据渲染状态填充数据
-			int fill_count = (this->*fill)(
-				m_pTriangleAfterNearPlaneClip->at(j),
-				m_pTriangleAfterNearPlaneClip->at(j + 1),
-				m_pTriangleAfterNearPlaneClip->at(j + 2),
-				vertex_data0,
-				vertex_data1,
-				vertex_data2);
+			OccluderTriangleRasterize(v0, v1, v2);
+		}
+	}
 
-			//三角形平底平顶分割
-			int classify_result = TriangleClassify(
-				fill_count,
-				vertex_data0,
-				vertex_data1,
-				vertex_data2,
-				vertex_data3,
-				&triangle_flatbottom,
-				&triangle_flattop);
+//遮挡体光栅化：像素中心到像素边界的距离，比0.5略大
+#define _OCCLUSION_PIXEL_EXTENT (0.5f + 1.0f / 64.0f)
 
-			//平底三角形光栅化
-			if (classify_result & 0x01)
-				(this->*rasterization)(&triangle_flatbottom);
+	void Render::OccluderTriangleRasterize(
+		const vector3* v0,
+		const vector3* v1,
+		const vector3* v2)
+	{
+		//有向面积，统一为正方向
+		float area = (v1->x - v0->x) * (v2->y - v0->y) - (v1->y - v0->y) * (v2->x - v0->x);
+		if (0.0f == area)
+			return;
+		if (area < 0.0f)
+		{
+			const vector3* temp = v1;
+			v1 = v2;
+			v2 = temp;
+			area = -area;
+		}
 
-			//平顶三角形光栅化
-			if (classify_result & 0x02)
-				(this->*rasterization)(&triangle_flattop);
+		//包围矩形，像素中心为(x + 0.5, y + 0.5)
+		int x_min = (int)floor(std::min(v0->x, std::min(v1->x, v2->x)));
+		int x_max = (int)ceil(std::max(v0->x, std::max(v1->x, v2->x)));
+		int y_min = (int)floor(std::min(v0->y, std::min(v1->y, v2->y)));
+		int y_max = (int)ceil(std::max(v0->y, std::max(v1->y, v2->y)));
+		x_min = std::max(x_min, 0);
+		y_min = std::max(y_min, 0);
+		x_max = std::min(x_max, _OCCLUSION_BUFFER_WIDTH - 1);
+		y_max = std::min(y_max, _OCCLUSION_BUFFER_HEIGHT - 1);
+		if (x_min > x_max || y_min > y_max)
+			return;
+
+		//边函数e(x, y) = a * x + b * y + c，三条边都非负为内部
+		float a0 = v1->y - v2->y, b0 = v2->x - v1->x, c0 = v1->x * v2->y - v1->y * v2->x;
+		float a1 = v2->y - v0->y, b1 = v0->x - v2->x, c1 = v2->x * v0->y - v2->y * v0->x;
+		float a2 = v0->y - v1->y, b2 = v1->x - v0->x, c2 = v0->x * v1->y - v0->y * v1->x;
+
+		//1/z在屏幕空间是线性的，z(x, y) = za * x + zb * y + zc
+		float one_div_area = 1.0f / area;
+		float za = (a0 * v0->z + a1 * v1->z + a2 * v2->z) * one_div_area;
+		float zb = (b0 * v0->z + b1 * v1->z + b2 * v2->z) * one_div_area;
+		float zc = (c0 * v0->z + c1 * v1->z + c2 * v2->z) * one_div_area;
+
+		//遮挡体只能少画不能多画：线性函数在像素内的最小值为中心值减去0.5 * (|a| + |b|)，
+		//边函数按此内缩后以中心采样，只写入整个像素都在三角内部的像素，深度同样取像素内最远(1/z最小)的值，
+		//内缩时像素按_OCCLUSION_PIXEL_EXTENT略为扩大，吸收浮点误差
+		c0 -= _OCCLUSION_PIXEL_EXTENT * (fabs(a0) + fabs(b0));
+		c1 -= _OCCLUSION_PIXEL_EXTENT * (fabs(a1) + fabs(b1));
+		c2 -= _OCCLUSION_PIXEL_EXTENT * (fabs(a2) + fabs(b2));
+		zc -= _OCCLUSION_PIXEL_EXTENT * (fabs(za) + fabs(zb));
+
+#ifdef _RENDER_SSE2
+		//每次处理4个像素，x起点向下对齐到4，缓冲宽度是4的倍数所以不会越界
+		x_min &= ~3;
+		__m128 offset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		__m128 zero = _mm_setzero_ps();
+		__m128 step0 = _mm_set1_ps(a0 * 4.0f);
+		__m128 step1 = _mm_set1_ps(a1 * 4.0f);
+		__m128 step2 = _mm_set1_ps(a2 * 4.0f);
+		__m128 stepz = _mm_set1_ps(za * 4.0f);
+		for (int y = y_min; y <= y_max; ++y)
+		{
+			float py = y + 0.5f;
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x_min), offset);
+			__m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a0), px), _mm_set1_ps(b0 * py + c0));
+			__m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a1), px), _mm_set1_ps(b1 * py + c1));
+			__m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a2), px), _mm_set1_ps(b2 * py + c2));
+			__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), px), _mm_set1_ps(zb * py + zc));
+			float* row = &m_OcclusionBuffer[y * _OCCLUSION_BUFFER_WIDTH];
+			for (int x = x_min; x <= x_max; x += 4)
+			{
+				__m128 inside = _mm_and_ps(
+					_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+					_mm_cmpge_ps(e2, zero));
+				if (_mm_movemask_ps(inside))
+				{
+					__m128 depth = _mm_loadu_ps(row + x);
+					__m128 nearer = _mm_max_ps(depth, z);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, depth)));
+				}
+				e0 = _mm_add_ps(e0, step0);
+				e1 = _mm_add_ps(e1, step1);
+				e2 = _mm_add_ps(e2, step2);
+				z = _mm_add_ps(z, stepz);
+			}
 		}
+#else
+		for (int y = y_min; y <= y_max; ++y)
+		{
+			float py = y + 0.5f;
+			float* row = &m_OcclusionBuffer[y * _OCCLUSION_BUFFER_WIDTH];
+			for (int x = x_min; x <= x_max; ++x)
+			{
+				float px = x + 0.5f;
+				if (a0 * px + b0 * py + c0 >= 0.0f &&
+					a1 * px + b1 * py + c1 >= 0.0f &&
+					a2 * px + b2 * py + c2 >= 0.0f)
+				{
+					float z = za * px + zb * py + zc;
+					if (row[x] < z)
+						row[x] = z;
+				}
+			}
+		}
+#endif
 	}
 
-}
\ No newline at end of file
+	bool Render::OcclusionCullingTest(float sphere_radius)
+	{
+		vector3 center_in_camera = ComputerCenterInCamera();
+
+		//包围球跨越近截面，无法判断
+		float z_near = center_in_camera.z - sphere_radius;
+		float z_far = center_in_camera.z + sphere_radius;
+		if (_FLT_LESS_FLT(z_near, m_NearPlaneZInCamera))
+			return true;
+
+		//包围球外接立方体投影矩形，x/z在z的两端取极值
+		float x0 = center_in_camera.x - sphere_radius;
+		float x1 = center_in_camera.x + sphere_radius;
+		float y0 = center_in_camera.y - sphere_radius;
+		float y1 = center_in_camera.y + sphere_radius;
+		vector3 corner_in_projection[2] =
+		{
+			vector3(std::min(x0 / z_near, x0 / z_far), std::min(y0 / z_near, y0 / z_far), z_near),
+			vector3(std::max(x1 / z_near, x1 / z_far), std::max(y1 / z_near, y1 / z_far), z_near),
+		};
+		vector3 corner_in_view[2];
+		Vec3MulMat4(&corner_in_projection[0], &m_TransformView, &corner_in_view[0]);
+		Vec3MulMat4(&corner_in_projection[1], &m_TransformView, &corner_in_view[1]);
+
+		//转换到遮挡深度缓冲坐标系，取覆盖到的全部像素
+		float scale_x = (float)_OCCLUSION_BUFFER_WIDTH / m_RenderWidth;
+		float scale_y = (float)_OCCLUSION_BUFFER_HEIGHT / m_RenderHeight;
+		int x_min = (int)floor(std::min(corner_in_view[0].x, corner_in_view[1].x) * scale_x);
+		int x_max = (int)floor(std::max(corner_in_view[0].x, corner_in_view[1].x) * scale_x);
+		int y_min = (int)floor(std::min(corner_in_view[0].y, corner_in_view[1].y) * scale_y);
+		int y_max = (int)floor(std::max(corner_in_view[0].y, corner_in_view[1].y) * scale_y);
+		x_min = std::max(x_min, 0);
+		y_min = std::max(y_min, 0);
+		x_max = std::min(x_max, _OCCLUSION_BUFFER_WIDTH - 1);
+		y_max = std::min(y_max, _OCCLUSION_BUFFER_HEIGHT - 1);
+
+		//有任何一个像素的遮挡深度比包围球最近点远就可能可见
+		float one_div_z_near = 1.0f / z_near;
+		for (int y = y_min; y <= y_max; ++y)
+		{
+			const float* row = &m_OcclusionBuffer[y * _OCCLUSION_BUFFER_WIDTH];
+			for (int x = x_min; x <= x_max; ++x)
+			{
+				if (row[x] < one_div_z_near)
+					return true;
+			}
+		}
+
+		return false;
+	}
+}
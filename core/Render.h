@@ -14,6 +14,7 @@
 #include "Material.h"
 #include "MeshSegment.h"
 #include "MeshTriangle.h"
+#include "ScratchArena.h"
 
 #include <vector>
 
@@ -38,6 +39,35 @@ namespace render {
 #define _RENDER_STATE_ILLUMINATION_COMPUTE 3
 //渲染状态：纹理采样ts索引
 #define _RENDER_STATE_TEXTURE_SAMPLE 4
+//渲染状态：仅写深度do索引（深度预渲染，只对三角模型有效）
+#define _RENDER_STATE_DEPTH_ONLY 5
+//渲染状态：遮挡剔除oc索引
+#define _RENDER_STATE_OCCLUSION_CULLING 6
+//渲染状态：线段反走样la索引（按覆盖率混合，只对线段模型有效）
+#define _RENDER_STATE_LINE_ANTI_ALIAS 7
+//渲染状态：顶点压缩vc索引（先按位置拣选三角，光照运算和其余变换只处理被引用的顶点，只对三角模型有效）
+#define _RENDER_STATE_VERTEX_COMPACTION 8
+
+//深度格式：深度缓冲存储1/z，越近越大
+//浮点数（默认），1/z即反向深度，不需要额外映射
+#define _DEPTH_FORMAT_FLOAT 0
+//16位定点数，[1/远截面, 1/近截面]线性映射到[0, 0xffff]，用于低内存的缩略图
+#define _DEPTH_FORMAT_UNORM16 1
+//24位定点数，以32位存储
+#define _DEPTH_FORMAT_FIXED24 2
+//32位定点数
+#define _DEPTH_FORMAT_FIXED32 3
+
+//缓冲布局：像素在显示缓冲和深度缓冲中的排列方式
+//线性（默认），逐行连续
+#define _BUFFER_LAYOUT_LINEAR 0
+//分块，8x8像素块内连续、块按行排列，相邻行的像素集中在同一块内，小三角形访问的缓存行更少，
+//GetVideoBuffer时转换为线性排列
+#define _BUFFER_LAYOUT_TILED 1
+
+//遮挡深度缓冲尺寸
+#define _OCCLUSION_BUFFER_WIDTH 256
+#define _OCCLUSION_BUFFER_HEIGHT 128
 
 	//计算摄像机变换矩阵
 	matrix4* ComputeTransformCamera(
@@ -58,20 +88,134 @@ namespace render {
 	float ComputeLocalShpereRadius(
 		const std::vector<vector3>* vertex);
 
+	//计算世界坐标系包围球：球心为本地坐标系原点的世界坐标，半径按世界变换最大轴缩放
+	void ComputeWorldShpere(
+		const matrix4* transform_world,
+		float local_radius,
+		vector3* center,
+		float* radius);
+
+	//三角光栅化统计：按光栅化方式分类的三角数量，只统计通过视口区域码测试的三角
+	struct RASTERIZE_STATISTICS
+	{
+		//包围盒内没有像素采样点而舍去
+		int triangle_reject;
+
+		//包围盒内不超过4个像素采样点，逐点采样
+		int triangle_point_sample;
+
+		//平底平顶分割后按扫描线光栅化
+		int triangle_span;
+	};
+
 	class Render
 	{
 		//----------通用----------
 
-		//缓冲尺寸
+		//缓冲尺寸，行间距为相邻两行起点相差的像素数量
 		int m_BufferWidth;
 		int m_BufferHeight;
 		int m_BufferSize;
+		int m_BufferPitch;
 
-		//显示缓冲
+		//缓冲存储像素数量，行数按分块布局的块尺寸对齐
+		int m_BufferStorageSize;
+
+		//缓冲布局，像素(x, y)的缓冲下标为m_PixelOffsetX[x] + m_PixelOffsetY[y]，两种布局都可以按xy分解
+		int m_BufferLayout;
+		std::vector<int> m_PixelOffsetX;
+		std::vector<int> m_PixelOffsetY;
+
+		//按缓冲布局计算像素下标分量表
+		void UpdateBufferLayout();
+
+		//分块布局转换后的线性显示缓冲，行间距与显示缓冲相同
+		int* m_pVideoBufferLinear;
+		size_t m_VideoBufferLinearCapacity;
+
+		//显示缓冲，每行起点64字节对齐，容量为已分配字节数
 		int* m_pVideoBuffer;
+		size_t m_VideoBufferCapacity;
+
+		//深度缓冲，存储类型由深度格式决定，行间距与显示缓冲相同
+		void* m_pDepthBuffer;
+		size_t m_DepthBufferCapacity;
+
+		//深度格式，定点格式的1/z转换参数：(1/z - bias) * scale，按双精度计算
+		int m_DepthFormat;
+		double m_DepthScale;
+		double m_DepthBias;
+
+		//深度缓冲填充[offset, offset + count)，stream为真时使用流式写入
+		void FillDepthBuffer(int offset, int count, bool stream);
+
+		//延迟填充：开启时FillBuffer只标记块待填充，块在第一次被绘制时才填充
+		bool m_LazyFillBuffer;
+		int m_TileColumn;
+		int m_TileRow;
+		std::vector<unsigned char> m_TileFill;
+		bool m_TileFillPending;
+		int m_TileFillColor;
+
+		//填充与矩形相交的待填充块
+		void FillTile(const RECTANGLE* rect);
+		void FillTileAll();
+
+		//填充视口坐标系包围矩形相交的待填充块
+		void FillTileByVertexInView(float x1, float y1, float x2, float y2);
+
+		//动态分辨率：按上一帧用时与目标用时调整内部分辨率缩放，m_DynamicResolutionTargetTime为毫秒
+		bool m_DynamicResolution;
+		float m_DynamicResolutionTargetTime;
+		float m_DynamicResolutionScaleMin;
+		float m_DynamicResolutionScale;
+
+		//本帧内部分辨率，3D绘制和2D裁剪都在左上角这个区域内，不缩放时等于缓冲尺寸
+		int m_RenderWidth;
+		int m_RenderHeight;
+
+		//本帧按内部分辨率绘制时m_pVideoBuffer与m_pVideoBufferScaled交换，
+		//内部分辨率显示缓冲与显示缓冲布局相同，GetVideoBuffer时交换回来并放大
+		bool m_FrameScaled;
+		int* m_pVideoBufferScaled;
+		size_t m_VideoBufferScaledCapacity;
+
+		//帧用时，从BeginFrame到GetVideoBuffer，毫秒，小于0为还没有测量
+		bool m_FrameBegin;
+		double m_FrameBeginTime;
+		float m_FrameTime;
+
+		//放大时按目标x预先计算的源像素下标、右侧像素权重，以及两行水平插值结果，每个通道16位
+		std::vector<int> m_UpscaleX;
+		std::vector<int> m_UpscaleWeightX;
+		std::vector<unsigned short> m_UpscaleRow[2];
+
+		//本帧延迟到放大之后按原始分辨率绘制的文字，字符串依次存放在m_OverlayText中
+		struct OVERLAY_ASCII_STRING
+		{
+			const ASCII_FONT* ascii_font;
+			int x_max_count;
+			int y_max_count;
+			int x;
+			int y;
+			int text_offset;
+		};
+		std::vector<OVERLAY_ASCII_STRING> m_OverlayAsciiString;
+		std::vector<char> m_OverlayText;
+
+		//用户设置的视口变换矩阵，m_TransformView为其按内部分辨率缩放的结果
+		matrix4 m_TransformViewNative;
+
+		//按内部分辨率缩放视口变换矩阵并记录视口矩形，缩放为1时与用户设置的矩阵相同
+		void UpdateTransformView();
 
-		//深度缓冲
-		float* m_pDepthBuffer;
+		//把内部分辨率显示缓冲双线性放大到显示缓冲
+		void UpscaleVideoBuffer();
+
+		//按深度格式计算转换参数、设置深度测试相关光栅化函数
+		void UpdateDepthFormat();
+		template <typename DEPTH>
+		void SetDepthFormatFunction();
 
 		//变换矩阵
 		matrix4 m_TransformWorld;
@@ -86,14 +230,24 @@ namespace render {
 		float m_NearPlaneZInCamera;
 		float m_FarPlaneZInCamera;
 
+		//管线临时内存，每次绘制开始时重置，变换顶点表等临时数组都从中分配，稳定之后不再访问堆
+		SCRATCH_ARENA* m_pScratchArena;
+
+		//重置管线临时内存，所有临时数组放弃数据
+		void ResetScratch();
+
 		//变换顶点表
-		std::vector<vector3> m_VertexInWorld;
-		std::vector<vector3> m_VertexInCamera;
-		std::vector<vector3> m_VertexInProjection;
-		std::vector<vector3> m_VertexInView;
+		SCRATCH_ARRAY<vector3> m_VertexInWorld;
+		SCRATCH_ARRAY<vector3> m_VertexInCamera;
+		SCRATCH_ARRAY<vector3> m_VertexInProjection;
+		SCRATCH_ARRAY<vector3> m_VertexInView;
 
 		//渲染状态：深度缓冲
 		bool m_EnableRenderStateDepthTest;
+		bool m_DepthTestEqual;
+
+		//渲染状态：仅写深度
+		bool m_EnableRenderStateDepthOnly;
 
 		//渲染状态：阿尔法混合
 		bool m_EnableRenderStateAlphaBlend;
@@ -126,6 +280,9 @@ namespace render {
 
 		//视锥体测试
 		bool CoordinateCameraFrustumTest(float sphere_radius);
+		bool CoordinateCameraFrustumTest(
+			const vector3* center_in_camera,
+			float sphere_radius);
 		
 		//----------线段网格相关----------
 
@@ -141,48 +298,136 @@ namespace render {
 
 		//线段光栅化
 		//1/z和x、y都是线性关系，可以根据x、y的变化量哪个非0就用哪个来计算
+		//深度测试相关的光栅化函数以深度格式DEPTH为模板参数，都以缓冲布局LAYOUT为模板参数，见Render.cpp
+		template <int LAYOUT>
 		void Draw3DMeshSegmentRasterize_ab0_dt0(const vector3* v0, const vector3* v1, int color);
+		template <typename DEPTH, int LAYOUT>
 		void Draw3DMeshSegmentRasterize_ab0_dt1(const vector3* v0, const vector3* v1, int color);
+		template <int LAYOUT>
 		void Draw3DMeshSegmentRasterize_ab1_dt0(const vector3* v0, const vector3* v1, int color);
+		template <typename DEPTH, int LAYOUT>
 		void Draw3DMeshSegmentRasterize_ab1_dt1(const vector3* v0, const vector3* v1, int color);
-		void (Render::* m_fDraw3DMeshSegmentRasterize[4])(const vector3*, const vector3*, int);
+		void (Render::* m_fDraw3DMeshSegmentRasterize[2][4])(const vector3*, const vector3*, int);
+
+		//视口坐标系线段顶点：取整坐标、1/z、相对视口矩形的区域码，每个顶点只计算一次
+		struct SEGMENT_VERTEX
+		{
+			int x;
+			int y;
+			float z;
+			int outcode;
+		};
+		SCRATCH_ARRAY<SEGMENT_VERTEX> m_SegmentVertex;
+
+		//批量线段光栅化：按区域码舍去、直接绘制完全在视口内的线段，部分在视口内的使用上面的函数裁剪绘制
+		template <int LAYOUT>
+		void Draw3DMeshSegmentRasterizeBatch_ab0_dt0(int color);
+		template <typename DEPTH, int LAYOUT>
+		void Draw3DMeshSegmentRasterizeBatch_ab0_dt1(int color);
+		template <int LAYOUT>
+		void Draw3DMeshSegmentRasterizeBatch_ab1_dt0(int color);
+		template <typename DEPTH, int LAYOUT>
+		void Draw3DMeshSegmentRasterizeBatch_ab1_dt1(int color);
+		void (Render::* m_fDraw3DMeshSegmentRasterizeBatch[2][4])(int);
+
+		//渲染状态：线段反走样
+		bool m_EnableRenderStateLineAntiAlias;
+
+		//反走样线段光栅化：沿主轴每个像素中心求出线段在副轴上的位置，按覆盖率写相邻两个像素，
+		//覆盖率在背景与阿尔法混合结果之间插值，即同时作用于前景、背景混合参数，深度测试时只有覆盖率不小于0.5的像素写深度
+		template <typename DEPTH>
+		void Draw3DMeshSegmentRasterizeAntiAlias(const vector3* v0, const vector3* v1, int color);
+		template <typename DEPTH>
+		void Draw3DMeshSegmentRasterizeBatchAntiAlias(int color);
+		void (Render::* m_fDraw3DMeshSegmentRasterizeBatchAntiAlias)(int);
 
 		//----------三角网格相关----------
 
 		//顶点法线表，从本地坐标系转换到世界坐标系
-		std::vector<vector3> m_NormalInWorld;
+		SCRATCH_ARRAY<vector3> m_NormalInWorld;
 
 		//顶点颜色表，光照运算生成
-		std::vector<vector3> m_ColorAfterIlluminationCompute;
+		SCRATCH_ARRAY<vector3> m_ColorAfterIlluminationCompute;
 
 		//顶点纹理表，从原始网格顶点纹理表复制
-		std::vector<vector2> m_TextureCopy;
+		SCRATCH_ARRAY<vector2> m_TextureCopy;
 
 		//被近截面裁剪三角索引表
 		std::vector<int> m_TriangleAfterNearPlaneClip;
 		const std::vector<int>* m_pTriangleAfterNearPlaneClip;
 
 		//被表面拣选三角索引表，存储可见三角形索引
-		std::vector<int> m_TriangleAfterFaceCulling;
+		SCRATCH_ARRAY<int> m_TriangleAfterFaceCulling;
 
-		//投影坐标系下视线向量
-		const vector3 m_SightLineInProjection;
+		//簇拣选之后的三角索引表
+		std::vector<int> m_TriangleAfterMeshletCulling;
+
+		//簇拣选：舍去包围球在视锥体之外的簇，开启表面拣选时在本地坐标系下按法线锥舍去全部被拣选的簇，
+		//返回拣选之后的三角索引表，网格没有簇或没有簇被舍去时返回原始三角索引表
+		const std::vector<int>* Draw3DMeshTriangleMeshletCulling(const MESH_TRIANGLE* mesh_triangle);
+
+		//渲染状态：顶点压缩
+		bool m_EnableRenderStateVertexCompaction;
+
+		//顶点压缩：先是顶点区域码，压缩之后是原始顶点到压缩顶点的下标
+		SCRATCH_ARRAY<int> m_VertexCompactionIndex;
+
+		//顶点压缩之后的顶点法线表
+		SCRATCH_ARRAY<vector3> m_NormalCompaction;
+
+		//顶点压缩之后的三角索引表，作为近截面裁剪的原始三角索引表
+		std::vector<int> m_TriangleAfterCompaction;
+
+		//顶点压缩：在摄像机坐标系下舍去完全在近截面之前、视锥体某一侧面之外的三角，开启表面拣选时按
+		//三点行列式的符号舍去被拣选的三角，然后把被保留三角引用的顶点按原始顺序原地压缩到世界、摄像机坐标系
+		//顶点表和纹理表前部，法线复制到m_NormalCompaction，三角索引改写后放入m_TriangleAfterCompaction，
+		//舍去是保守的，表面拣选仍然进行，没有三角保留时返回false
+		bool Draw3DMeshTriangleCompaction(
+			const MESH_TRIANGLE* mesh_triangle,
+			const std::vector<int>* triangle,
+			bool illumination_compute,
+			bool texture_sample);
+
+		//细节层次允许的屏幕误差像素数，不大于0时总是使用原始网格
+		float m_LodPixelError;
+
+		//细节层次选择：几何误差按世界变换最大轴缩放，除以包围球最近点距离后乘以视口缩放得到屏幕误差像素数，
+		//选择误差不超过m_LodPixelError的最粗一级，包围球跨过近截面时使用原始网格
+		const MESH_TRIANGLE* Draw3DMeshTriangleSelectLod(const MESH_TRIANGLE* mesh_triangle);
 
 		//光源表中是否存在有效光源
 		bool IsLightWorldEnable();
 
-		//光照运算，计算结果存储到m_VertexColor
+		//光照运算，normal与m_VertexInWorld一一对应，计算结果存储到m_ColorAfterIlluminationCompute
 		void IlluminationCompute(
-			const std::vector<vector3>* normal,
+			const vector3* normal,
+			int normal_count,
 			const vector3* eye);
 
-		//近截面线裁剪，裁剪完毕m_pTriangleAfterNearPlaneClip
-		//指向有效三角索引表，m_VertexInCamera有可能增加
-		void Draw3DMeshTriangleNearPlaneClip_ts0_ic0(float sphere_radius, const std::vector<int>* triangle_origin);
-		void Draw3DMeshTriangleNearPlaneClip_ts0_ic1(float sphere_radius, const std::vector<int>* triangle_origin);
-		void Draw3DMeshTriangleNearPlaneClip_ts1_ic0(float sphere_radius, const std::vector<int>* triangle_origin);
-		void Draw3DMeshTriangleNearPlaneClip_ts1_ic1(float sphere_radius, const std::vector<int>* triangle_origin);
-		void (Render::* m_fDraw3DMeshTriangleNearPlaneClip[4])(float, const std::vector<int>*);
+		//三角裁剪顶点分类表、三角索引中间结果
+		std::vector<signed char> m_VertexClipSide;
+		std::vector<int> m_TriangleClipSwap;
+
+		//三角裁剪：按摄像机坐标系下截面plane(a,b,c,d)，ax+by+cz>=d为内侧，将triangle_in裁剪到triangle_out，
+		//截点按attribute_mask插值颜色、纹理之后追加到m_VertexInCamera及对应属性表，near_plane为真时截点z直接取d，
+		//顶点表和三角索引表先统计数量一次性扩大再写入，没有三角被裁剪或舍去时返回false且不写triangle_out
+		bool Draw3DMeshTriangleClip(
+			const float* plane,
+			bool near_plane,
+			int attribute_mask,
+			const std::vector<int>* triangle_in,
+			std::vector<int>* triangle_out);
+
+		//近截面、保护带裁剪，裁剪完毕m_pTriangleAfterNearPlaneClip
+		//指向有效三角索引表，m_VertexInCamera有可能增加，m_VertexValidMask标记有效顶点
+		void Draw3DMeshTriangleNearPlaneClip(
+			float sphere_radius,
+			const std::vector<int>* triangle_origin,
+			int attribute_mask);
+
+		//有效顶点位表，每32个顶点一个字，投影变换和视口变换只处理有效顶点：只有裁剪之后三角索引表引用的顶点有效，
+		//不会包含近截面之前的顶点
+		SCRATCH_ARRAY<unsigned int> m_VertexValidMask;
 
 		//表面拣选，完毕之后可见三角放入m_TriangleVisible
 		void FaceCulling();
@@ -197,7 +442,6 @@ namespace render {
 			int index0, int index1, int index2, float* vertex_data0, float* vertex_data1, float* vertex_data2);
 		int Draw3DMeshTriangleFill_ts1_ic1(
 			int index0, int index1, int index2, float* vertex_data0, float* vertex_data1, float* vertex_data2);
-		int (Render::* m_fDraw3DMeshTriangleFill[4])(int, int, int, float*, float*, float*);
 
 		//三角光栅
 		struct TRIANGLE_RASTERIZE
@@ -220,24 +464,114 @@ namespace render {
 			float* vertex_data3,
 			TRIANGLE_RASTERIZE* triangle_flatbottom,
 			TRIANGLE_RASTERIZE* triangle_flattop);
-		//三角光栅化：光照、纹理必须有且只有一个被激活
-		//Draw3DMeshTriangleRasterize_ts0_ic0_ab0_dt0无效
-		//Draw3DMeshTriangleRasterize_ts0_ic0_ab0_dt1无效
-		//Draw3DMeshTriangleRasterize_ts0_ic0_ab1_dt0无效
-		//Draw3DMeshTriangleRasterize_ts0_ic0_ab1_dt1无效
-		void Draw3DMeshTriangleRasterize_ts0_ic1_ab0_dt0(const TRIANGLE_RASTERIZE* triangle_rasterize);
-		void Draw3DMeshTriangleRasterize_ts0_ic1_ab0_dt1(const TRIANGLE_RASTERIZE* triangle_rasterize);
-		void Draw3DMeshTriangleRasterize_ts0_ic1_ab1_dt0(const TRIANGLE_RASTERIZE* triangle_rasterize);
-		void Draw3DMeshTriangleRasterize_ts0_ic1_ab1_dt1(const TRIANGLE_RASTERIZE* triangle_rasterize);
-		void Draw3DMeshTriangleRasterize_ts1_ic0_ab0_dt0(const TRIANGLE_RASTERIZE* triangle_rasterize);
-		void Draw3DMeshTriangleRasterize_ts1_ic0_ab0_dt1(const TRIANGLE_RASTERIZE* triangle_rasterize);
-		void Draw3DMeshTriangleRasterize_ts1_ic0_ab1_dt0(const TRIANGLE_RASTERIZE* triangle_rasterize);
-		void Draw3DMeshTriangleRasterize_ts1_ic0_ab1_dt1(const TRIANGLE_RASTERIZE* triangle_rasterize);
-		//Draw3DMeshTriangleRasterize_ts1_ic1_ab0_dt0无效
-		//Draw3DMeshTriangleRasterize_ts1_ic1_ab0_dt1无效
-		//Draw3DMeshTriangleRasterize_ts1_ic1_ab1_dt0无效
-		//Draw3DMeshTriangleRasterize_ts1_ic1_ab1_dt1无效
-		void (Render::* m_fDraw3DMeshTriangleRasterize[16])(const TRIANGLE_RASTERIZE* triangle_rasterize);
+		//三角光栅化：按渲染状态ts、ic、ab和深度模式DT生成，深度测试相关的以深度格式DEPTH为模板参数，
+		//所有渲染状态判断都在编译期完成，光照、纹理至少激活一个，同时激活时纹理颜色按光照颜色调制，仅写深度时都不激活
+		template <int TS, int IC, int AB, int DT, typename DEPTH>
+		void Draw3DMeshTriangleRasterize(const TRIANGLE_RASTERIZE* triangle_rasterize);
+
+		//三角光栅化单个像素：深度测试、着色、写入，data_eyx为1/z，光照时接c.x/z、c.y/z、c.z/z，纹理时接t.x/z、t.y/z
+		template <int TS, int IC, int AB, int DT, typename DEPTH>
+		void Draw3DMeshTriangleRasterizePixel(int pixel_idx, const float* data_eyx);
+
+		//小三角光栅化：rect内逐个像素采样点以边函数测试，按重心坐标插值，不做分割和扫描线步进，
+		//边上的采样点与扫描线光栅化的浮点步进结果可能不同，覆盖不保证逐像素相同
+		template <int TS, int IC, int AB, int DT, typename DEPTH>
+		void Draw3DMeshTriangleRasterizePoint(
+			int fill_count,
+			const float* vertex_data0,
+			const float* vertex_data1,
+			const float* vertex_data2,
+			const RECTANGLE* rect);
+
+		//三角光栅化统计
+		RASTERIZE_STATISTICS m_RasterizeStatistics;
+
+		//光栅化所有可见三角：填充、分割、光栅化都直接调用，每次绘制只通过函数表选择一次
+		template <int TS, int IC, int AB, int DT, typename DEPTH>
+		void Draw3DMeshTriangleRasterizeBatch();
+
+		//函数表下标为(de ts ic ab dt)，de只在dt有效时才会被置位，无效组合为NULL，
+		//深度相等测试(de)用于深度预渲染之后的着色，每个像素只着色一次，深度已经写入无需再写
+		void (Render::* m_fDraw3DMeshTriangleRasterizeBatch[32])();
+
+		//仅写深度，只插值1/z
+		void (Render::* m_fDraw3DMeshTriangleRasterizeBatchDepthOnly)();
+
+		//视口坐标系顶点相对视口的区域码，以定点数计算
+		SCRATCH_ARRAY<int> m_VertexViewOutcode;
+
+		//当前光栅化的三角完全在视口之内，光栅化时不再做视口相交测试和扫描线裁剪
+		bool m_RasterizeInsideView;
+
+		//----------绘制命令表相关----------
+
+		//绘制命令，记录添加时的世界变换和渲染状态
+		struct DRAW_COMMAND
+		{
+			//模型，二者有且只有一个非空
+			const MESH_TRIANGLE* mesh_triangle;
+			const MESH_SEGMENT* mesh_segment;
+
+			//线段颜色
+			int color;
+
+			//视点
+			bool eye_enable;
+			vector3 eye;
+
+			//世界变换矩阵
+			matrix4 transform_world;
+
+			//渲染状态键、阿尔法混合参数、材质、纹理
+			int render_state_key;
+			float foreground_alpha_blend_value;
+			MATERIAL material;
+			const TEXTURE* texture;
+
+			//排序依据：批次（0仅写深度、1不透明、2阿尔法混合）、深度分段、
+			//摄像机坐标系下包围球球心z值、添加顺序
+			int pass;
+			int depth_bucket;
+			float depth;
+			int order;
+		};
+
+		//绘制命令表及其排序结果
+		std::vector<DRAW_COMMAND> m_DrawCommand;
+		std::vector<const DRAW_COMMAND*> m_DrawCommandSorted;
+
+		//场景提交队列是否开启
+		bool m_SceneQueueEnable;
+
+		//得到、设置渲染状态键，渲染状态键由各渲染状态标志位组成
+		int GetRenderStateKey();
+		void SetRenderStateKey(int render_state_key);
+
+		//记录绘制命令公共部分，视锥体测试失败不记录并返回NULL
+		DRAW_COMMAND* RecordDrawCommand(float sphere_radius);
+
+		//绘制命令排序比较
+		static bool DrawCommandLess(const DRAW_COMMAND* dc1, const DRAW_COMMAND* dc2);
+
+		//----------遮挡剔除相关----------
+
+		//渲染状态：遮挡剔除
+		bool m_EnableRenderStateOcclusionCulling;
+
+		//遮挡深度缓冲，存储1/z，0表示无遮挡
+		std::vector<float> m_OcclusionBuffer;
+
+		//遮挡体在遮挡深度缓冲坐标系下的顶点表，{x, y, 1/z}
+		std::vector<vector3> m_OccluderVertex;
+
+		//遮挡体三角光栅化：只写入整个像素都在三角内部的像素，深度取像素内最远值与缓冲中较近的一个
+		void OccluderTriangleRasterize(
+			const vector3* v0,
+			const vector3* v1,
+			const vector3* v2);
+
+		//遮挡测试：包围球屏幕矩形内遮挡深度都比包围球最近点近则被遮挡，返回false
+		bool OcclusionCullingTest(float sphere_radius);
 
 		//拷贝构造
 		Render(const Render& that);
@@ -253,7 +587,9 @@ namespace render {
 		//析构
 		~Render();
 
-		//初始
+		//初始，buffer_pitch为缓冲行间距（像素），不小于宽度并向上对齐到64字节，默认为0即宽度向上对齐，
+		//行间距一般不等于宽度，读取渲染结果时以GetBufferSize得到的行间距逐行访问，
+		//再次初始时已分配的缓冲容量足够则重用
 		void Init(
 			int buffer_width,
 			int buffer_height,
@@ -263,14 +599,16 @@ namespace render {
 			int default_texture_color,
 			const vector3* eye,
 			const vector3* at,
-			const vector3* up);
+			const vector3* up,
+			int buffer_pitch = 0);
 
-		//得到缓冲尺寸
+		//得到缓冲尺寸、行间距
 		int GetBufferSize(
 			int* buffer_width = NULL,
-			int* buffer_height = NULL);
+			int* buffer_height = NULL,
+			int* buffer_pitch = NULL);
 
-		//得到渲染结果
+		//得到渲染结果，相邻两行起点相差行间距个像素，分块布局时返回转换后的线性缓冲
 		const int* GetVideoBuffer();
 
 		//----------2D绘制相关----------
@@ -306,12 +644,54 @@ namespace render {
 			float near_plane,
 			float far_plane);
 
+		//得到世界坐标系下视锥体六个截面(a,b,c,d)，ax+by+cz+d>=0为内侧，
+		//依次为近、远、左、右、下、上，用于场景包围体层次树查询
+		void GetCoordinateCameraFrustumPlaneInWorld(float plane[6][4]);
+
 		//填充缓冲区
 		void FillBuffer(
 			bool video,
 			int color,
 			bool depth);
 
+		//设置延迟填充缓冲：开启时FillBuffer只把缓冲分块标记为待填充，块在第一次被绘制时才填充，
+		//GetVideoBuffer时填充其余块，只占屏幕一小部分的场景可以省去大部分填充
+		void SetLazyFillBuffer(bool lazy_fill_buffer);
+
+		//设置动态分辨率：开启时BeginFrame按上一帧用时与目标用时target_frame_time(毫秒)调整内部分辨率缩放，
+		//范围[scale_min, 1]，3D绘制在内部分辨率下进行，GetVideoBuffer时双线性放大到缓冲尺寸，
+		//Draw2DAsciiString延迟到放大之后按原始分辨率绘制，其它2D绘制使用内部分辨率坐标并随3D一起放大
+		void SetDynamicResolution(
+			bool enable,
+			float target_frame_time,
+			float scale_min = 0.5f);
+
+		//开始一帧：确定本帧内部分辨率并缩放视口变换，在FillBuffer之前调用，帧用时从这里计算到GetVideoBuffer
+		void BeginFrame();
+
+		//得到当前内部分辨率缩放、内部分辨率尺寸
+		float GetDynamicResolutionScale(
+			int* render_width = NULL,
+			int* render_height = NULL);
+
+		//设置缓冲布局，缓冲内容不做转换，切换后需要重新填充
+		bool SetBufferLayout(int buffer_layout);
+		int GetBufferLayout();
+
+		//设置深度格式，已初始时按新格式重新分配并填充深度缓冲
+		bool SetDepthFormat(int depth_format);
+		int GetDepthFormat();
+
+		//得到管线临时内存单次绘制的峰值字节数
+		size_t GetScratchPeakBytes();
+
+		//设置细节层次允许的屏幕误差像素数，不大于0时总是使用原始网格
+		void SetLodPixelError(float lod_pixel_error);
+
+		//清空、得到三角光栅化统计，每帧绘制之前清空
+		void ClearRasterizeStatistics();
+		const RASTERIZE_STATISTICS* GetRasterizeStatistics();
+
 		//设置顶点变换矩阵
 		bool SetTransform(
 			int transform_type,
@@ -322,6 +702,9 @@ namespace render {
 			int render_state_type,
 			bool enable);
 
+		//设置深度测试参数：深度相等测试标志，用于深度预渲染之后的着色
+		void SetRenderStateDepthTestEqual(bool depth_test_equal);
+
 		//设置阿尔法混合参数：阿尔法混合前景色混合参数
 		void SetRenderStateForegroundAlphaBlendValue(float foreground_alpha_blend_value);
 
@@ -340,20 +723,57 @@ namespace render {
 		void SetRenderStateDefaultTextureColor(int color);
 		void SetRenderStateTexture(const TEXTURE* texture);
 
+		//----------3D绘制相关：遮挡剔除----------
+
+		//清空遮挡深度缓冲，每帧绘制遮挡体之前调用
+		void ClearOcclusionBuffer();
+
+		//绘制遮挡体：以当前世界变换、摄像机变换将三角模型光栅化到低分辨率的遮挡深度缓冲，
+		//不影响显示缓冲和深度缓冲，有顶点在近截面之前的三角不绘制，
+		//其后开启遮挡剔除的Draw3DMeshSegment、Draw3DMeshTriangle在顶点变换之前进行遮挡测试
+		void DrawOccluderMeshTriangle(const MESH_TRIANGLE* mesh_triangle);
+
 		//----------3D绘制相关：线段----------
 
-		//绘制线段模型：深度测试、阿尔法混合
+		//绘制线段模型：深度测试、阿尔法混合、遮挡剔除、线段反走样
 		void Draw3DMeshSegment(
 			const MESH_SEGMENT* mesh_segment,
 			int color);
 
 		//----------3D绘制相关：三角----------
 
-		//绘制三角模型：深度测试、表面拣选、阿尔法混合、光照运算、纹理采样
+		//绘制三角模型：深度测试、表面拣选、阿尔法混合、光照运算、纹理采样、仅写深度、遮挡剔除
 		void Draw3DMeshTriangle(
 			const MESH_TRIANGLE* mesh_triangle,
 			const vector3* eye = NULL);
 
+		//----------3D绘制相关：绘制命令表----------
+
+		//清空绘制命令表
+		void ClearDrawCommand();
+
+		//添加绘制命令：记录当前世界变换、渲染状态、材质、纹理，执行时才绘制，
+		//添加时以当前摄像机变换进行视锥体测试和排序，光源和视口变换在执行时取当前值
+		void AddDrawCommand(
+			const MESH_TRIANGLE* mesh_triangle,
+			const vector3* eye = NULL);
+		void AddDrawCommand(
+			const MESH_SEGMENT* mesh_segment,
+			int color);
+
+		//排序并执行绘制命令表，执行完毕恢复执行前的渲染状态，排序规则：
+		//仅写深度的最先，然后不透明的由近到远（同一深度分段内按渲染状态、纹理分组），
+		//最后阿尔法混合的由远到近
+		void ExecuteDrawCommand();
+
+		//开始场景提交队列：其后的Draw3DMeshSegment、Draw3DMeshTriangle不立即绘制，而是按
+		//摄像机坐标系下包围球球心添加为绘制命令，以便不透明的由近到远、阿尔法混合的由远到近
+		//绘制，2D绘制不受影响仍然立即绘制
+		void BeginScene();
+
+		//结束场景提交队列：排序执行并清空绘制命令表
+		void EndScene();
+
 		//结束
 		void End();
 	};
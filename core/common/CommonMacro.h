@@ -1,6 +1,8 @@
 #ifndef _COLOR_H_
 #define _COLOR_H_
 
+#include <cstring>
+
 namespace render {
 
 //空地址
@@ -8,8 +10,24 @@ namespace render {
 #define NULL 0
 #endif
 
-//浮点数判断
+//浮点数判断策略，编译时选择：
+//_FLT_POLICY_FIXED：乘以_FLT_DECIMAL_DIGITS截断为整数后比较，小于1/_FLT_DECIMAL_DIGITS的差异视为相等
+//_FLT_POLICY_EXACT：直接按IEEE浮点数比较
+//_FLT_POLICY_ULP：相差不超过_FLT_ULP_TOLERANCE个最小精度单位视为相等，判零使用绝对误差_FLT_EPSILON_ZERO
+//浮点深度缓冲的逐像素深度测试总是直接比较，不受此策略影响，见Render.cpp DEPTH_FLOAT，
+//示例场景在各策略下图像相同，见test/TestRender.cpp，默认直接比较，开销最小
+#define _FLT_POLICY_FIXED 0
+#define _FLT_POLICY_EXACT 1
+#define _FLT_POLICY_ULP 2
+#ifndef _FLT_POLICY
+#define _FLT_POLICY _FLT_POLICY_EXACT
+#endif
+
 #define _FLT_DECIMAL_DIGITS 1000000.0f
+#define _FLT_ULP_TOLERANCE 4
+#define _FLT_EPSILON_ZERO 0.000001f
+
+#if _FLT_POLICY == _FLT_POLICY_FIXED
 #define _FLT_EQUAL_ZERO(flt) \
 	(0==(long long)((flt)*_FLT_DECIMAL_DIGITS))
 #define _FLT_LESS_FLT(flt1,flt2) \
@@ -18,6 +36,35 @@ namespace render {
 	((long long)((flt1)*_FLT_DECIMAL_DIGITS)==(long long)((flt2)*_FLT_DECIMAL_DIGITS))
 #define _FLT_LESS_EQUAL_FLT(flt1,flt2) \
 	(_FLT_LESS_FLT(flt1,flt2) || _FLT_EQUAL_FLT(flt1,flt2))
+#elif _FLT_POLICY == _FLT_POLICY_EXACT
+#define _FLT_EQUAL_ZERO(flt) \
+	(0.0f==(flt))
+#define _FLT_LESS_FLT(flt1,flt2) \
+	((flt1)<(flt2))
+#define _FLT_EQUAL_FLT(flt1,flt2) \
+	((flt1)==(flt2))
+#define _FLT_LESS_EQUAL_FLT(flt1,flt2) \
+	((flt1)<=(flt2))
+#elif _FLT_POLICY == _FLT_POLICY_ULP
+#define _FLT_EQUAL_ZERO(flt) \
+	(-_FLT_EPSILON_ZERO<(flt)&&(flt)<_FLT_EPSILON_ZERO)
+#define _FLT_LESS_FLT(flt1,flt2) \
+	(FltOrder(flt1)+_FLT_ULP_TOLERANCE<FltOrder(flt2))
+#define _FLT_EQUAL_FLT(flt1,flt2) \
+	(!_FLT_LESS_FLT(flt1,flt2) && !_FLT_LESS_FLT(flt2,flt1))
+#define _FLT_LESS_EQUAL_FLT(flt1,flt2) \
+	(!_FLT_LESS_FLT(flt2,flt1))
+
+	//浮点数映射为按大小单调递增的整数，相邻浮点数相差1，+0与-0相同
+	inline long long FltOrder(float flt)
+	{
+		int bit;
+		memcpy(&bit, &flt, sizeof(bit));
+		return bit < 0 ? -(long long)(bit & 0x7fffffff) : (long long)bit;
+	}
+#else
+#error "_FLT_POLICY must be _FLT_POLICY_FIXED, _FLT_POLICY_EXACT or _FLT_POLICY_ULP"
+#endif
 
 //颜色
 #define _COLOR_SET(r,g,b) \
@@ -0,0 +1,110 @@
+#include "ScratchArena.h"
+
+namespace render {
+
+//分配对齐字节数
+#define _SCRATCH_ARENA_ALIGN 16
+
+	static void ScratchArenaAddBlock(SCRATCH_ARENA* scratch_arena, size_t size)
+	{
+		SCRATCH_ARENA_BLOCK block;
+		block.buffer = new char[size];
+		block.size = size;
+		scratch_arena->block.push_back(block);
+		scratch_arena->used = 0;
+	}
+
+	SCRATCH_ARENA* ScratchArenaCreate(size_t size)
+	{
+		SCRATCH_ARENA* scratch_arena = new SCRATCH_ARENA;
+		scratch_arena->used = 0;
+		scratch_arena->current_bytes = 0;
+		scratch_arena->peak_bytes = 0;
+		ScratchArenaAddBlock(scratch_arena, size);
+		return scratch_arena;
+	}
+
+	void* ScratchArenaAllocate(
+		SCRATCH_ARENA* scratch_arena,
+		size_t size)
+	{
+		//按地址对齐，块起点由new保证的对齐不一定满足
+		SCRATCH_ARENA_BLOCK* block = &scratch_arena->block.back();
+		size_t address = (size_t)(block->buffer + scratch_arena->used);
+		size_t padding = (_SCRATCH_ARENA_ALIGN - address % _SCRATCH_ARENA_ALIGN) % _SCRATCH_ARENA_ALIGN;
+
+		//当前块不够时追加新块，新块至少是当前块的2倍，原有分配仍然有效
+		if (scratch_arena->used + padding + size > block->size)
+		{
+			size_t new_size = block->size * 2;
+			if (new_size < size + _SCRATCH_ARENA_ALIGN)
+				new_size = size + _SCRATCH_ARENA_ALIGN;
+			ScratchArenaAddBlock(scratch_arena, new_size);
+			block = &scratch_arena->block.back();
+			address = (size_t)block->buffer;
+			padding = (_SCRATCH_ARENA_ALIGN - address % _SCRATCH_ARENA_ALIGN) % _SCRATCH_ARENA_ALIGN;
+		}
+
+		void* buffer = block->buffer + scratch_arena->used + padding;
+		scratch_arena->used += padding + size;
+		scratch_arena->current_bytes += padding + size;
+		if (scratch_arena->peak_bytes < scratch_arena->current_bytes)
+			scratch_arena->peak_bytes = scratch_arena->current_bytes;
+		return buffer;
+	}
+
+	bool ScratchArenaExtend(
+		SCRATCH_ARENA* scratch_arena,
+		void* buffer,
+		size_t old_size,
+		size_t new_size)
+	{
+		SCRATCH_ARENA_BLOCK* block = &scratch_arena->block.back();
+		char* end = (char*)buffer + old_size;
+		if (end != block->buffer + scratch_arena->used)
+			return false;
+
+		size_t offset = (char*)buffer - block->buffer;
+		if (offset + new_size > block->size)
+			return false;
+
+		scratch_arena->used = offset + new_size;
+		scratch_arena->current_bytes += new_size - old_size;
+		if (scratch_arena->peak_bytes < scratch_arena->current_bytes)
+			scratch_arena->peak_bytes = scratch_arena->current_bytes;
+		return true;
+	}
+
+	void ScratchArenaReset(SCRATCH_ARENA* scratch_arena)
+	{
+		//多个块合并为一个峰值大小的块，之后同样规模的使用不再追加块
+		if (1 < scratch_arena->block.size())
+		{
+			int block_count = (int)scratch_arena->block.size();
+			for (int i = 0; i < block_count; ++i)
+				delete[] scratch_arena->block[i].buffer;
+			scratch_arena->block.clear();
+			ScratchArenaAddBlock(scratch_arena, scratch_arena->peak_bytes + _SCRATCH_ARENA_ALIGN);
+		}
+
+		scratch_arena->used = 0;
+		scratch_arena->current_bytes = 0;
+	}
+
+	size_t ScratchArenaPeakBytes(const SCRATCH_ARENA* scratch_arena)
+	{
+		return scratch_arena->peak_bytes;
+	}
+
+	void ScratchArenaRelease(SCRATCH_ARENA* scratch_arena)
+	{
+		if (NULL == scratch_arena)
+			return;
+
+		int block_count = (int)scratch_arena->block.size();
+		for (int i = 0; i < block_count; ++i)
+			delete[] scratch_arena->block[i].buffer;
+		delete scratch_arena;
+	}
+
+}
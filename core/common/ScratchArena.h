@@ -0,0 +1,164 @@
+#ifndef _SCRATCH_ARENA_H_
+#define _SCRATCH_ARENA_H_
+
+#include "CommonMacro.h"
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace render {
+
+	struct SCRATCH_ARENA_BLOCK
+	{
+		char* buffer;
+		size_t size;
+	};
+
+	//线性临时内存：从块中顺序分配，重置时整体回收，当前块不够时追加新块，
+	//重置时若有多个块则按峰值合并为一个块，稳定之后分配不再访问堆
+	struct SCRATCH_ARENA
+	{
+		//块表，最后一个块为当前分配块
+		std::vector<SCRATCH_ARENA_BLOCK> block;
+
+		//当前块已分配字节数
+		size_t used;
+
+		//本次重置以来所有块已分配字节数、历史峰值
+		size_t current_bytes;
+		size_t peak_bytes;
+	};
+
+	//创建临时内存，size为初始块字节数
+	SCRATCH_ARENA* ScratchArenaCreate(size_t size);
+
+	//分配size字节，按16字节对齐，重置之前一直有效
+	void* ScratchArenaAllocate(
+		SCRATCH_ARENA* scratch_arena,
+		size_t size);
+
+	//buffer是当前块最后一次分配且块内剩余足够时原地把old_size扩大到new_size，返回true
+	bool ScratchArenaExtend(
+		SCRATCH_ARENA* scratch_arena,
+		void* buffer,
+		size_t old_size,
+		size_t new_size);
+
+	//回收所有分配
+	void ScratchArenaReset(SCRATCH_ARENA* scratch_arena);
+
+	//得到历史峰值字节数
+	size_t ScratchArenaPeakBytes(const SCRATCH_ARENA* scratch_arena);
+
+	//释放临时内存
+	void ScratchArenaRelease(SCRATCH_ARENA* scratch_arena);
+
+	//从临时内存分配的数组，接口与std::vector相同的部分除resize之外行为也相同，T必须可以按字节复制，
+	//临时内存重置时必须同时Reset
+	template <typename T>
+	struct SCRATCH_ARRAY
+	{
+		SCRATCH_ARENA* arena;
+		T* buffer;
+		int count;
+		int capacity;
+
+		SCRATCH_ARRAY()
+			: arena(NULL)
+			, buffer(NULL)
+			, count(0)
+			, capacity(0)
+		{}
+
+		//绑定临时内存并放弃数据，不回收内存，由临时内存重置时统一回收
+		void Reset(SCRATCH_ARENA* scratch_arena)
+		{
+			arena = scratch_arena;
+			buffer = NULL;
+			count = 0;
+			capacity = 0;
+		}
+
+		//当前块末尾时原地扩大，否则重新分配并复制已有元素
+		void reserve(int new_capacity)
+		{
+			if (new_capacity <= capacity)
+				return;
+			if (NULL != buffer &&
+				ScratchArenaExtend(arena, buffer, sizeof(T) * capacity, sizeof(T) * new_capacity))
+			{
+				capacity = new_capacity;
+				return;
+			}
+			T* new_buffer = (T*)ScratchArenaAllocate(arena, sizeof(T) * new_capacity);
+			if (0 < count)
+				memcpy((void*)new_buffer, buffer, sizeof(T) * count);
+			buffer = new_buffer;
+			capacity = new_capacity;
+		}
+
+		//与std::vector不同，扩大时新元素不初始化，由调用者写入
+		void resize(int new_count)
+		{
+			reserve(new_count);
+			count = new_count;
+		}
+
+		void push_back(const T& value)
+		{
+			if (count == capacity)
+				reserve(0 == capacity ? 16 : capacity * 2);
+			buffer[count++] = value;
+		}
+
+		void clear()
+		{
+			count = 0;
+		}
+
+		//复制[first, last)
+		void assign(const T* first, const T* last)
+		{
+			count = 0;
+			reserve((int)(last - first));
+			if (first != last)
+				memcpy((void*)buffer, first, sizeof(T) * (last - first));
+			count = (int)(last - first);
+		}
+
+		size_t size() const
+		{
+			return (size_t)count;
+		}
+
+		bool empty() const
+		{
+			return 0 == count;
+		}
+
+		T* data()
+		{
+			return buffer;
+		}
+
+		T& operator [] (int i)
+		{
+			return buffer[i];
+		}
+		const T& operator [] (int i) const
+		{
+			return buffer[i];
+		}
+
+		T& at(int i)
+		{
+			return buffer[i];
+		}
+		const T& at(int i) const
+		{
+			return buffer[i];
+		}
+	};
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "MeshSegment.h"
 #include "Render.h"
 #include <cstdio>
+#include <cmath>
 
 namespace render {
 
@@ -58,57 +59,151 @@ namespace render {
 	}
 
 	MESH_SEGMENT* MeshSegmentFormMeshTriangle(
-		const MESH_TRIANGLE* mesh_triangle)
+		const MESH_TRIANGLE* mesh_triangle,
+		float feature_angle)
 	{
 		MESH_SEGMENT* mesh_segment = new MESH_SEGMENT;
 
 		//顶点
 		mesh_segment->vertex = mesh_triangle->vertex;
 
-		//线段
-		int triangle_count = (int)mesh_triangle->triangle.size();
-		for (int i = 0; i < triangle_count; i += 3)
-		{
-			int ti0 = mesh_triangle->triangle[i];
-			int ti1 = mesh_triangle->triangle[i + 1];
-			int ti2 = mesh_triangle->triangle[i + 2];
+		//半边数量，第i个半边为第i/3个三角的第i%3条边
+		int vertex_count = (int)mesh_triangle->vertex.size();
+		int half_edge_count = (int)mesh_triangle->triangle.size() / 3 * 3;
+		const int* triangle = half_edge_count > 0 ? &mesh_triangle->triangle[0] : NULL;
 
-			int segment[3][2] =
-			{
-				{ti0, ti1},
-				{ti1, ti2},
-				{ti2, ti0},
-			};
+		//按较小顶点索引将半边分桶（计数排序，桶内保持半边顺序）
+		std::vector<int> bucket_begin(vertex_count + 1, 0);
+		for (int i = 0; i < half_edge_count; ++i)
+		{
+			int i0 = triangle[i];
+			int i1 = triangle[i % 3 == 2 ? i - 2 : i + 1];
+			++bucket_begin[(i0 < i1 ? i0 : i1) + 1];
+		}
+		for (int i = 0; i < vertex_count; ++i)
+			bucket_begin[i + 1] += bucket_begin[i];
+		std::vector<int> bucket_fill(bucket_begin.begin(), bucket_begin.end() - 1);
+		std::vector<int> bucket(half_edge_count);
+		for (int i = 0; i < half_edge_count; ++i)
+		{
+			int i0 = triangle[i];
+			int i1 = triangle[i % 3 == 2 ? i - 2 : i + 1];
+			bucket[bucket_fill[i0 < i1 ? i0 : i1]++] = i;
+		}
 
-			for (int j = 0; j < 3; ++j)
+		//同一个桶内较大顶点索引相同的半边属于同一条线段，以第一个出现的半边为代表，
+		//用较大顶点索引记录其所在桶和代表半边，整体为线性时间
+		std::vector<int> leader(half_edge_count);
+		std::vector<int> seen_bucket(vertex_count, -1);
+		std::vector<int> seen_leader(vertex_count, -1);
+		for (int i = 0; i < vertex_count; ++i)
+		{
+			for (int j = bucket_begin[i]; j < bucket_begin[i + 1]; ++j)
 			{
-				bool find = false;
-				int segment_count = (int)mesh_segment->segment.size();
-				for (int k = 0; k < segment_count; k += 2)
-				{
-					int si0 = mesh_segment->segment[k];
-					int si1 = mesh_segment->segment[k + 1];
-					if ((segment[j][0] == si0 && segment[j][1] == si1) ||
-						(segment[j][0] == si1 && segment[j][1] == si0))
-					{
-						find = true;
-						break;
-					}
-				}
-				if (!find)
+				int k = bucket[j];
+				int i0 = triangle[k];
+				int i1 = triangle[k % 3 == 2 ? k - 2 : k + 1];
+				int index_max = i0 < i1 ? i1 : i0;
+				if (seen_bucket[index_max] == i)
+					leader[k] = seen_leader[index_max];
+				else
 				{
-					mesh_segment->segment.push_back(segment[j][0]);
-					mesh_segment->segment.push_back(segment[j][1]);
+					seen_bucket[index_max] = i;
+					seen_leader[index_max] = k;
+					leader[k] = k;
 				}
 			}
 		}
 
+		//按半边顺序生成线段，并记录相邻三角
+		std::vector<int> half_edge_segment(half_edge_count);
+		std::vector<int> segment_triangle_count;
+		for (int i = 0; i < half_edge_count; ++i)
+		{
+			int segment_index;
+			if (leader[i] == i)
+			{
+				segment_index = (int)segment_triangle_count.size();
+				mesh_segment->segment.push_back(triangle[i]);
+				mesh_segment->segment.push_back(triangle[i % 3 == 2 ? i - 2 : i + 1]);
+				mesh_segment->segment_triangle.push_back(-1);
+				mesh_segment->segment_triangle.push_back(-1);
+				segment_triangle_count.push_back(0);
+			}
+			else
+				segment_index = half_edge_segment[leader[i]];
+			half_edge_segment[i] = segment_index;
+
+			int count = segment_triangle_count[segment_index]++;
+			if (count < 2)
+				mesh_segment->segment_triangle[segment_index * 2 + count] = i / 3;
+		}
+
+		//三角单位法线
+		int triangle_count = half_edge_count / 3;
+		mesh_segment->triangle_normal.resize(triangle_count);
+		for (int i = 0; i < triangle_count; ++i)
+		{
+			const vector3* v0 = &mesh_triangle->vertex[triangle[i * 3]];
+			const vector3* v1 = &mesh_triangle->vertex[triangle[i * 3 + 1]];
+			const vector3* v2 = &mesh_triangle->vertex[triangle[i * 3 + 2]];
+			vector3 normal = (*v1 - *v0).Cross(*v2 - *v0);
+			if (_FLT_EQUAL_ZERO(normal.Length()))
+				mesh_segment->triangle_normal[i].Set(0.0f, 0.0f, 0.0f);
+			else
+				mesh_segment->triangle_normal[i] = normal.Normalize();
+		}
+
+		//边界边、特征边标志
+		float feature_cos = cos(feature_angle);
+		int segment_count = (int)segment_triangle_count.size();
+		mesh_segment->flag.resize(segment_count);
+		for (int i = 0; i < segment_count; ++i)
+		{
+			int flag = 0;
+			if (1 == segment_triangle_count[i])
+				flag |= _MESH_SEGMENT_FLAG_BOUNDARY;
+			else if (2 < segment_triangle_count[i])
+				flag |= _MESH_SEGMENT_FLAG_FEATURE;
+			else
+			{
+				const vector3* n0 = &mesh_segment->triangle_normal[mesh_segment->segment_triangle[i * 2]];
+				const vector3* n1 = &mesh_segment->triangle_normal[mesh_segment->segment_triangle[i * 2 + 1]];
+				if (n0->Dot(*n1) < feature_cos)
+					flag |= _MESH_SEGMENT_FLAG_FEATURE;
+			}
+			mesh_segment->flag[i] = flag;
+		}
+
 		//包围球半径
 		mesh_segment->radius = mesh_triangle->radius;
 
 		return mesh_segment;
 	}
 
+	void MeshSegmentComputeSilhouette(
+		MESH_SEGMENT* mesh_segment,
+		const vector3* eye_in_local)
+	{
+		int segment_count = (int)mesh_segment->flag.size();
+		for (int i = 0; i < segment_count; ++i)
+		{
+			mesh_segment->flag[i] &= ~_MESH_SEGMENT_FLAG_SILHOUETTE;
+
+			int t0 = mesh_segment->segment_triangle[i * 2];
+			int t1 = mesh_segment->segment_triangle[i * 2 + 1];
+			if (-1 == t0 || -1 == t1)
+				continue;
+
+			//两个三角共享线段起点，用其到视点的向量判断朝向
+			vector3 sight = *eye_in_local - mesh_segment->vertex[mesh_segment->segment[i * 2]];
+			bool front0 = mesh_segment->triangle_normal[t0].Dot(sight) > 0.0f;
+			bool front1 = mesh_segment->triangle_normal[t1].Dot(sight) > 0.0f;
+			if (front0 != front1)
+				mesh_segment->flag[i] |= _MESH_SEGMENT_FLAG_SILHOUETTE;
+		}
+	}
+
 	void MeshSegmentUnload(MESH_SEGMENT* mesh_segment)
 	{
 		if (NULL != mesh_segment)
@@ -9,6 +9,13 @@
 
 namespace render {
 
+//线段标志：边界边，只属于一个三角
+#define _MESH_SEGMENT_FLAG_BOUNDARY 0x1
+//线段标志：特征边，相邻两个三角法线夹角大于特征角，或者属于两个以上三角
+#define _MESH_SEGMENT_FLAG_FEATURE 0x2
+//线段标志：轮廓边，相邻两个三角一个朝向视点一个背向视点
+#define _MESH_SEGMENT_FLAG_SILHOUETTE 0x4
+
 	struct MESH_SEGMENT
 	{
 		//顶点
@@ -19,14 +26,33 @@ namespace render {
 
 		//包围球半径
 		float radius;
+
+		//以下只在从三角模型生成时才有，否则为空
+
+		//线段标志，每条线段一个
+		std::vector<int> flag;
+
+		//线段相邻三角，每条线段两个，没有为-1，属于两个以上三角时只记录前两个
+		std::vector<int> segment_triangle;
+
+		//三角单位法线，退化三角为零向量
+		std::vector<vector3> triangle_normal;
 	};
 
 	MESH_SEGMENT* MeshSegmentLoad(
 		const char* file_name,
 		const matrix4* init_transform = NULL);
 
+	//从三角模型生成线段模型，线段顺序、方向与其在三角索引中第一次出现时相同，
+	//同时计算边界边、特征边标志，feature_angle为特征角（弧度）
 	MESH_SEGMENT* MeshSegmentFormMeshTriangle(
-		const MESH_TRIANGLE* mesh_triangle);
+		const MESH_TRIANGLE* mesh_triangle,
+		float feature_angle = _PI / 6.0f);
+
+	//根据本地坐标系下视点计算轮廓边标志，只对从三角模型生成的线段模型有效
+	void MeshSegmentComputeSilhouette(
+		MESH_SEGMENT* mesh_segment,
+		const vector3* eye_in_local);
 
 	void MeshSegmentUnload(MESH_SEGMENT* mesh_segment);
 }
@@ -1,10 +1,25 @@
 #include "MeshTriangle.h"
 #include "Render.h"
 #include <cstdio>
+#include <cfloat>
+#include <cmath>
 #include <algorithm>
 
 namespace render {
 
+//顶点法线：面法线各分量乘以此值截断为整数后都相同视为同一平面，只累积一次，
+//只在载入、生成网格时执行，不受_FLT_POLICY影响，各策略下顶点法线相同
+#define _NORMAL_MERGE_SCALE 1000000.0f
+
+	//两个面法线是否视为同一平面
+	static bool NormalMergeable(const vector3* normal1, const vector3* normal2)
+	{
+		return
+			(long long)(normal1->x * _NORMAL_MERGE_SCALE) == (long long)(normal2->x * _NORMAL_MERGE_SCALE) &&
+			(long long)(normal1->y * _NORMAL_MERGE_SCALE) == (long long)(normal2->y * _NORMAL_MERGE_SCALE) &&
+			(long long)(normal1->z * _NORMAL_MERGE_SCALE) == (long long)(normal2->z * _NORMAL_MERGE_SCALE);
+	}
+
 	static void ComputeNormal(
 		const std::vector<vector3>* vertex,
 		const std::vector<int>* triangle,
@@ -45,13 +60,13 @@ namespace render {
 				int vi = vertex_index[j];
 
 				//在对应顶点的法线积累里面进行查找
-				std::vector<vector3>::iterator it = std::find(
-					normals_reserve[vi].begin(),
-					normals_reserve[vi].end(),
-					normal);
+				int normals_size = (int)normals_reserve[vi].size();
+				int k = 0;
+				while (k < normals_size && !NormalMergeable(&normals_reserve[vi][k], &normal))
+					++k;
 
 				//找不到就添加该面法线法线到顶点的法线积累
-				if (normals_reserve[vi].end() == it)
+				if (normals_size == k)
 					normals_reserve[vi].push_back(normal);
 			}
 		}
@@ -78,6 +93,32 @@ namespace render {
 			normal->at(i) += vertex->at(i);
 	}
 
+	//整圆按slices切片时弦到弧的最大距离
+	static float ComputeChordError(float radius, int slices)
+	{
+		return radius * (1.0f - cos(_PI / slices));
+	}
+
+	//追加细节层次，层次按顺序逐级变粗
+	static void MeshTriangleAddLod(
+		MESH_TRIANGLE* mesh_triangle,
+		MESH_TRIANGLE* lod_mesh_triangle,
+		float error)
+	{
+		MESH_TRIANGLE_LOD lod;
+		lod.mesh_triangle = lod_mesh_triangle;
+		lod.error = error;
+		mesh_triangle->lod.push_back(lod);
+	}
+
+	static void MeshTriangleReleaseLod(MESH_TRIANGLE* mesh_triangle)
+	{
+		int lod_count = (int)mesh_triangle->lod.size();
+		for (int i = 0; i < lod_count; ++i)
+			MeshTriangleUnload(mesh_triangle->lod[i].mesh_triangle);
+		mesh_triangle->lod.clear();
+	}
+
 	MESH_TRIANGLE* MeshTriangleLoad(
 		const char* file_name,
 		const matrix4* init_transform)
@@ -214,7 +255,7 @@ namespace render {
 
 		return mesh_triangle;
 	}
-	MESH_TRIANGLE* MeshTriangleCreateSphere(float radius, int slices_in_xz_plane, int slices_in_y_axis)
+	MESH_TRIANGLE* MeshTriangleCreateSphere(float radius, int slices_in_xz_plane, int slices_in_y_axis, int lod_level_count)
 	{
 		//参数判断
 		if (_FLT_LESS_EQUAL_FLT(radius, 0.0f) ||
@@ -311,9 +352,22 @@ namespace render {
 		//包围球半径
 		mesh_triangle->radius = radius;
 
+		//细节层次：切片数逐级减半，经线方向半圆的切片相当于整圆切片数的2倍
+		for (int i = 0; i < lod_level_count && slices_in_xz_plane / 2 >= 3 && slices_in_y_axis / 2 >= 2; ++i)
+		{
+			slices_in_xz_plane /= 2;
+			slices_in_y_axis /= 2;
+			MeshTriangleAddLod(
+				mesh_triangle,
+				MeshTriangleCreateSphere(radius, slices_in_xz_plane, slices_in_y_axis),
+				std::max(
+					ComputeChordError(radius, slices_in_xz_plane),
+					ComputeChordError(radius, slices_in_y_axis * 2)));
+		}
+
 		return mesh_triangle;
 	}
-	MESH_TRIANGLE* MeshTriangleCreateCone(float radius, float height, int slices_in_xz_plane)
+	MESH_TRIANGLE* MeshTriangleCreateCone(float radius, float height, int slices_in_xz_plane, int lod_level_count)
 	{
 		//参数判断
 		if (_FLT_LESS_EQUAL_FLT(radius, 0.0f) ||
@@ -375,9 +429,19 @@ namespace render {
 		mesh_triangle->radius =
 			ComputeLocalShpereRadius(&mesh_triangle->vertex);
 
+		//细节层次：切片数逐级减半
+		for (int i = 0; i < lod_level_count && slices_in_xz_plane / 2 >= 3; ++i)
+		{
+			slices_in_xz_plane /= 2;
+			MeshTriangleAddLod(
+				mesh_triangle,
+				MeshTriangleCreateCone(radius, height, slices_in_xz_plane),
+				ComputeChordError(radius, slices_in_xz_plane));
+		}
+
 		return mesh_triangle;
 	}
-	MESH_TRIANGLE* MeshTriangleCreateCylinder(float radius_top, float radius_bottom, float height, int slices_in_xz_plane)
+	MESH_TRIANGLE* MeshTriangleCreateCylinder(float radius_top, float radius_bottom, float height, int slices_in_xz_plane, int lod_level_count)
 	{
 		//参数判断
 		if (_FLT_LESS_EQUAL_FLT(radius_top, 0.0f) ||
@@ -447,9 +511,19 @@ namespace render {
 		mesh_triangle->radius =
 			ComputeLocalShpereRadius(&mesh_triangle->vertex);
 
+		//细节层次：切片数逐级减半
+		for (int i = 0; i < lod_level_count && slices_in_xz_plane / 2 >= 3; ++i)
+		{
+			slices_in_xz_plane /= 2;
+			MeshTriangleAddLod(
+				mesh_triangle,
+				MeshTriangleCreateCylinder(radius_top, radius_bottom, height, slices_in_xz_plane),
+				ComputeChordError(std::max(radius_top, radius_bottom), slices_in_xz_plane));
+		}
+
 		return mesh_triangle;
 	}
-	MESH_TRIANGLE* MeshTriangleCreatePipe(float radius_top_in, float radius_top_out, float radius_bottom_in, float radius_bottom_out, float height, int slices_in_xz_plane)
+	MESH_TRIANGLE* MeshTriangleCreatePipe(float radius_top_in, float radius_top_out, float radius_bottom_in, float radius_bottom_out, float height, int slices_in_xz_plane, int lod_level_count)
 	{
 		//参数判断
 		if (_FLT_LESS_EQUAL_FLT(radius_top_in, 0.0f) ||
@@ -532,9 +606,19 @@ namespace render {
 		mesh_triangle->radius =
 			ComputeLocalShpereRadius(&mesh_triangle->vertex);
 
+		//细节层次：切片数逐级减半
+		for (int i = 0; i < lod_level_count && slices_in_xz_plane / 2 >= 3; ++i)
+		{
+			slices_in_xz_plane /= 2;
+			MeshTriangleAddLod(
+				mesh_triangle,
+				MeshTriangleCreatePipe(radius_top_in, radius_top_out, radius_bottom_in, radius_bottom_out, height, slices_in_xz_plane),
+				ComputeChordError(std::max(radius_top_out, radius_bottom_out), slices_in_xz_plane));
+		}
+
 		return mesh_triangle;
 	}
-	MESH_TRIANGLE* MeshTriangleCreateTorus(float radius_in, float radius_out, int slices_in_xy_plane, int slices_in_xz_plane)
+	MESH_TRIANGLE* MeshTriangleCreateTorus(float radius_in, float radius_out, int slices_in_xy_plane, int slices_in_xz_plane, int lod_level_count)
 	{
 		//参数判断
 		if (_FLT_LESS_EQUAL_FLT(radius_in, 0.0f) ||
@@ -619,13 +703,458 @@ namespace render {
 		mesh_triangle->radius =
 			ComputeLocalShpereRadius(&mesh_triangle->vertex);
 
+		//细节层次：切片数逐级减半，剖面圆和环的误差取较大者
+		for (int i = 0; i < lod_level_count && slices_in_xy_plane / 2 >= 3 && slices_in_xz_plane / 2 >= 3; ++i)
+		{
+			slices_in_xy_plane /= 2;
+			slices_in_xz_plane /= 2;
+			MeshTriangleAddLod(
+				mesh_triangle,
+				MeshTriangleCreateTorus(radius_in, radius_out, slices_in_xy_plane, slices_in_xz_plane),
+				std::max(
+					ComputeChordError((radius_out - radius_in) / 2.0f, slices_in_xy_plane),
+					ComputeChordError(radius_out, slices_in_xz_plane)));
+		}
+
 		return mesh_triangle;
 	}
 
+	//计算簇包围球和法线锥
+	static void ComputeMeshletBound(
+		const std::vector<vector3>* vertex,
+		const int* triangle,
+		const vector3* face_normal,
+		MESH_TRIANGLE_MESHLET* meshlet)
+	{
+		//包围球：球心取包围盒中心
+		vector3 box_min = vertex->at(triangle[0]);
+		vector3 box_max = box_min;
+		for (int i = 0; i < meshlet->triangle_count * 3; ++i)
+		{
+			const vector3* v = &vertex->at(triangle[i]);
+			box_min.x = std::min(box_min.x, v->x);
+			box_min.y = std::min(box_min.y, v->y);
+			box_min.z = std::min(box_min.z, v->z);
+			box_max.x = std::max(box_max.x, v->x);
+			box_max.y = std::max(box_max.y, v->y);
+			box_max.z = std::max(box_max.z, v->z);
+		}
+		meshlet->center = (box_min + box_max) * 0.5f;
+		meshlet->radius = 0.0f;
+		for (int i = 0; i < meshlet->triangle_count * 3; ++i)
+			meshlet->radius = std::max(meshlet->radius, (vertex->at(triangle[i]) - meshlet->center).Length());
+
+		//法线锥：轴为面法线之和的方向，退化三角没有法线，不参与计算
+		vector3 axis(0.0f, 0.0f, 0.0f);
+		for (int i = 0; i < meshlet->triangle_count; ++i)
+			axis += face_normal[i];
+		meshlet->cone_axis = axis;
+		meshlet->cone_cutoff = 1.0f;
+		if (axis.Length() <= 0.0f)
+			return;
+		meshlet->cone_axis = axis.Normalize();
+
+		float cos_max = 1.0f;
+		for (int i = 0; i < meshlet->triangle_count; ++i)
+		{
+			if (face_normal[i].Length() > 0.0f)
+				cos_max = std::min(cos_max, face_normal[i].Dot(meshlet->cone_axis));
+		}
+
+		//夹角不小于90度时锥拣选无效
+		if (cos_max > 0.0f)
+			meshlet->cone_cutoff = sqrt(1.0f - cos_max * cos_max);
+	}
+
+	void MeshTriangleBuildMeshlet(
+		MESH_TRIANGLE* mesh_triangle,
+		int max_triangle_count)
+	{
+		int vertex_count = (int)mesh_triangle->vertex.size();
+		int triangle_count = (int)mesh_triangle->triangle.size() / 3;
+		const int* triangle = triangle_count > 0 ? &mesh_triangle->triangle[0] : NULL;
+		mesh_triangle->meshlet.clear();
+
+		//面法线，退化三角为零向量
+		std::vector<vector3> face_normal(triangle_count);
+		for (int i = 0; i < triangle_count; ++i)
+		{
+			const vector3* v0 = &mesh_triangle->vertex[triangle[i * 3]];
+			const vector3* v1 = &mesh_triangle->vertex[triangle[i * 3 + 1]];
+			const vector3* v2 = &mesh_triangle->vertex[triangle[i * 3 + 2]];
+			vector3 normal = (*v1 - *v0).Cross(*v2 - *v0);
+			if (normal.Length() > 0.0f)
+				face_normal[i] = normal.Normalize();
+			else
+				face_normal[i].Set(0.0f, 0.0f, 0.0f);
+		}
+
+		//顶点到三角的邻接表
+		std::vector<int> adjacency_offset(vertex_count + 1, 0);
+		for (int i = 0; i < triangle_count * 3; ++i)
+			++adjacency_offset[triangle[i] + 1];
+		for (int i = 0; i < vertex_count; ++i)
+			adjacency_offset[i + 1] += adjacency_offset[i];
+		std::vector<int> adjacency(triangle_count * 3);
+		std::vector<int> adjacency_fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+		for (int i = 0; i < triangle_count * 3; ++i)
+			adjacency[adjacency_fill[triangle[i]]++] = i / 3;
+
+		//triangle_meshlet为三角所在簇，-1表示未分簇，triangle_queued为三角最后一次进入队列的簇，避免重复进入
+		std::vector<int> triangle_meshlet(triangle_count, -1);
+		std::vector<int> triangle_queued(triangle_count, -1);
+		std::vector<int> triangle_sorted;
+		std::vector<vector3> face_normal_sorted;
+		std::vector<int> queue;
+		triangle_sorted.reserve(triangle_count * 3);
+		face_normal_sorted.reserve(triangle_count);
+
+		for (int seed = 0; seed < triangle_count; ++seed)
+		{
+			if (-1 != triangle_meshlet[seed])
+				continue;
+
+			int meshlet_index = (int)mesh_triangle->meshlet.size();
+			MESH_TRIANGLE_MESHLET meshlet;
+			meshlet.triangle_begin = (int)triangle_sorted.size() / 3;
+			meshlet.triangle_count = 0;
+			vector3 axis(0.0f, 0.0f, 0.0f);
+
+			//按广度优先沿共享顶点扩展
+			queue.clear();
+			queue.push_back(seed);
+			triangle_queued[seed] = meshlet_index;
+			for (int head = 0; head < (int)queue.size() && meshlet.triangle_count < max_triangle_count; ++head)
+			{
+				int t = queue[head];
+
+				//法线偏离簇法线太多的三角留给之后的簇
+				if (axis.Length() > 0.0f && face_normal[t].Length() > 0.0f &&
+					face_normal[t].Dot(axis.Normalize()) < 0.5f)
+					continue;
+
+				triangle_meshlet[t] = meshlet_index;
+				axis += face_normal[t];
+				for (int i = 0; i < 3; ++i)
+					triangle_sorted.push_back(triangle[t * 3 + i]);
+				face_normal_sorted.push_back(face_normal[t]);
+				++meshlet.triangle_count;
+
+				for (int i = 0; i < 3; ++i)
+				{
+					int v = triangle[t * 3 + i];
+					for (int j = adjacency_offset[v]; j < adjacency_offset[v + 1]; ++j)
+					{
+						int neighbor = adjacency[j];
+						if (-1 == triangle_meshlet[neighbor] && meshlet_index != triangle_queued[neighbor])
+						{
+							triangle_queued[neighbor] = meshlet_index;
+							queue.push_back(neighbor);
+						}
+					}
+				}
+			}
+
+			ComputeMeshletBound(
+				&mesh_triangle->vertex,
+				&triangle_sorted[meshlet.triangle_begin * 3],
+				&face_normal_sorted[meshlet.triangle_begin],
+				&meshlet);
+			mesh_triangle->meshlet.push_back(meshlet);
+		}
+
+		mesh_triangle->triangle.swap(triangle_sorted);
+	}
+
+	//二次误差矩阵，对称4x4矩阵按行存储上三角10个元素
+	struct QUADRIC
+	{
+		double a[10];
+	};
+
+	static void QuadricAddPlane(QUADRIC* quadric, double a, double b, double c, double d)
+	{
+		quadric->a[0] += a * a; quadric->a[1] += a * b; quadric->a[2] += a * c; quadric->a[3] += a * d;
+		quadric->a[4] += b * b; quadric->a[5] += b * c; quadric->a[6] += b * d;
+		quadric->a[7] += c * c; quadric->a[8] += c * d;
+		quadric->a[9] += d * d;
+	}
+
+	static void QuadricAdd(QUADRIC* quadric, const QUADRIC* that)
+	{
+		for (int i = 0; i < 10; ++i)
+			quadric->a[i] += that->a[i];
+	}
+
+	//点到二次误差矩阵中所有平面的距离平方和
+	static double QuadricError(const QUADRIC* quadric, const vector3* v)
+	{
+		double x = v->x, y = v->y, z = v->z;
+		const double* a = quadric->a;
+		return
+			a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z + 2.0 * a[3] * x +
+			a[4] * y * y + 2.0 * a[5] * y * z + 2.0 * a[6] * y +
+			a[7] * z * z + 2.0 * a[8] * z +
+			a[9];
+	}
+
+	//边折叠候选：顶点from并入顶点to
+	struct EDGE_COLLAPSE
+	{
+		double cost;
+		int from;
+		int to;
+
+		bool operator < (const EDGE_COLLAPSE& that) const
+		{
+			return cost < that.cost;
+		}
+	};
+
+	//简化：每轮按代价从小到大折叠互不相邻的边，折叠只把一个端点并入另一个端点，顶点属性不需要插值，
+	//边界顶点不并入其它顶点，使三角翻转的折叠跳过，直到三角数量不大于target_triangle_count或无法折叠，
+	//error为折叠代价最大值的平方根，即近似的几何误差
+	static MESH_TRIANGLE* MeshTriangleSimplify(
+		const MESH_TRIANGLE* mesh_triangle,
+		int target_triangle_count,
+		float* error)
+	{
+		const std::vector<vector3>* vertex = &mesh_triangle->vertex;
+		int vertex_count = (int)vertex->size();
+		int triangle_count = (int)mesh_triangle->triangle.size() / 3;
+		std::vector<int> triangle = mesh_triangle->triangle;
+		std::vector<char> triangle_alive(triangle_count, 1);
+		int alive_count = triangle_count;
+
+		//顶点二次误差矩阵：顶点所在三角平面
+		QUADRIC quadric_zero = {};
+		std::vector<QUADRIC> quadric(vertex_count, quadric_zero);
+		std::vector<std::vector<int>> vertex_triangle(vertex_count);
+		for (int i = 0; i < triangle_count; ++i)
+		{
+			const vector3* v0 = &vertex->at(triangle[i * 3]);
+			vector3 normal = (vertex->at(triangle[i * 3 + 1]) - *v0).Cross(vertex->at(triangle[i * 3 + 2]) - *v0);
+			float length = normal.Length();
+			if (length > 0.0f)
+				normal = normal * (1.0f / length);
+			for (int j = 0; j < 3; ++j)
+			{
+				if (length > 0.0f)
+					QuadricAddPlane(&quadric[triangle[i * 3 + j]], normal.x, normal.y, normal.z, -normal.Dot(*v0));
+				vertex_triangle[triangle[i * 3 + j]].push_back(i);
+			}
+		}
+
+		//边界顶点：只属于一个三角的边为边界边，纹理接缝处顶点重复，也表现为边界
+		std::vector<char> locked(vertex_count, 0);
+		{
+			std::vector<long long> edge;
+			edge.reserve(triangle_count * 3);
+			for (int i = 0; i < triangle_count * 3; ++i)
+			{
+				int a = triangle[i];
+				int b = triangle[i % 3 == 2 ? i - 2 : i + 1];
+				edge.push_back((long long)std::min(a, b) * vertex_count + std::max(a, b));
+			}
+			std::sort(edge.begin(), edge.end());
+			for (int i = 0; i < (int)edge.size();)
+			{
+				int j = i + 1;
+				while (j < (int)edge.size() && edge[j] == edge[i])
+					++j;
+				if (1 == j - i)
+				{
+					locked[(int)(edge[i] / vertex_count)] = 1;
+					locked[(int)(edge[i] % vertex_count)] = 1;
+				}
+				i = j;
+			}
+		}
+
+		double max_cost = 0.0;
+		std::vector<EDGE_COLLAPSE> collapse;
+		std::vector<char> dirty(vertex_count);
+		while (alive_count > target_triangle_count)
+		{
+			//每条内部边在相邻两个三角中方向相反各出现一次，只取a<b的方向
+			collapse.clear();
+			for (int i = 0; i < triangle_count; ++i)
+			{
+				if (!triangle_alive[i])
+					continue;
+
+				for (int j = 0; j < 3; ++j)
+				{
+					int a = triangle[i * 3 + j];
+					int b = triangle[i * 3 + (j + 1) % 3];
+					if (a > b || (locked[a] && locked[b]))
+						continue;
+
+					QUADRIC sum = quadric[a];
+					QuadricAdd(&sum, &quadric[b]);
+					EDGE_COLLAPSE ab = { locked[a] ? DBL_MAX : QuadricError(&sum, &vertex->at(b)), a, b };
+					EDGE_COLLAPSE ba = { locked[b] ? DBL_MAX : QuadricError(&sum, &vertex->at(a)), b, a };
+					collapse.push_back(ab.cost <= ba.cost ? ab : ba);
+				}
+			}
+			if (collapse.empty())
+				break;
+			std::sort(collapse.begin(), collapse.end());
+
+			//折叠之后相关顶点的代价已经变化，本轮不再折叠
+			std::fill(dirty.begin(), dirty.end(), 0);
+			int collapse_count = 0;
+			for (int i = 0; i < (int)collapse.size() && alive_count > target_triangle_count; ++i)
+			{
+				int from = collapse[i].from;
+				int to = collapse[i].to;
+				if (dirty[from] || dirty[to])
+					continue;
+
+				//不包含to的三角在from移动到to之后不能翻转
+				bool flip = false;
+				for (int j = 0; j < (int)vertex_triangle[from].size() && !flip; ++j)
+				{
+					int t = vertex_triangle[from][j];
+					int* index = &triangle[t * 3];
+					if (!triangle_alive[t] || index[0] == to || index[1] == to || index[2] == to)
+						continue;
+
+					vector3 p[3] = { vertex->at(index[0]), vertex->at(index[1]), vertex->at(index[2]) };
+					vector3 normal_before = (p[1] - p[0]).Cross(p[2] - p[0]);
+					for (int k = 0; k < 3; ++k)
+					{
+						if (index[k] == from)
+							p[k] = vertex->at(to);
+					}
+					vector3 normal_after = (p[1] - p[0]).Cross(p[2] - p[0]);
+					flip = normal_after.Dot(normal_before) <= 0.0f;
+				}
+				if (flip)
+					continue;
+
+				//包含to的三角退化舍去，其余三角的from改为to
+				for (int j = 0; j < (int)vertex_triangle[from].size(); ++j)
+				{
+					int t = vertex_triangle[from][j];
+					int* index = &triangle[t * 3];
+					if (!triangle_alive[t])
+						continue;
+
+					if (index[0] == to || index[1] == to || index[2] == to)
+					{
+						triangle_alive[t] = 0;
+						--alive_count;
+						continue;
+					}
+					for (int k = 0; k < 3; ++k)
+					{
+						if (index[k] == from)
+							index[k] = to;
+					}
+					vertex_triangle[to].push_back(t);
+				}
+				vertex_triangle[from].clear();
+
+				for (int j = 0; j < (int)vertex_triangle[to].size(); ++j)
+				{
+					int t = vertex_triangle[to][j];
+					if (triangle_alive[t])
+					{
+						for (int k = 0; k < 3; ++k)
+							dirty[triangle[t * 3 + k]] = 1;
+					}
+				}
+				dirty[from] = 1;
+
+				QuadricAdd(&quadric[to], &quadric[from]);
+				max_cost = std::max(max_cost, collapse[i].cost);
+				++collapse_count;
+			}
+			if (0 == collapse_count)
+				break;
+		}
+
+		//保留三角引用的顶点，按原始顺序压缩
+		bool normal_enable = mesh_triangle->normal.size() == vertex->size();
+		bool texture_enable = mesh_triangle->texture.size() == vertex->size();
+		MESH_TRIANGLE* simplify = new MESH_TRIANGLE;
+		std::vector<int> vertex_index(vertex_count, -1);
+		for (int i = 0; i < triangle_count; ++i)
+		{
+			if (!triangle_alive[i])
+				continue;
+
+			for (int j = 0; j < 3; ++j)
+				vertex_index[triangle[i * 3 + j]] = 0;
+		}
+		int simplify_vertex_count = 0;
+		for (int i = 0; i < vertex_count; ++i)
+		{
+			if (-1 == vertex_index[i])
+				continue;
+
+			vertex_index[i] = simplify_vertex_count++;
+			simplify->vertex.push_back(vertex->at(i));
+			if (normal_enable)
+				simplify->normal.push_back(mesh_triangle->normal[i]);
+			if (texture_enable)
+				simplify->texture.push_back(mesh_triangle->texture[i]);
+		}
+		for (int i = 0; i < triangle_count; ++i)
+		{
+			if (!triangle_alive[i])
+				continue;
+
+			for (int j = 0; j < 3; ++j)
+				simplify->triangle.push_back(vertex_index[triangle[i * 3 + j]]);
+		}
+		simplify->radius = mesh_triangle->radius;
+
+		*error = (float)sqrt(std::max(max_cost, 0.0));
+		return simplify;
+	}
+
+	void MeshTriangleBuildLod(
+		MESH_TRIANGLE* mesh_triangle,
+		int level_count,
+		float ratio)
+	{
+		MeshTriangleReleaseLod(mesh_triangle);
+
+		//逐级简化上一级，误差按三角不等式累加上一级的误差
+		const MESH_TRIANGLE* source = mesh_triangle;
+		float source_error = 0.0f;
+		for (int i = 0; i < level_count; ++i)
+		{
+			int source_triangle_count = (int)source->triangle.size() / 3;
+			float error;
+			MESH_TRIANGLE* lod_mesh_triangle = MeshTriangleSimplify(
+				source, (int)(source_triangle_count * ratio), &error);
+
+			//三角数量减少不到一成时停止
+			if ((int)lod_mesh_triangle->triangle.size() / 3 > source_triangle_count * 9 / 10)
+			{
+				MeshTriangleUnload(lod_mesh_triangle);
+				break;
+			}
+
+			if (!mesh_triangle->meshlet.empty())
+				MeshTriangleBuildMeshlet(lod_mesh_triangle);
+
+			source_error += error;
+			MeshTriangleAddLod(mesh_triangle, lod_mesh_triangle, source_error);
+			source = lod_mesh_triangle;
+		}
+	}
+
 	void MeshTriangleUnload(MESH_TRIANGLE* mesh_triangle)
 	{
 		if (NULL != mesh_triangle)
+		{
+			MeshTriangleReleaseLod(mesh_triangle);
 			delete mesh_triangle;
+		}
 	}
 
 }
\ No newline at end of file
@@ -9,6 +9,31 @@
 
 namespace render {
 
+	//簇：三角索引表中连续的一段三角，包围球和法线锥用于整簇拣选
+	struct MESH_TRIANGLE_MESHLET
+	{
+		//第一个三角下标、三角数量
+		int triangle_begin;
+		int triangle_count;
+
+		//本地坐标系包围球
+		vector3 center;
+		float radius;
+
+		//法线锥：轴为单位向量，簇内三角面法线与轴的夹角都不超过a，cutoff为sin(a)，为1时不做法线锥拣选
+		vector3 cone_axis;
+		float cone_cutoff;
+	};
+
+	struct MESH_TRIANGLE;
+
+	//细节层次：简化网格和它相对原始网格的几何误差，误差为本地坐标系长度
+	struct MESH_TRIANGLE_LOD
+	{
+		MESH_TRIANGLE* mesh_triangle;
+		float error;
+	};
+
 	struct MESH_TRIANGLE
 	{
 		//顶点
@@ -25,6 +50,12 @@ namespace render {
 
 		//包围球半径
 		float radius;
+
+		//簇表，按顺序连续覆盖整个三角索引表，为空时不做簇拣选
+		std::vector<MESH_TRIANGLE_MESHLET> meshlet;
+
+		//细节层次表，逐级变粗，随网格一起释放
+		std::vector<MESH_TRIANGLE_LOD> lod;
 	};
 
 	MESH_TRIANGLE* MeshTriangleLoad(
@@ -34,15 +65,29 @@ namespace render {
 	MESH_TRIANGLE* MeshTriangleCreateCube(
 		float width, float height, float depth);
 	MESH_TRIANGLE* MeshTriangleCreateSphere(
-		float radius, int slices_in_xz_plane, int slices_in_y_axis);
+		float radius, int slices_in_xz_plane, int slices_in_y_axis, int lod_level_count = 0);
 	MESH_TRIANGLE* MeshTriangleCreateCone(
-		float radius, float height, int slices_in_xz_plane);
+		float radius, float height, int slices_in_xz_plane, int lod_level_count = 0);
 	MESH_TRIANGLE* MeshTriangleCreateCylinder(
-		float radius_top, float radius_bottom, float height, int slices_in_xz_plane);
+		float radius_top, float radius_bottom, float height, int slices_in_xz_plane, int lod_level_count = 0);
 	MESH_TRIANGLE* MeshTriangleCreatePipe(
-		float radius_top_in, float radius_top_out, float radius_bottom_in, float radius_bottom_out, float height, int slices_in_xz_plane);
+		float radius_top_in, float radius_top_out, float radius_bottom_in, float radius_bottom_out, float height, int slices_in_xz_plane, int lod_level_count = 0);
 	MESH_TRIANGLE* MeshTriangleCreateTorus(
-		float radius_in, float radius_out, int slices_in_xy_plane, int slices_in_xz_plane);
+		float radius_in, float radius_out, int slices_in_xy_plane, int slices_in_xz_plane, int lod_level_count = 0);
+
+	//生成簇：从未分簇的三角开始沿共享顶点扩展，面法线与簇法线夹角超过60度的三角留给之后的簇，
+	//每簇不超过max_triangle_count个三角，三角索引表按簇重新排列
+	void MeshTriangleBuildMeshlet(
+		MESH_TRIANGLE* mesh_triangle,
+		int max_triangle_count = 64);
+
+	//生成细节层次：二次误差边折叠，每级三角数量约为上一级的ratio倍，边界顶点保持不动，
+	//三角数量减少不到一成时提前停止，原始网格有簇时各级也生成簇，
+	//生成器的lod_level_count参数按切片数逐级减半直接生成细节层次
+	void MeshTriangleBuildLod(
+		MESH_TRIANGLE* mesh_triangle,
+		int level_count = 4,
+		float ratio = 0.5f);
 
 	void MeshTriangleUnload(MESH_TRIANGLE* mesh_triangle);
 }
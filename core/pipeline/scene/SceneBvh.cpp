@@ -0,0 +1,331 @@
+#include "SceneBvh.h"
+
+namespace render {
+
+	//包围两个球的最小球
+	static void SphereMerge(
+		const vector3* center1, float radius1,
+		const vector3* center2, float radius2,
+		vector3* center, float* radius)
+	{
+		vector3 offset = *center2 - *center1;
+		float distance = offset.Length();
+
+		//球1包含球2
+		if (distance + radius2 <= radius1)
+		{
+			*center = *center1;
+			*radius = radius1;
+			return;
+		}
+
+		//球2包含球1
+		if (distance + radius1 <= radius2)
+		{
+			*center = *center2;
+			*radius = radius2;
+			return;
+		}
+
+		//新球直径为两球最远点距离，球心在两球心连线上
+		float r = (distance + radius1 + radius2) * 0.5f;
+		*center = *center1 + offset * ((r - radius1) / distance);
+		*radius = r;
+	}
+
+	//球1是否包含球2
+	static bool SphereContain(
+		const vector3* center1, float radius1,
+		const vector3* center2, float radius2)
+	{
+		return (*center2 - *center1).Length() + radius2 <= radius1;
+	}
+
+	static int SceneBvhAllocateNode(SCENE_BVH* scene_bvh)
+	{
+		int node_index = scene_bvh->free_node;
+		if (-1 != node_index)
+			scene_bvh->free_node = scene_bvh->node[node_index].parent;
+		else
+		{
+			node_index = (int)scene_bvh->node.size();
+			scene_bvh->node.push_back(SCENE_BVH_NODE());
+		}
+
+		SCENE_BVH_NODE* node = &scene_bvh->node[node_index];
+		node->radius = 0.0f;
+		node->parent = -1;
+		node->child[0] = -1;
+		node->child[1] = -1;
+		node->user_data = -1;
+
+		return node_index;
+	}
+
+	static void SceneBvhFreeNode(SCENE_BVH* scene_bvh, int node_index)
+	{
+		scene_bvh->node[node_index].parent = scene_bvh->free_node;
+		scene_bvh->node[node_index].child[0] = -1;
+		scene_bvh->node[node_index].child[1] = -1;
+		scene_bvh->node[node_index].user_data = -1;
+		scene_bvh->free_node = node_index;
+	}
+
+	//从node_index开始向上修正祖先节点包围球，stop_if_contain为真时父节点已包含子节点就停止
+	static void SceneBvhRefit(SCENE_BVH* scene_bvh, int node_index, bool stop_if_contain)
+	{
+		while (-1 != node_index)
+		{
+			SCENE_BVH_NODE* node = &scene_bvh->node[node_index];
+			const SCENE_BVH_NODE* child0 = &scene_bvh->node[node->child[0]];
+			const SCENE_BVH_NODE* child1 = &scene_bvh->node[node->child[1]];
+
+			if (stop_if_contain &&
+				SphereContain(&node->center, node->radius, &child0->center, child0->radius) &&
+				SphereContain(&node->center, node->radius, &child1->center, child1->radius))
+				return;
+
+			SphereMerge(
+				&child0->center, child0->radius,
+				&child1->center, child1->radius,
+				&node->center, &node->radius);
+
+			node_index = node->parent;
+		}
+	}
+
+	static void SceneBvhInsertLeaf(SCENE_BVH* scene_bvh, int leaf)
+	{
+		if (-1 == scene_bvh->root)
+		{
+			scene_bvh->root = leaf;
+			scene_bvh->node[leaf].parent = -1;
+			return;
+		}
+
+		//自根向下寻找兄弟节点，代价为包围球半径增量
+		vector3 leaf_center = scene_bvh->node[leaf].center;
+		float leaf_radius = scene_bvh->node[leaf].radius;
+		int sibling = scene_bvh->root;
+		while (-1 != scene_bvh->node[sibling].child[0])
+		{
+			const SCENE_BVH_NODE* node = &scene_bvh->node[sibling];
+
+			//与当前节点合并的代价
+			vector3 merge_center;
+			float merge_radius;
+			SphereMerge(&node->center, node->radius, &leaf_center, leaf_radius, &merge_center, &merge_radius);
+			float cost = merge_radius;
+
+			//继续向下时祖先节点增大的代价
+			float inheritance_cost = merge_radius - node->radius;
+
+			//下降到子节点的代价
+			float child_cost[2];
+			for (int i = 0; i < 2; ++i)
+			{
+				const SCENE_BVH_NODE* child = &scene_bvh->node[node->child[i]];
+				SphereMerge(&child->center, child->radius, &leaf_center, leaf_radius, &merge_center, &merge_radius);
+				if (-1 == child->child[0])
+					child_cost[i] = merge_radius + inheritance_cost;
+				else
+					child_cost[i] = merge_radius - child->radius + inheritance_cost;
+			}
+
+			if (cost < child_cost[0] && cost < child_cost[1])
+				break;
+
+			sibling = child_cost[0] < child_cost[1] ? node->child[0] : node->child[1];
+		}
+
+		//创建新父节点，注意分配节点可能使节点表重新分配
+		int old_parent = scene_bvh->node[sibling].parent;
+		int new_parent = SceneBvhAllocateNode(scene_bvh);
+		SCENE_BVH_NODE* node_new_parent = &scene_bvh->node[new_parent];
+		node_new_parent->parent = old_parent;
+		node_new_parent->child[0] = sibling;
+		node_new_parent->child[1] = leaf;
+		SphereMerge(
+			&scene_bvh->node[sibling].center, scene_bvh->node[sibling].radius,
+			&leaf_center, leaf_radius,
+			&node_new_parent->center, &node_new_parent->radius);
+
+		if (-1 != old_parent)
+		{
+			SCENE_BVH_NODE* node_old_parent = &scene_bvh->node[old_parent];
+			if (node_old_parent->child[0] == sibling)
+				node_old_parent->child[0] = new_parent;
+			else
+				node_old_parent->child[1] = new_parent;
+		}
+		else
+			scene_bvh->root = new_parent;
+
+		scene_bvh->node[sibling].parent = new_parent;
+		scene_bvh->node[leaf].parent = new_parent;
+
+		//修正祖先节点
+		SceneBvhRefit(scene_bvh, old_parent, true);
+	}
+
+	static void SceneBvhRemoveLeaf(SCENE_BVH* scene_bvh, int leaf)
+	{
+		if (leaf == scene_bvh->root)
+		{
+			scene_bvh->root = -1;
+			return;
+		}
+
+		//用兄弟节点替代父节点
+		int parent = scene_bvh->node[leaf].parent;
+		int grand_parent = scene_bvh->node[parent].parent;
+		int sibling =
+			scene_bvh->node[parent].child[0] == leaf ?
+			scene_bvh->node[parent].child[1] :
+			scene_bvh->node[parent].child[0];
+
+		if (-1 != grand_parent)
+		{
+			SCENE_BVH_NODE* node_grand_parent = &scene_bvh->node[grand_parent];
+			if (node_grand_parent->child[0] == parent)
+				node_grand_parent->child[0] = sibling;
+			else
+				node_grand_parent->child[1] = sibling;
+			scene_bvh->node[sibling].parent = grand_parent;
+			SceneBvhFreeNode(scene_bvh, parent);
+
+			//祖先节点包围球收缩
+			SceneBvhRefit(scene_bvh, grand_parent, false);
+		}
+		else
+		{
+			scene_bvh->root = sibling;
+			scene_bvh->node[sibling].parent = -1;
+			SceneBvhFreeNode(scene_bvh, parent);
+		}
+	}
+
+	SCENE_BVH* SceneBvhCreate(float margin)
+	{
+		SCENE_BVH* scene_bvh = new SCENE_BVH;
+		scene_bvh->root = -1;
+		scene_bvh->free_node = -1;
+		scene_bvh->margin = margin;
+		return scene_bvh;
+	}
+
+	int SceneBvhInsert(
+		SCENE_BVH* scene_bvh,
+		const vector3* center,
+		float radius,
+		int user_data)
+	{
+		int leaf = SceneBvhAllocateNode(scene_bvh);
+		scene_bvh->node[leaf].center = *center;
+		scene_bvh->node[leaf].radius = radius + scene_bvh->margin;
+		scene_bvh->node[leaf].user_data = user_data;
+
+		SceneBvhInsertLeaf(scene_bvh, leaf);
+
+		return leaf;
+	}
+
+	bool SceneBvhUpdate(
+		SCENE_BVH* scene_bvh,
+		int proxy,
+		const vector3* center,
+		float radius)
+	{
+		SCENE_BVH_NODE* node = &scene_bvh->node[proxy];
+
+		//仍在扩大后的包围球内
+		if (SphereContain(&node->center, node->radius, center, radius))
+			return false;
+
+		//移出叶节点，更新包围球后重新插入，叶节点下标即代理不变
+		SceneBvhRemoveLeaf(scene_bvh, proxy);
+		node->center = *center;
+		node->radius = radius + scene_bvh->margin;
+		SceneBvhInsertLeaf(scene_bvh, proxy);
+
+		return true;
+	}
+
+	void SceneBvhRemove(
+		SCENE_BVH* scene_bvh,
+		int proxy)
+	{
+		SceneBvhRemoveLeaf(scene_bvh, proxy);
+		SceneBvhFreeNode(scene_bvh, proxy);
+	}
+
+	void SceneBvhQuery(
+		SCENE_BVH* scene_bvh,
+		const float (*plane)[4],
+		int plane_count,
+		std::vector<int>* user_data_visible)
+	{
+		if (-1 == scene_bvh->root)
+			return;
+
+		//栈中存放节点下标和仍需测试的截面掩码，父节点完全位于某截面内侧时子节点无需再测该截面
+		std::vector<int>* stack = &scene_bvh->stack;
+		stack->clear();
+		stack->push_back(scene_bvh->root);
+		stack->push_back((1 << plane_count) - 1);
+
+		while (!stack->empty())
+		{
+			int plane_mask = stack->back();
+			stack->pop_back();
+			int node_index = stack->back();
+			stack->pop_back();
+
+			const SCENE_BVH_NODE* node = &scene_bvh->node[node_index];
+
+			//截面测试
+			bool outside = false;
+			for (int i = 0; i < plane_count; ++i)
+			{
+				if (0 == (plane_mask & (1 << i)))
+					continue;
+
+				float distance =
+					plane[i][0] * node->center.x +
+					plane[i][1] * node->center.y +
+					plane[i][2] * node->center.z +
+					plane[i][3];
+
+				//完全在外侧
+				if (distance < -node->radius)
+				{
+					outside = true;
+					break;
+				}
+
+				//完全在内侧
+				if (distance >= node->radius)
+					plane_mask &= ~(1 << i);
+			}
+			if (outside)
+				continue;
+
+			if (-1 == node->child[0])
+				user_data_visible->push_back(node->user_data);
+			else
+			{
+				stack->push_back(node->child[0]);
+				stack->push_back(plane_mask);
+				stack->push_back(node->child[1]);
+				stack->push_back(plane_mask);
+			}
+		}
+	}
+
+	void SceneBvhRelease(SCENE_BVH* scene_bvh)
+	{
+		if (NULL != scene_bvh)
+			delete scene_bvh;
+	}
+
+}
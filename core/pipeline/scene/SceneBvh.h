@@ -0,0 +1,79 @@
+#ifndef _SCENE_BVH_H_
+#define _SCENE_BVH_H_
+
+#include "CommonMacro.h"
+#include "vector3.h"
+#include <vector>
+
+namespace render {
+
+	struct SCENE_BVH_NODE
+	{
+		//包围球，叶节点的包围球在物体包围球的基础上扩大了边距
+		vector3 center;
+		float radius;
+
+		//父节点，根节点为-1，空闲节点表示下一个空闲节点
+		int parent;
+
+		//子节点，叶节点为-1
+		int child[2];
+
+		//叶节点对应的用户数据，内部节点为-1
+		int user_data;
+	};
+
+	struct SCENE_BVH
+	{
+		//节点表
+		std::vector<SCENE_BVH_NODE> node;
+
+		//根节点，空树为-1
+		int root;
+
+		//空闲节点链表头，无空闲节点为-1
+		int free_node;
+
+		//叶节点包围球扩大边距，物体在边距内移动无需更新树
+		float margin;
+
+		//查询遍历栈
+		std::vector<int> stack;
+	};
+
+	//创建场景包围体层次树
+	SCENE_BVH* SceneBvhCreate(float margin = 0.0f);
+
+	//插入世界坐标系包围球，返回代理下标，用于更新和删除
+	int SceneBvhInsert(
+		SCENE_BVH* scene_bvh,
+		const vector3* center,
+		float radius,
+		int user_data);
+
+	//更新代理的包围球，仍在叶节点扩大后的包围球内不做任何事情并返回false，
+	//否则把叶节点移出后按新包围球重新插入并返回true，代理下标不变
+	bool SceneBvhUpdate(
+		SCENE_BVH* scene_bvh,
+		int proxy,
+		const vector3* center,
+		float radius);
+
+	//删除代理
+	void SceneBvhRemove(
+		SCENE_BVH* scene_bvh,
+		int proxy);
+
+	//视锥体查询，plane为世界坐标系下截面(a,b,c,d)，ax+by+cz+d>=0为内侧，(a,b,c)为单位向量，
+	//与视锥体相交的叶节点用户数据放入user_data_visible（不清空原有内容）
+	void SceneBvhQuery(
+		SCENE_BVH* scene_bvh,
+		const float (*plane)[4],
+		int plane_count,
+		std::vector<int>* user_data_visible);
+
+	//释放场景包围体层次树
+	void SceneBvhRelease(SCENE_BVH* scene_bvh);
+}
+
+#endif
@@ -62,6 +62,14 @@ void MyApplication::OnInit()
 	//ms4 = MeshTriangleCreateCylinder(20, 15, 60, 13);
 	//ms4 = MeshTriangleCreatePipe(15, 20, 30, 40, 30, 6);
 	//ms4 = MeshTriangleCreateTorus(45, 90, 32, 32);
+	render::MeshTriangleBuildMeshlet(ms4);
+	render::MeshTriangleBuildLod(ms4);
+
+	//场景包围体层次树：老虎每次移动2.5，边距取其两倍，小幅移动无需更新树
+	bvh = render::SceneBvhCreate(5.0f);
+	render::vector3 pos0;
+	bvh_proxy_ms1 = render::SceneBvhInsert(bvh, &pos0, ms1->radius, 1);
+	bvh_proxy_ms4 = render::SceneBvhInsert(bvh, &pos, ms4->radius, 4);
 
 	//设置近远截面
 	r.SetCoordinateCameraPlane(2.0, 1000.0);
@@ -79,6 +87,9 @@ void MyApplication::OnInit()
 	render::ComputeTransformView(&tv, view_x, view_y, view_w, view_h);
 	r.SetTransform(_COORDINATE_VIEW, &tv);
 
+	//动态分辨率：每帧目标用时16毫秒，内部分辨率最低为一半
+	r.SetDynamicResolution(true, 16.0f, 0.5f);
+
 	//设置渲染状态
 	r.EnableRenderState(_RENDER_STATE_DEPTH_TEST, 1);
 	r.EnableRenderState(_RENDER_STATE_ALPHA_BLEND, 1);
@@ -138,7 +149,9 @@ bool MyApplication::OnUpdateLogic()
 	int bh = 0;
 	r.GetBufferSize(&bw, &bh);
 
+	r.BeginFrame();
 	r.FillBuffer(true, _COLOR_BLACK, true);
+	r.ClearRasterizeStatistics();
 
 	//r.Draw2DTexture(t1, 0, 0, 800, 600, 0, 0);
 
@@ -147,15 +160,31 @@ bool MyApplication::OnUpdateLogic()
 	ComputeTransformCamera(&tc, &eye, &at, &up);
 	r.SetTransform(_COORDINATE_CAMERA, &tc);
 
+	//场景包围体层次树：老虎绕自身原点旋转，包围球球心即其位置，按视锥体查询可见模型
+	render::SceneBvhUpdate(bvh, bvh_proxy_ms4, &pos, ms4->radius);
+	float frustum_plane[6][4];
+	r.GetCoordinateCameraFrustumPlaneInWorld(frustum_plane);
+	bvh_visible.clear();
+	render::SceneBvhQuery(bvh, frustum_plane, 6, &bvh_visible);
+	bool visible[5] = { false };
+	for (int i = 0; i < (int)bvh_visible.size(); ++i)
+		visible[bvh_visible[i]] = true;
+
+	//场景提交队列，阿尔法混合的模型由远到近绘制
+	r.BeginScene();
+
 	r.EnableRenderState(_RENDER_STATE_ILLUMINATION_COMPUTE, 1);
 	r.EnableRenderState(_RENDER_STATE_TEXTURE_SAMPLE, 0);
 
 	//1
-	render::vector3 pos0;
-	render::matrix4 tw1;
-	tw1.Translate(pos0);
-	r.SetTransform(_COORDINATE_WORLD, &tw1);
-	r.Draw3DMeshTriangle(ms1, &eye);
+	if (visible[1])
+	{
+		render::vector3 pos0;
+		render::matrix4 tw1;
+		tw1.Translate(pos0);
+		r.SetTransform(_COORDINATE_WORLD, &tw1);
+		r.Draw3DMeshTriangle(ms1, &eye);
+	}
 
 	//2
 	//render::matrix4 tw2;
@@ -174,12 +203,17 @@ bool MyApplication::OnUpdateLogic()
 	r.EnableRenderState(_RENDER_STATE_TEXTURE_SAMPLE, 1);
 	static float a = 0.0f;
 	tw2.RotateY(a += 0.01f);
-	render::matrix4 tw3;
-	tw3.Translate(pos);
-	render::matrix4 tw4;
-	Mat4MulMat4(&tw2, &tw3, &tw4);
-	r.SetTransform(_COORDINATE_WORLD, &tw4);
-	r.Draw3DMeshTriangle(ms4, &eye);
+	if (visible[4])
+	{
+		render::matrix4 tw3;
+		tw3.Translate(pos);
+		render::matrix4 tw4;
+		Mat4MulMat4(&tw2, &tw3, &tw4);
+		r.SetTransform(_COORDINATE_WORLD, &tw4);
+		r.Draw3DMeshTriangle(ms4, &eye);
+	}
+
+	r.EndScene();
 
 	//infomation
 	char buf[1024];
@@ -195,16 +229,31 @@ bool MyApplication::OnUpdateLogic()
 	r.Draw2DAsciiString(f1, 256, 1, 0, 128, "T,G,F,H -> move dot light");
 	sprintf(buf, "dot_light_pos : (x=%.2f,y=%.2f,z=%.2f)", dot_light->position.x, dot_light->position.y, dot_light->position.z);
 	r.Draw2DAsciiString(f1, 256, 1, 0, 160, buf);
+
+	const render::RASTERIZE_STATISTICS* rs = r.GetRasterizeStatistics();
+	sprintf(buf, "triangle : (span=%d,point=%d,reject=%d)", rs->triangle_span, rs->triangle_point_sample, rs->triangle_reject);
+	r.Draw2DAsciiString(f1, 256, 1, 0, 192, buf);
+
+	int rw = 0;
+	int rh = 0;
+	float scale = r.GetDynamicResolutionScale(&rw, &rh);
+	sprintf(buf, "dynamic_resolution : (scale=%.2f,w=%d,h=%d)", scale, rw, rh);
+	r.Draw2DAsciiString(f1, 256, 1, 0, 224, buf);
+
+	sprintf(buf, "scene_bvh : (visible=%d,total=2)", (int)bvh_visible.size());
+	r.Draw2DAsciiString(f1, 256, 1, 0, 256, buf);
 	
 	return true;
 }
 
 void MyApplication::OnUpdateRender(window_based_on_qt5::IRender* render)
 {
-	//返回绘制结果
+	//返回绘制结果，行间距按对齐向上取整，不一定等于宽度
 	const int* video_buffer = r.GetVideoBuffer();
+	int buffer_pitch = 0;
+	r.GetBufferSize(NULL, NULL, &buffer_pitch);
 
-	render->DrawARGB(0, 0, video_buffer, _PIXEL_WIDTH, _PIXEL_HEIGHT);
+	render->DrawARGB(0, 0, video_buffer, _PIXEL_WIDTH, _PIXEL_HEIGHT, buffer_pitch);
 }
 
 void MyApplication::OnInput(int type, const int* param)
@@ -248,6 +297,7 @@ void MyApplication::OnInput(int type, const int* param)
 
 void MyApplication::OnEnd()
 {
+	render::SceneBvhRelease(bvh);
 	if (ms4)
 		MeshTriangleUnload(ms4);
 	// if (ms3)
@@ -7,8 +7,10 @@
 #include "AsciiFont.h"
 #include "MeshSegment.h"
 #include "MeshTriangle.h"
+#include "SceneBvh.h"
 
 #include <string>
+#include <vector>
 
 class IRender;
 
@@ -34,6 +36,12 @@ class MyApplication : public window_based_on_qt5::IUserApp
 	int view_x, view_y, view_w, view_h;
 	render::LIGHT* dot_light;
 
+	//场景包围体层次树：每个模型一个代理，用户数据为模型编号
+	render::SCENE_BVH* bvh;
+	int bvh_proxy_ms1;
+	int bvh_proxy_ms4;
+	std::vector<int> bvh_visible;
+
 public:
 	virtual const char* getTitle() override;
 	virtual int getPixelWidth() override;
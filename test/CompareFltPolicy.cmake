@@ -0,0 +1,19 @@
+#浮点数判断策略：依次运行各策略的测试程序，示例场景图像写入OUTPUT_DIR，与FIXED策略的图像逐字节比较
+#cmake -DFIXED_PROGRAM=... -DEXACT_PROGRAM=... -DULP_PROGRAM=... -DOUTPUT_DIR=... -P CompareFltPolicy.cmake
+foreach (policy FIXED EXACT ULP)
+	execute_process(
+		COMMAND ${${policy}_PROGRAM} ${OUTPUT_DIR}/flt_policy_${policy}.raw
+		RESULT_VARIABLE result)
+	if (NOT result EQUAL 0)
+		message(FATAL_ERROR "${policy}: ${${policy}_PROGRAM} failed")
+	endif ()
+endforeach ()
+
+foreach (policy EXACT ULP)
+	execute_process(
+		COMMAND ${CMAKE_COMMAND} -E compare_files ${OUTPUT_DIR}/flt_policy_FIXED.raw ${OUTPUT_DIR}/flt_policy_${policy}.raw
+		RESULT_VARIABLE result)
+	if (NOT result EQUAL 0)
+		message(FATAL_ERROR "${policy}: image differs from FIXED")
+	endif ()
+endforeach ()
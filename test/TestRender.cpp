@@ -0,0 +1,582 @@
+#include "Render.h"
+#include "SceneBvh.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+//簇拣选与近截面：网格由两块不相连的平面组成，A在摄像机前方，B在摄像机平面上、视锥体之外，
+//网格包围球跨过近截面，B的簇被整簇舍去，A不需要裁剪，B的顶点不能进入投影变换和视口变换，
+//结果必须与只有A的网格相同，使用-fsanitize=float-divide-by-zero,float-cast-overflow时不能有报告
+static render::MESH_TRIANGLE* CreateMeshletNearPlaneMesh(bool with_behind)
+{
+	render::MESH_TRIANGLE* mesh_triangle = new render::MESH_TRIANGLE;
+
+	//n * n个格子的平面，法线朝向摄像机
+	const int n = 6;
+	const float patch[2][4] =
+	{
+		{ -20.0f, -20.0f, 100.0f, 40.0f },
+		{ 300.0f, -10.0f, 0.0f, 20.0f },
+	};
+	int patch_count = with_behind ? 2 : 1;
+	for (int p = 0; p < patch_count; ++p)
+	{
+		int base = (int)mesh_triangle->vertex.size();
+		for (int j = 0; j <= n; ++j)
+		{
+			for (int i = 0; i <= n; ++i)
+			{
+				mesh_triangle->vertex.push_back(render::vector3(
+					patch[p][0] + patch[p][3] * i / n,
+					patch[p][1] + patch[p][3] * j / n,
+					patch[p][2]));
+				mesh_triangle->normal.push_back(render::vector3(0.0f, 0.0f, -1.0f));
+				mesh_triangle->texture.push_back(render::vector2(0.0f, 0.0f));
+			}
+		}
+		for (int j = 0; j < n; ++j)
+		{
+			for (int i = 0; i < n; ++i)
+			{
+				int a = base + j * (n + 1) + i;
+				int index[6] = { a, a + n + 1, a + 1, a + 1, a + n + 1, a + n + 2 };
+				mesh_triangle->triangle.insert(mesh_triangle->triangle.end(), index, index + 6);
+			}
+		}
+	}
+
+	mesh_triangle->radius = render::ComputeLocalShpereRadius(&mesh_triangle->vertex);
+	render::MeshTriangleBuildMeshlet(mesh_triangle);
+	return mesh_triangle;
+}
+
+static bool TestMeshletCullingNearPlane()
+{
+	render::vector3 eye(0.0f, 0.0f, 0.0f);
+	render::vector3 at(0.0f, 0.0f, 1.0f);
+	render::vector3 up(0.0f, 1.0f, 0.0f);
+
+	for (int lazy_fill_buffer = 0; lazy_fill_buffer < 2; ++lazy_fill_buffer)
+	{
+		std::vector<int> image[2];
+		for (int with_behind = 0; with_behind < 2; ++with_behind)
+		{
+			render::Render r;
+			r.Init(320, 240, 2.0f, 1000.0f, 0.5f, _COLOR_LIME, &eye, &at, &up);
+			r.SetLazyFillBuffer(0 != lazy_fill_buffer);
+			r.EnableRenderState(_RENDER_STATE_DEPTH_TEST, 1);
+			r.EnableRenderState(_RENDER_STATE_TEXTURE_SAMPLE, 1);
+			r.FillBuffer(true, _COLOR_BLACK, true);
+
+			render::MESH_TRIANGLE* mesh_triangle = CreateMeshletNearPlaneMesh(0 != with_behind);
+			render::matrix4 transform_world;
+			r.SetTransform(_COORDINATE_WORLD, &transform_world);
+			r.Draw3DMeshTriangle(mesh_triangle, &eye);
+
+			int buffer_width = 0;
+			int buffer_height = 0;
+			int buffer_pitch = 0;
+			r.GetBufferSize(&buffer_width, &buffer_height, &buffer_pitch);
+			const int* video_buffer = r.GetVideoBuffer();
+			for (int y = 0; y < buffer_height; ++y)
+				image[with_behind].insert(
+					image[with_behind].end(),
+					video_buffer + y * buffer_pitch,
+					video_buffer + y * buffer_pitch + buffer_width);
+
+			render::MeshTriangleUnload(mesh_triangle);
+			r.End();
+		}
+
+		if (image[0] != image[1])
+		{
+			printf("TestMeshletCullingNearPlane: lazy_fill_buffer=%d image differs\n", lazy_fill_buffer);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//场景包围体层次树：检查父子链接、内部节点包围球包含子节点，返回叶节点数，结构错误返回-1
+static int CheckSceneBvh(const render::SCENE_BVH* scene_bvh)
+{
+	if (-1 == scene_bvh->root)
+		return 0;
+	if (-1 != scene_bvh->node[scene_bvh->root].parent)
+		return -1;
+
+	int leaf_count = 0;
+	std::vector<int> stack(1, scene_bvh->root);
+	while (!stack.empty())
+	{
+		int node_index = stack.back();
+		stack.pop_back();
+		const render::SCENE_BVH_NODE* node = &scene_bvh->node[node_index];
+
+		if (-1 == node->child[0])
+		{
+			++leaf_count;
+			continue;
+		}
+
+		for (int i = 0; i < 2; ++i)
+		{
+			const render::SCENE_BVH_NODE* child = &scene_bvh->node[node->child[i]];
+			if (child->parent != node_index)
+				return -1;
+			//球心计算有舍入误差，按半径的千分之一放宽
+			if ((child->center - node->center).Length() + child->radius > node->radius * 1.001f)
+				return -1;
+			stack.push_back(node->child[i]);
+		}
+	}
+	return leaf_count;
+}
+
+//场景包围体层次树：与逐个包围球测试截面的结果比较，center、radius为各代理的球心和叶节点半径，已删除的半径为负
+static bool CheckSceneBvhQuery(
+	render::SCENE_BVH* scene_bvh,
+	const float (*plane)[4],
+	const std::vector<render::vector3>& center,
+	const std::vector<float>& radius)
+{
+	std::vector<int> visible;
+	render::SceneBvhQuery(scene_bvh, plane, 6, &visible);
+	std::sort(visible.begin(), visible.end());
+
+	std::vector<int> expect;
+	for (int i = 0; i < (int)center.size(); ++i)
+	{
+		if (radius[i] < 0.0f)
+			continue;
+		bool outside = false;
+		for (int j = 0; j < 6; ++j)
+		{
+			float distance =
+				plane[j][0] * center[i].x +
+				plane[j][1] * center[i].y +
+				plane[j][2] * center[i].z +
+				plane[j][3];
+			if (distance < -radius[i])
+				outside = true;
+		}
+		if (!outside)
+			expect.push_back(i);
+	}
+
+	return visible == expect;
+}
+
+//场景包围体层次树：插入、更新、删除后结构正确，查询结果与逐个测试相同，
+//移出边距的代理重新插入到新位置附近，而不是留在原位置把祖先节点包围球撑大
+static bool TestSceneBvh()
+{
+	const float margin = 2.0f;
+	render::SCENE_BVH* scene_bvh = render::SceneBvhCreate(margin);
+
+	//两团相距很远的球，每团8 * 8个，用户数据为下标
+	std::vector<render::vector3> center;
+	std::vector<float> radius;
+	std::vector<int> proxy;
+	for (int k = 0; k < 2; ++k)
+	{
+		for (int j = 0; j < 8; ++j)
+		{
+			for (int i = 0; i < 8; ++i)
+			{
+				center.push_back(render::vector3(k * 1000.0f + i * 10.0f, 0.0f, j * 10.0f));
+				radius.push_back(3.0f + margin);
+				proxy.push_back(render::SceneBvhInsert(scene_bvh, &center.back(), 3.0f, (int)proxy.size()));
+			}
+		}
+	}
+	if (CheckSceneBvh(scene_bvh) != (int)proxy.size())
+	{
+		printf("TestSceneBvh: insert broke the tree\n");
+		return false;
+	}
+
+	//长方体区域x∈[-5,44]、y∈[-5,5]、z∈[-5,1100]，只包含第一团的一部分
+	const float plane[6][4] =
+	{
+		{ 1.0f, 0.0f, 0.0f, 5.0f },
+		{ -1.0f, 0.0f, 0.0f, 44.0f },
+		{ 0.0f, 1.0f, 0.0f, 5.0f },
+		{ 0.0f, -1.0f, 0.0f, 5.0f },
+		{ 0.0f, 0.0f, 1.0f, 5.0f },
+		{ 0.0f, 0.0f, -1.0f, 1100.0f },
+	};
+	if (!CheckSceneBvhQuery(scene_bvh, plane, center, radius))
+	{
+		printf("TestSceneBvh: query after insert differs\n");
+		return false;
+	}
+
+	//边距内移动不更新树
+	render::vector3 move_small = center[0] + render::vector3(1.0f, 0.0f, 0.0f);
+	if (render::SceneBvhUpdate(scene_bvh, proxy[0], &move_small, 3.0f))
+	{
+		printf("TestSceneBvh: update inside the margin changed the tree\n");
+		return false;
+	}
+
+	//第一团的一个球移到第二团中间
+	int moved = 9;
+	center[moved] = render::vector3(1035.0f, 0.0f, 35.0f);
+	if (!render::SceneBvhUpdate(scene_bvh, proxy[moved], &center[moved], 3.0f))
+	{
+		printf("TestSceneBvh: update outside the margin did not change the tree\n");
+		return false;
+	}
+	if (CheckSceneBvh(scene_bvh) != (int)proxy.size())
+	{
+		printf("TestSceneBvh: update broke the tree\n");
+		return false;
+	}
+	int parent = scene_bvh->node[proxy[moved]].parent;
+	if (100.0f < scene_bvh->node[parent].radius)
+	{
+		printf("TestSceneBvh: moved proxy was not reinserted, parent radius %f\n", scene_bvh->node[parent].radius);
+		return false;
+	}
+	if (!CheckSceneBvhQuery(scene_bvh, plane, center, radius))
+	{
+		printf("TestSceneBvh: query after update differs\n");
+		return false;
+	}
+
+	//删除一半，再插入同样多，空闲节点复用，节点表不增长
+	for (int i = 0; i < (int)proxy.size(); i += 2)
+	{
+		render::SceneBvhRemove(scene_bvh, proxy[i]);
+		radius[i] = -1.0f;
+	}
+	if (CheckSceneBvh(scene_bvh) != (int)proxy.size() / 2)
+	{
+		printf("TestSceneBvh: remove broke the tree\n");
+		return false;
+	}
+	if (!CheckSceneBvhQuery(scene_bvh, plane, center, radius))
+	{
+		printf("TestSceneBvh: query after remove differs\n");
+		return false;
+	}
+	size_t node_count = scene_bvh->node.size();
+	for (int i = 0; i < (int)proxy.size(); i += 2)
+	{
+		radius[i] = 3.0f + margin;
+		proxy[i] = render::SceneBvhInsert(scene_bvh, &center[i], 3.0f, i);
+	}
+	if (scene_bvh->node.size() != node_count || CheckSceneBvh(scene_bvh) != (int)proxy.size())
+	{
+		printf("TestSceneBvh: reinsert after remove broke the tree\n");
+		return false;
+	}
+	if (!CheckSceneBvhQuery(scene_bvh, plane, center, radius))
+	{
+		printf("TestSceneBvh: query after reinsert differs\n");
+		return false;
+	}
+
+	//全部删除后为空树
+	for (int i = 0; i < (int)proxy.size(); ++i)
+		render::SceneBvhRemove(scene_bvh, proxy[i]);
+	std::vector<int> visible;
+	render::SceneBvhQuery(scene_bvh, plane, 6, &visible);
+	if (-1 != scene_bvh->root || !visible.empty())
+	{
+		printf("TestSceneBvh: tree not empty after removing every proxy\n");
+		return false;
+	}
+
+	render::SceneBvhRelease(scene_bvh);
+	return true;
+}
+
+//细节层次：n * n个格子的平面，中间一列顶点左右两半各有一份，纹理坐标不同，即纹理接缝，
+//平面沿x方向弯曲，简化有误差
+static render::MESH_TRIANGLE* CreateLodSeamMesh()
+{
+	render::MESH_TRIANGLE* mesh_triangle = new render::MESH_TRIANGLE;
+
+	const int n = 16;
+	for (int half = 0; half < 2; ++half)
+	{
+		int base = (int)mesh_triangle->vertex.size();
+		for (int j = 0; j <= n; ++j)
+		{
+			for (int i = half * n / 2; i <= (half + 1) * n / 2; ++i)
+			{
+				float x = i * 10.0f - n * 5.0f;
+				mesh_triangle->vertex.push_back(render::vector3(x, j * 10.0f - n * 5.0f, x * x * 0.002f));
+				mesh_triangle->normal.push_back(render::vector3(0.0f, 0.0f, -1.0f));
+				mesh_triangle->texture.push_back(render::vector2((float)half, (float)j / n));
+			}
+		}
+		int row = n / 2 + 1;
+		for (int j = 0; j < n; ++j)
+		{
+			for (int i = 0; i < n / 2; ++i)
+			{
+				int a = base + j * row + i;
+				int index[6] = { a, a + row, a + 1, a + 1, a + row, a + row + 1 };
+				mesh_triangle->triangle.insert(mesh_triangle->triangle.end(), index, index + 6);
+			}
+		}
+	}
+
+	mesh_triangle->radius = render::ComputeLocalShpereRadius(&mesh_triangle->vertex);
+	return mesh_triangle;
+}
+
+//细节层次：每级三角数量严格少于上一级，误差不减小
+static bool CheckLodLevel(const char* name, const render::MESH_TRIANGLE* mesh_triangle)
+{
+	if (mesh_triangle->lod.size() < 2)
+	{
+		printf("TestLod: %s has %d level(s)\n", name, (int)mesh_triangle->lod.size());
+		return false;
+	}
+
+	int triangle_count = (int)mesh_triangle->triangle.size() / 3;
+	float error = 0.0f;
+	for (int i = 0; i < (int)mesh_triangle->lod.size(); ++i)
+	{
+		const render::MESH_TRIANGLE_LOD* lod = &mesh_triangle->lod[i];
+		int lod_triangle_count = (int)lod->mesh_triangle->triangle.size() / 3;
+		if (lod_triangle_count >= triangle_count || lod->error < error)
+		{
+			printf("TestLod: %s level %d has %d triangle(s) error %f, previous %d triangle(s) error %f\n",
+				name, i, lod_triangle_count, lod->error, triangle_count, error);
+			return false;
+		}
+		triangle_count = lod_triangle_count;
+		error = lod->error;
+	}
+	return true;
+}
+
+//细节层次：边界边只属于一个三角，接缝处两份顶点各自在边界上，边界顶点在每一级中都保留，位置和纹理坐标不变
+static bool CheckLodBoundary(const render::MESH_TRIANGLE* mesh_triangle)
+{
+	int vertex_count = (int)mesh_triangle->vertex.size();
+	const std::vector<int>* triangle = &mesh_triangle->triangle;
+	std::vector<long long> edge;
+	for (int i = 0; i < (int)triangle->size(); ++i)
+	{
+		int a = triangle->at(i);
+		int b = triangle->at(i % 3 == 2 ? i - 2 : i + 1);
+		edge.push_back((long long)std::min(a, b) * vertex_count + std::max(a, b));
+	}
+	std::sort(edge.begin(), edge.end());
+	std::vector<int> boundary;
+	for (int i = 0; i < (int)edge.size();)
+	{
+		int j = i + 1;
+		while (j < (int)edge.size() && edge[j] == edge[i])
+			++j;
+		if (1 == j - i)
+		{
+			boundary.push_back((int)(edge[i] / vertex_count));
+			boundary.push_back((int)(edge[i] % vertex_count));
+		}
+		i = j;
+	}
+
+	for (int i = 0; i < (int)mesh_triangle->lod.size(); ++i)
+	{
+		const render::MESH_TRIANGLE* lod_mesh_triangle = mesh_triangle->lod[i].mesh_triangle;
+		std::vector<char> referenced(lod_mesh_triangle->vertex.size(), 0);
+		for (int j = 0; j < (int)lod_mesh_triangle->triangle.size(); ++j)
+			referenced[lod_mesh_triangle->triangle[j]] = 1;
+
+		for (int j = 0; j < (int)boundary.size(); ++j)
+		{
+			const render::vector3* v = &mesh_triangle->vertex[boundary[j]];
+			const render::vector2* t = &mesh_triangle->texture[boundary[j]];
+			bool found = false;
+			for (int k = 0; k < (int)lod_mesh_triangle->vertex.size() && !found; ++k)
+			{
+				const render::vector3* lod_v = &lod_mesh_triangle->vertex[k];
+				const render::vector2* lod_t = &lod_mesh_triangle->texture[k];
+				found = referenced[k] &&
+					lod_v->x == v->x && lod_v->y == v->y && lod_v->z == v->z &&
+					lod_t->x == t->x && lod_t->y == t->y;
+			}
+			if (!found)
+			{
+				printf("TestLod: level %d lost boundary vertex %d (%f,%f,%f)\n", i, boundary[j], v->x, v->y, v->z);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//细节层次：网格放在摄像机正前方distance处，返回进入光栅化的三角数量
+static int DrawLodSphere(render::MESH_TRIANGLE* mesh_triangle, float distance, float lod_pixel_error)
+{
+	render::vector3 eye(0.0f, 0.0f, 0.0f);
+	render::vector3 at(0.0f, 0.0f, 1.0f);
+	render::vector3 up(0.0f, 1.0f, 0.0f);
+
+	render::Render r;
+	r.Init(320, 240, 2.0f, 1000.0f, 0.5f, _COLOR_LIME, &eye, &at, &up);
+	r.SetLodPixelError(lod_pixel_error);
+	r.EnableRenderState(_RENDER_STATE_DEPTH_TEST, 1);
+	r.EnableRenderState(_RENDER_STATE_ILLUMINATION_COMPUTE, 1);
+	r.EnableRenderState(_RENDER_STATE_FACE_CULLING, 1);
+	r.SetRenderStateFaceCullingBack(1);
+	r.FillBuffer(true, _COLOR_BLACK, true);
+	r.ClearRasterizeStatistics();
+
+	render::matrix4 transform_world;
+	transform_world.Translate(0.0f, 0.0f, distance);
+	r.SetTransform(_COORDINATE_WORLD, &transform_world);
+	r.Draw3DMeshTriangle(mesh_triangle, &eye);
+
+	const render::RASTERIZE_STATISTICS* rs = r.GetRasterizeStatistics();
+	int triangle_count = rs->triangle_reject + rs->triangle_point_sample + rs->triangle_span;
+	r.End();
+	return triangle_count;
+}
+
+//细节层次：生成的各级三角数量逐级减少，边界和纹理接缝顶点不动，近处使用原始网格，远处使用较粗的一级
+static bool TestLod()
+{
+	bool pass = true;
+
+	render::MESH_TRIANGLE* sphere = render::MeshTriangleCreateSphere(50.0f, 32, 32);
+	render::MeshTriangleBuildLod(sphere);
+	pass = CheckLodLevel("sphere", sphere) && pass;
+
+	render::MESH_TRIANGLE* seam = CreateLodSeamMesh();
+	render::MeshTriangleBuildLod(seam);
+	pass = CheckLodLevel("seam", seam) && pass;
+	pass = CheckLodBoundary(seam) && pass;
+
+	//关闭细节层次时总是原始网格，作为比较基准
+	int near_base = DrawLodSphere(sphere, 150.0f, 0.0f);
+	int near_lod = DrawLodSphere(sphere, 150.0f, 1.0f);
+	if (near_lod != near_base)
+	{
+		printf("TestLod: near sphere drew %d triangle(s), base mesh %d\n", near_lod, near_base);
+		pass = false;
+	}
+	int far_base = DrawLodSphere(sphere, 800.0f, 0.0f);
+	int far_lod = DrawLodSphere(sphere, 800.0f, 1.0f);
+	if (far_lod >= far_base || 0 == far_lod)
+	{
+		printf("TestLod: far sphere drew %d triangle(s), base mesh %d\n", far_lod, far_base);
+		pass = false;
+	}
+
+	render::MeshTriangleUnload(seam);
+	render::MeshTriangleUnload(sphere);
+	return pass;
+}
+
+//浮点数判断策略：示例场景包含光照、近截面裁剪、深度测试、混合，各策略下图像必须逐像素相同，
+//带参数运行时把图像写入参数指定的文件，由CompareFltPolicy.cmake比较各策略的输出
+static void DrawFltPolicyScene(std::vector<int>* image)
+{
+	render::vector3 eye(60.0f, 25.0f, -70.0f);
+	render::vector3 at(0.0f, 0.0f, 0.0f);
+	render::vector3 up(0.0f, 1.0f, 0.0f);
+
+	render::Render r;
+	r.Init(320, 240, 2.0f, 1000.0f, 0.5f, _COLOR_LIME, &eye, &at, &up);
+	r.EnableRenderState(_RENDER_STATE_DEPTH_TEST, 1);
+	r.EnableRenderState(_RENDER_STATE_FACE_CULLING, 1);
+	r.SetRenderStateFaceCullingBack(1);
+	r.EnableRenderState(_RENDER_STATE_ILLUMINATION_COMPUTE, 1);
+	r.FillBuffer(true, _COLOR_BLACK, true);
+
+	render::MATERIAL material =
+	{
+		render::vector3(0.0f, 0.0f, 0.0f),
+		render::vector3(0.5f, 0.5f, 0.5f),
+		render::vector3(0.5f, 0.5f, 0.5f),
+		render::vector3(0.6f, 0.6f, 0.6f),
+		5.0f,
+	};
+	r.SetMaterial(&material);
+	render::LIGHT light_dot = { _LIGHT_DOT, render::vector3(0.0f, 255.0f, 0.0f), render::vector3(0.0f, 0.0f, 0.0f), render::vector3(0.0f, 0.0f, 0.0f), 70.0f };
+	render::LIGHT light_down = { _LIGHT_DIRECTION, render::vector3(0.0f, 0.0f, 255.0f), render::vector3(0.0f, -1.0f, 0.0f) };
+	render::LIGHT light_up = { _LIGHT_DIRECTION, render::vector3(255.0f, 0.0f, 0.0f), render::vector3(0.0f, 1.0f, 0.0f) };
+	r.AddLight(&light_dot, 1, true);
+	r.AddLight(&light_down, 2, true);
+	r.AddLight(&light_up, 3, true);
+	render::vector3 ambient(128.0f, 128.0f, 128.0f);
+	r.SetLightAmbientColor(&ambient);
+
+	render::MESH_TRIANGLE* sphere = render::MeshTriangleCreateSphere(30.0f, 32, 32);
+	render::MESH_TRIANGLE* torus = render::MeshTriangleCreateTorus(20.0f, 45.0f, 32, 32);
+	render::MESH_TRIANGLE* cube = render::MeshTriangleCreateCube(40.0f, 40.0f, 40.0f);
+
+	render::matrix4 transform_world;
+	r.SetTransform(_COORDINATE_WORLD, &transform_world);
+	r.Draw3DMeshTriangle(sphere, &eye);
+
+	//圆环跨过近截面
+	render::matrix4 transform_torus;
+	transform_torus.Translate(45.0f, 20.0f, -50.0f);
+	r.SetTransform(_COORDINATE_WORLD, &transform_torus);
+	r.Draw3DMeshTriangle(torus, &eye);
+
+	r.EnableRenderState(_RENDER_STATE_ALPHA_BLEND, 1);
+	render::matrix4 transform_cube;
+	transform_cube.RotateY(0.7f);
+	transform_cube.Translate(-30.0f, 0.0f, 20.0f);
+	r.SetTransform(_COORDINATE_WORLD, &transform_cube);
+	r.Draw3DMeshTriangle(cube, &eye);
+
+	int buffer_width = 0;
+	int buffer_height = 0;
+	int buffer_pitch = 0;
+	r.GetBufferSize(&buffer_width, &buffer_height, &buffer_pitch);
+	const int* video_buffer = r.GetVideoBuffer();
+	for (int y = 0; y < buffer_height; ++y)
+		image->insert(
+			image->end(),
+			video_buffer + y * buffer_pitch,
+			video_buffer + y * buffer_pitch + buffer_width);
+
+	render::MeshTriangleUnload(cube);
+	render::MeshTriangleUnload(torus);
+	render::MeshTriangleUnload(sphere);
+	r.End();
+}
+
+static bool WriteFltPolicyScene(const char* file_name)
+{
+	std::vector<int> image;
+	DrawFltPolicyScene(&image);
+
+	FILE* file = fopen(file_name, "wb");
+	if (NULL == file)
+	{
+		printf("WriteFltPolicyScene: can not open %s\n", file_name);
+		return false;
+	}
+	bool written = image.size() == fwrite(image.data(), sizeof(int), image.size(), file);
+	fclose(file);
+	return written;
+}
+
+int main(int argc, char* argv[])
+{
+	int failed = 0;
+	if (!TestMeshletCullingNearPlane())
+		++failed;
+	if (!TestSceneBvh())
+		++failed;
+	if (!TestLod())
+		++failed;
+	if (1 < argc && !WriteFltPolicyScene(argv[1]))
+		++failed;
+
+	printf("%d test(s) failed\n", failed);
+	return 0 == failed ? 0 : 1;
+}
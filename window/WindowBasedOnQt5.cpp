@@ -30,7 +30,7 @@ namespace window_based_on_qt5
 		public:
 			MemoryImage(int w, int h);
 			~MemoryImage();
-			void Build(int w, int h, const int* c);
+			void Build(int w, int h, const int* c, int pitch);
 			QImage* Image();
 		};
 
@@ -52,8 +52,8 @@ namespace window_based_on_qt5
 			virtual void DrawLine(int x1, int y1, int x2, int y2) override;
 			virtual void DrawRectangle(int x1, int y1, int x2, int y2) override;
 			virtual void DrawEllipse(int x1, int y1, int x2, int y2) override;
-			virtual void DrawARGB(int dx, int dy, const int* argb, int w, int h) override;
-			virtual void DrawARGB(int dx, int dy, int dw, int dh, const int* argb, int w, int h) override;
+			virtual void DrawARGB(int dx, int dy, const int* argb, int w, int h, int pitch) override;
+			virtual void DrawARGB(int dx, int dy, int dw, int dh, const int* argb, int w, int h, int pitch) override;
 		};
 
 		//用户应用相关
@@ -102,7 +102,7 @@ namespace window_based_on_qt5
 		delete m_Image;
 	}
 
-	void Qt5Window::MemoryImage::Build(int w, int h, const int* c)
+	void Qt5Window::MemoryImage::Build(int w, int h, const int* c, int pitch)
 	{
 		m_Used.setWidth(w);
 		m_Used.setHeight(h);
@@ -127,7 +127,7 @@ namespace window_based_on_qt5
 		{
 			QRgb* rgb = (QRgb*)m_Image->scanLine(y);
 			for (int x = 0; x < uw; ++x)
-				rgb[x] = c[x + y * uw];
+				rgb[x] = c[x + y * pitch];
 		}
 	}
 
@@ -183,9 +183,9 @@ namespace window_based_on_qt5
 		m_Painter->drawEllipse(x1, y1, x2, y2);
 	}
 
-	void Qt5Window::RenderImplement::DrawARGB(int dx, int dy, const int* argb, int w, int h)
+	void Qt5Window::RenderImplement::DrawARGB(int dx, int dy, const int* argb, int w, int h, int pitch)
 	{
-		m_ImageBuildFromMemory.Build(w, h, argb);
+		m_ImageBuildFromMemory.Build(w, h, argb, pitch);
 
 		m_Painter->drawImage(
 			QPoint(dx, dy),
@@ -193,9 +193,9 @@ namespace window_based_on_qt5
 			QRect(0, 0, w, h));
 	}
 
-	void Qt5Window::RenderImplement::DrawARGB(int dx, int dy, int dw, int dh, const int* argb, int w, int h)
+	void Qt5Window::RenderImplement::DrawARGB(int dx, int dy, int dw, int dh, const int* argb, int w, int h, int pitch)
 	{
-		m_ImageBuildFromMemory.Build(w, h, argb);
+		m_ImageBuildFromMemory.Build(w, h, argb, pitch);
 
 		m_Painter->drawImage(
 			QRect(dx, dy, dw, dh),
@@ -23,8 +23,9 @@ namespace window_based_on_qt5
 		virtual void DrawLine(int x1, int y1, int x2, int y2) = 0;
 		virtual void DrawRectangle(int x1, int y1, int x2, int y2) = 0;
 		virtual void DrawEllipse(int x1, int y1, int x2, int y2) = 0;
-		virtual void DrawARGB(int dx, int dy, const int* argb, int w, int h) = 0;
-		virtual void DrawARGB(int dx, int dy, int dw, int dh, const int* argb, int w, int h) = 0;
+		//pitch为argb相邻两行起点相差的像素数，不小于w
+		virtual void DrawARGB(int dx, int dy, const int* argb, int w, int h, int pitch) = 0;
+		virtual void DrawARGB(int dx, int dy, int dw, int dh, const int* argb, int w, int h, int pitch) = 0;
 	};
 
 	class IUserApp